@@ -11,6 +11,8 @@
 #include "assets/lang_config.h"
 #include "mcp_server.h"
 #include "audio_debugger.h"
+#include "boot_profiler.h"
+#include "wake_word_stats.h"
 
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "afe_audio_processor.h"
@@ -105,10 +107,10 @@ void Application::CheckNewVersion(Ota& ota) {
     int retry_count = 0;
     int retry_delay = 10; // 初始重试延迟为10秒
 
+    // 在后台任务中运行，设备已经待机，只有升级或激活时才切换状态
     while (true) {
-        SetDeviceState(kDeviceStateActivating);
         auto display = Board::GetInstance().GetDisplay();
-        display->SetStatus(Lang::Strings::CHECKING_NEW_VERSION);
+        display->PostStatus(Lang::Strings::CHECKING_NEW_VERSION);
 
         if (!ota.CheckVersion()) {
             retry_count++;
@@ -122,12 +124,7 @@ void Application::CheckNewVersion(Ota& ota) {
             Alert(Lang::Strings::ERROR, buffer, "sad", Lang::Sounds::P3_EXCLAMATION);
 
             ESP_LOGW(TAG, "Check new version failed, retry in %d seconds (%d/%d)", retry_delay, retry_count, MAX_RETRY);
-            for (int i = 0; i < retry_delay; i++) {
-                vTaskDelay(pdMS_TO_TICKS(1000));
-                if (device_state_ == kDeviceStateIdle) {
-                    break;
-                }
-            }
+            vTaskDelay(pdMS_TO_TICKS(retry_delay * 1000));
             retry_delay *= 2; // 每次重试后延迟时间翻倍
             continue;
         }
@@ -141,12 +138,14 @@ void Application::CheckNewVersion(Ota& ota) {
 
             SetDeviceState(kDeviceStateUpgrading);
             
-            display->SetIcon(FONT_AWESOME_DOWNLOAD);
+            display->PostIcon(FONT_AWESOME_DOWNLOAD);
             std::string message = std::string(Lang::Strings::NEW_VERSION) + ota.GetFirmwareVersion();
-            display->SetChatMessage("system", message.c_str());
+            display->PostChatMessage("system", message.c_str());
 
             auto& board = Board::GetInstance();
             board.SetPowerSaveMode(false);
+            // 唤醒词模型在后台加载，加载完成后再停止检测，避免升级过程中重新开启
+            xEventGroupWaitBits(event_group_, AUDIO_PIPELINE_READY_EVENT, pdFALSE, pdFALSE, portMAX_DELAY);
             wake_word_->StopDetection();
             // 预先关闭音频输出，避免升级过程有音频操作
             auto codec = board.GetAudioCodec();
@@ -164,11 +163,11 @@ void Application::CheckNewVersion(Ota& ota) {
             ota.StartUpgrade([display](int progress, size_t speed) {
                 char buffer[64];
                 snprintf(buffer, sizeof(buffer), "%d%% %uKB/s", progress, speed / 1024);
-                display->SetChatMessage("system", buffer);
+                display->PostChatMessage("system", buffer);
             });
 
             // If upgrade success, the device will reboot and never reach here
-            display->SetStatus(Lang::Strings::UPGRADE_FAILED);
+            display->PostStatus(Lang::Strings::UPGRADE_FAILED);
             ESP_LOGI(TAG, "Firmware upgrade failed...");
             vTaskDelay(pdMS_TO_TICKS(3000));
             Reboot();
@@ -178,12 +177,12 @@ void Application::CheckNewVersion(Ota& ota) {
         // No new version, mark the current version as valid
         ota.MarkCurrentVersionValid();
         if (!ota.HasActivationCode() && !ota.HasActivationChallenge()) {
-            xEventGroupSetBits(event_group_, CHECK_NEW_VERSION_DONE_EVENT);
             // Exit the loop if done checking new version
             break;
         }
 
-        display->SetStatus(Lang::Strings::ACTIVATION);
+        SetDeviceState(kDeviceStateActivating);
+        display->PostStatus(Lang::Strings::ACTIVATION);
         // Activation code is shown to the user and waiting for the user to input
         if (ota.HasActivationCode()) {
             ShowActivationCode(ota.GetActivationCode(), ota.GetActivationMessage());
@@ -194,7 +193,6 @@ void Application::CheckNewVersion(Ota& ota) {
             ESP_LOGI(TAG, "Activating... %d/%d", i + 1, 10);
             esp_err_t err = ota.Activate();
             if (err == ESP_OK) {
-                xEventGroupSetBits(event_group_, CHECK_NEW_VERSION_DONE_EVENT);
                 break;
             } else if (err == ESP_ERR_TIMEOUT) {
                 vTaskDelay(pdMS_TO_TICKS(3000));
@@ -208,6 +206,36 @@ void Application::CheckNewVersion(Ota& ota) {
     }
 }
 
+// 启动时使用了缓存的检查结果，协议已经在运行，这里静默地重新检查。需要升级、激活或服务器配置变化时，
+// 缓存已被清除或更新，等设备空闲后重启，由启动流程完成升级、激活或用新的配置连接
+void Application::CheckNewVersionInBackground() {
+    const int MAX_RETRY = 10;
+    int retry_delay = 10;
+    Ota ota;
+
+    for (int retry_count = 1; !ota.CheckVersion(); retry_count++) {
+        if (retry_count >= MAX_RETRY) {
+            ESP_LOGE(TAG, "Too many retries, exit background version check");
+            return;
+        }
+        ESP_LOGW(TAG, "Background version check failed, retry in %d seconds (%d/%d)", retry_delay, retry_count, MAX_RETRY);
+        vTaskDelay(pdMS_TO_TICKS(retry_delay * 1000));
+        retry_delay *= 2;
+    }
+
+    if (!ota.HasNewVersion() && !ota.HasActivationCode() && !ota.HasActivationChallenge() && !ota.IsConfigChanged()) {
+        ota.MarkCurrentVersionValid();
+        return;
+    }
+
+    // Do not interrupt an ongoing conversation
+    while (device_state_ != kDeviceStateIdle) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+    ESP_LOGI(TAG, "Upgrade, activation or new server config required, rebooting");
+    Reboot();
+}
+
 void Application::ShowActivationCode(const std::string& code, const std::string& message) {
     struct digit_sound {
         char digit;
@@ -241,9 +269,9 @@ void Application::ShowActivationCode(const std::string& code, const std::string&
 void Application::Alert(const char* status, const char* message, const char* emotion, const std::string_view& sound) {
     ESP_LOGW(TAG, "Alert %s: %s [%s]", status, message, emotion);
     auto display = Board::GetInstance().GetDisplay();
-    display->SetStatus(status);
-    display->SetEmotion(emotion);
-    display->SetChatMessage("system", message);
+    display->PostStatus(status);
+    display->PostEmotion(emotion);
+    display->PostChatMessage("system", message);
     if (!sound.empty()) {
         ResetDecoder();
         PlaySound(sound);
@@ -253,9 +281,9 @@ void Application::Alert(const char* status, const char* message, const char* emo
 void Application::DismissAlert() {
     if (device_state_ == kDeviceStateIdle) {
         auto display = Board::GetInstance().GetDisplay();
-        display->SetStatus(Lang::Strings::STANDBY);
-        display->SetEmotion("neutral");
-        display->SetChatMessage("system", "");
+        display->PostStatus(Lang::Strings::STANDBY);
+        display->PostEmotion("neutral");
+        display->PostChatMessage("system", "");
     }
 }
 
@@ -279,6 +307,7 @@ void Application::PlaySound(const std::string_view& sound) {
         AudioStreamPacket packet;
         packet.sample_rate = 16000;
         packet.frame_duration = 60;
+        packet.session_id = kLocalAudioSession;
         packet.payload.resize(payload_size);
         memcpy(packet.payload.data(), p3->payload, payload_size);
         p += payload_size;
@@ -399,8 +428,113 @@ void Application::StopListening() {
     });
 }
 
+// 加载音频前端和唤醒词模型，不依赖网络，在启动时与联网和版本检查并行执行
+void Application::InitializeAudioPipeline() {
+    auto codec = Board::GetInstance().GetAudioCodec();
+    audio_processor_->Initialize(codec);
+    audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (audio_send_queue_.size() >= MAX_AUDIO_PACKETS_IN_QUEUE) {
+                ESP_LOGW(TAG, "Too many audio packets in queue, drop the newest packet");
+                return;
+            }
+        }
+        background_task_->Schedule([this, data = std::move(data)]() mutable {
+            opus_encoder_->Encode(std::move(data), [this](std::vector<uint8_t>&& opus) {
+                AudioStreamPacket packet;
+                packet.payload = std::move(opus);
+#ifdef CONFIG_USE_SERVER_AEC
+                {
+                    std::lock_guard<std::mutex> lock(timestamp_mutex_);
+                    if (!timestamp_queue_.empty()) {
+                        packet.timestamp = timestamp_queue_.front();
+                        timestamp_queue_.pop_front();
+                    } else {
+                        packet.timestamp = 0;
+                    }
+
+                    if (timestamp_queue_.size() > 3) { // 限制队列长度3
+                        timestamp_queue_.pop_front(); // 该包发送前先出队保持队列长度
+                        return;
+                    }
+                }
+#endif
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (audio_send_queue_.size() >= MAX_AUDIO_PACKETS_IN_QUEUE) {
+                    ESP_LOGW(TAG, "Too many audio packets in queue, drop the oldest packet");
+                    audio_send_queue_.pop_front();
+                }
+                audio_send_queue_.emplace_back(std::move(packet));
+                xEventGroupSetBits(event_group_, SEND_AUDIO_EVENT);
+            });
+        }, kBackgroundTaskLaneAudioEncode);
+    });
+    audio_processor_->OnVadStateChange([this](bool speaking) {
+        if (device_state_ == kDeviceStateListening) {
+            Schedule([this, speaking]() {
+                if (speaking) {
+                    voice_detected_ = true;
+                } else {
+                    voice_detected_ = false;
+                }
+                auto led = Board::GetInstance().GetLed();
+                led->OnStateChanged();
+            });
+        }
+    });
+
+    wake_word_->Initialize(codec);
+    wake_word_->OnWakeWordDetected([this](const std::string& wake_word) {
+        Schedule([this, &wake_word]() {
+            if (!protocol_) {
+                // 冷启动时版本检查完成前协议尚未创建，继续检测
+                wake_word_->StartDetection();
+                return;
+            }
+
+            if (device_state_ == kDeviceStateIdle) {
+                wake_word_->EncodeWakeWordData();
+
+                if (!protocol_->IsAudioChannelOpened()) {
+                    SetDeviceState(kDeviceStateConnecting);
+                    if (!protocol_->OpenAudioChannel()) {
+                        wake_word_->StartDetection();
+                        return;
+                    }
+                }
+
+                ESP_LOGI(TAG, "Wake word detected: %s", wake_word.c_str());
+#if CONFIG_USE_AFE_WAKE_WORD
+                AudioStreamPacket packet;
+                // Encode and send the wake word data to the server
+                while (wake_word_->GetWakeWordOpus(packet.payload)) {
+                    protocol_->SendAudio(packet);
+                }
+                // Set the chat state to wake word detected
+                protocol_->SendWakeWordDetected(wake_word);
+#else
+                // Play the pop up sound to indicate the wake word is detected
+                // And wait 60ms to make sure the queue has been processed by audio task
+                ResetDecoder();
+                PlaySound(Lang::Sounds::P3_POPUP);
+                vTaskDelay(pdMS_TO_TICKS(60));
+#endif
+                SetListeningMode(aec_mode_ == kAecOff ? kListeningModeAutoStop : kListeningModeRealtime);
+            } else if (device_state_ == kDeviceStateSpeaking) {
+                AbortSpeaking(kAbortReasonWakeWordDetected);
+            } else if (device_state_ == kDeviceStateActivating) {
+                SetDeviceState(kDeviceStateIdle);
+            }
+        });
+    });
+    wake_word_->StartDetection();
+    BootProfiler::GetInstance().Mark("wake_word_ready");
+}
+
 void Application::Start() {
     auto& board = Board::GetInstance();
+    BootProfiler::GetInstance().Mark("app_start");
     SetDeviceState(kDeviceStateStarting);
 
     /* Setup the display */
@@ -429,6 +563,7 @@ void Application::Start() {
         reference_resampler_.Configure(codec->input_sample_rate(), 16000);
     }
     codec->Start();
+    BootProfiler::GetInstance().Mark("codec");
 
 #if CONFIG_USE_AUDIO_PROCESSOR
     xTaskCreatePinnedToCore([](void* arg) {
@@ -444,21 +579,81 @@ void Application::Start() {
     }, "audio_loop", 4096 * 2, this, 8, &audio_loop_task_handle_);
 #endif
 
+    /* Load the audio models while the network is starting */
+    xTaskCreate([](void* arg) {
+        Application* app = (Application*)arg;
+        app->InitializeAudioPipeline();
+        xEventGroupSetBits(app->event_group_, AUDIO_PIPELINE_READY_EVENT);
+        vTaskDelete(NULL);
+    }, "audio_init", 4096 * 2, this, uxTaskPriorityGet(NULL), nullptr);
+
     /* Start the clock timer to update the status bar */
     esp_timer_start_periodic(clock_timer_handle_, 1000000);
 
     /* Wait for the network to be ready */
     board.StartNetwork();
+    BootProfiler::GetInstance().Mark("network");
 
     // Update the status bar immediately to show the network state
     display->UpdateStatusBar(true);
 
     // Check for new firmware version or get the MQTT broker address
+    // On warm boot, the cached response is used and the check runs in the background
+    // On cold boot, the protocol is started on the main loop once the check is done, the device goes idle without waiting for it
     Ota ota;
-    CheckNewVersion(ota);
+    if (ota.LoadCachedResponse()) {
+        BootProfiler::GetInstance().Mark("version_check");
+        StartProtocol(ota);
+        xTaskCreate([](void* arg) {
+            Application* app = (Application*)arg;
+            app->CheckNewVersionInBackground();
+            vTaskDelete(NULL);
+        }, "check_version", 4096 * 2, this, 2, nullptr);
+    } else {
+        xTaskCreate([](void* arg) {
+            Application* app = (Application*)arg;
+            Ota ota;
+            app->CheckNewVersion(ota);
+            BootProfiler::GetInstance().Mark("version_check");
+            // 协议在主循环中创建，完成前 ota 需保持有效
+            auto done = xSemaphoreCreateBinary();
+            while (!app->Schedule([app, &ota, done]() {
+                app->StartProtocol(ota);
+                xSemaphoreGive(done);
+            })) {
+                vTaskDelay(pdMS_TO_TICKS(100));
+            }
+            xSemaphoreTake(done, portMAX_DELAY);
+            vSemaphoreDelete(done);
+            vTaskDelete(NULL);
+        }, "check_version", 4096 * 2, this, 2, nullptr);
+    }
+
+    audio_debugger_ = std::make_unique<AudioDebugger>();
+
+    // Only wait for the wake word model, the version check and the protocol may still be running
+    xEventGroupWaitBits(event_group_, AUDIO_PIPELINE_READY_EVENT, pdFALSE, pdFALSE, portMAX_DELAY);
+    if (device_state_ == kDeviceStateStarting) {
+        SetDeviceState(kDeviceStateIdle);
+    }
+    BootProfiler::GetInstance().Mark("ready");
+    BootProfiler::GetInstance().PrintSummary();
+
+    // Print heap stats
+    SystemInfo::PrintHeapStats();
+    
+    // Enter the main event loop
+    MainEventLoop();
+}
+
+// 在主循环中调用，ota 为本次启动使用的版本检查结果
+void Application::StartProtocol(Ota& ota) {
+    auto& board = Board::GetInstance();
+    auto display = board.GetDisplay();
+    auto codec = board.GetAudioCodec();
 
     // Initialize the protocol
-    display->SetStatus(Lang::Strings::LOADING_PROTOCOL);
+    display->PostStatus(Lang::Strings::LOADING_PROTOCOL);
 
     // Add MCP common tools before initializing the protocol
 #if CONFIG_IOT_PROTOCOL_MCP
@@ -479,13 +674,17 @@ void Application::Start() {
         Alert(Lang::Strings::ERROR, message.c_str(), "sad", Lang::Sounds::P3_EXCLAMATION);
     });
     protocol_->OnIncomingAudio([this](AudioStreamPacket&& packet) {
+        if (audio_session_aborted_) {
+            return;
+        }
+        packet.session_id = audio_session_id_;
         std::lock_guard<std::mutex> lock(mutex_);
         if (device_state_ == kDeviceStateSpeaking && audio_decode_queue_.size() < MAX_AUDIO_PACKETS_IN_QUEUE) {
             audio_decode_queue_.emplace_back(std::move(packet));
         }
     });
-    protocol_->OnAudioChannelOpened([this, codec, &board]() {
-        board.SetPowerSaveMode(false);
+    protocol_->OnAudioChannelOpened([this, codec]() {
+        Board::GetInstance().SetPowerSaveMode(false);
         if (protocol_->server_sample_rate() != codec->output_sample_rate()) {
             ESP_LOGW(TAG, "Server sample rate %d does not match device output sample rate %d, resampling may cause distortion",
                 protocol_->server_sample_rate(), codec->output_sample_rate());
@@ -500,22 +699,24 @@ void Application::Start() {
         }
 #endif
     });
-    protocol_->OnAudioChannelClosed([this, &board]() {
-        board.SetPowerSaveMode(true);
+    protocol_->OnAudioChannelClosed([this]() {
+        Board::GetInstance().SetPowerSaveMode(true);
         Schedule([this]() {
             auto display = Board::GetInstance().GetDisplay();
-            display->SetChatMessage("system", "");
+            display->PostChatMessage("system", "");
             SetDeviceState(kDeviceStateIdle);
         });
     });
-    protocol_->OnIncomingJson([this, display](const cJSON* root) {
+    protocol_->OnIncomingJson([this](const cJSON* root) {
         // Parse JSON data
         auto type = cJSON_GetObjectItem(root, "type");
         if (strcmp(type->valuestring, "tts") == 0) {
             auto state = cJSON_GetObjectItem(root, "state");
             if (strcmp(state->valuestring, "start") == 0) {
+                // Start the new session here, in order with the incoming audio packets
+                audio_session_id_++;
+                audio_session_aborted_ = false;
                 Schedule([this]() {
-                    aborted_ = false;
                     if (device_state_ == kDeviceStateIdle || device_state_ == kDeviceStateListening) {
                         SetDeviceState(kDeviceStateSpeaking);
                     }
@@ -535,8 +736,9 @@ void Application::Start() {
                 auto text = cJSON_GetObjectItem(root, "text");
                 if (cJSON_IsString(text)) {
                     ESP_LOGI(TAG, "<< %s", text->valuestring);
-                    Schedule([this, display, message = std::string(text->valuestring)]() {
-                        display->SetChatMessage("assistant", message.c_str());
+                    // 经主循环转发，与状态切换的显示更新保持先后顺序
+                    Schedule([message = std::string(text->valuestring)]() {
+                        Board::GetInstance().GetDisplay()->PostChatMessage("assistant", message.c_str());
                     });
                 }
             }
@@ -544,15 +746,16 @@ void Application::Start() {
             auto text = cJSON_GetObjectItem(root, "text");
             if (cJSON_IsString(text)) {
                 ESP_LOGI(TAG, ">> %s", text->valuestring);
-                Schedule([this, display, message = std::string(text->valuestring)]() {
-                    display->SetChatMessage("user", message.c_str());
+                WakeWordStats::GetInstance().OnSpeechRecognized();
+                Schedule([message = std::string(text->valuestring)]() {
+                    Board::GetInstance().GetDisplay()->PostChatMessage("user", message.c_str());
                 });
             }
         } else if (strcmp(type->valuestring, "llm") == 0) {
             auto emotion = cJSON_GetObjectItem(root, "emotion");
             if (cJSON_IsString(emotion)) {
-                Schedule([this, display, emotion_str = std::string(emotion->valuestring)]() {
-                    display->SetEmotion(emotion_str.c_str());
+                Schedule([emotion_str = std::string(emotion->valuestring)]() {
+                    Board::GetInstance().GetDisplay()->PostEmotion(emotion_str.c_str());
                 });
             }
 #if CONFIG_IOT_PROTOCOL_MCP
@@ -600,124 +803,24 @@ void Application::Start() {
         }
     });
     bool protocol_started = protocol_->Start();
-
-    audio_debugger_ = std::make_unique<AudioDebugger>();
-    audio_processor_->Initialize(codec);
-    audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            if (audio_send_queue_.size() >= MAX_AUDIO_PACKETS_IN_QUEUE) {
-                ESP_LOGW(TAG, "Too many audio packets in queue, drop the newest packet");
-                return;
-            }
-        }
-        background_task_->Schedule([this, data = std::move(data)]() mutable {
-            opus_encoder_->Encode(std::move(data), [this](std::vector<uint8_t>&& opus) {
-                AudioStreamPacket packet;
-                packet.payload = std::move(opus);
-#ifdef CONFIG_USE_SERVER_AEC
-                {
-                    std::lock_guard<std::mutex> lock(timestamp_mutex_);
-                    if (!timestamp_queue_.empty()) {
-                        packet.timestamp = timestamp_queue_.front();
-                        timestamp_queue_.pop_front();
-                    } else {
-                        packet.timestamp = 0;
-                    }
-
-                    if (timestamp_queue_.size() > 3) { // 限制队列长度3
-                        timestamp_queue_.pop_front(); // 该包发送前先出队保持队列长度
-                        return;
-                    }
-                }
-#endif
-                std::lock_guard<std::mutex> lock(mutex_);
-                if (audio_send_queue_.size() >= MAX_AUDIO_PACKETS_IN_QUEUE) {
-                    ESP_LOGW(TAG, "Too many audio packets in queue, drop the oldest packet");
-                    audio_send_queue_.pop_front();
-                }
-                audio_send_queue_.emplace_back(std::move(packet));
-                xEventGroupSetBits(event_group_, SEND_AUDIO_EVENT);
-            });
-        });
-    });
-    audio_processor_->OnVadStateChange([this](bool speaking) {
-        if (device_state_ == kDeviceStateListening) {
-            Schedule([this, speaking]() {
-                if (speaking) {
-                    voice_detected_ = true;
-                } else {
-                    voice_detected_ = false;
-                }
-                auto led = Board::GetInstance().GetLed();
-                led->OnStateChanged();
-            });
-        }
-    });
-
-    wake_word_->Initialize(codec);
-    wake_word_->OnWakeWordDetected([this](const std::string& wake_word) {
-        Schedule([this, &wake_word]() {
-            if (!protocol_) {
-                return;
-            }
-
-            if (device_state_ == kDeviceStateIdle) {
-                wake_word_->EncodeWakeWordData();
-
-                if (!protocol_->IsAudioChannelOpened()) {
-                    SetDeviceState(kDeviceStateConnecting);
-                    if (!protocol_->OpenAudioChannel()) {
-                        wake_word_->StartDetection();
-                        return;
-                    }
-                }
-
-                ESP_LOGI(TAG, "Wake word detected: %s", wake_word.c_str());
-#if CONFIG_USE_AFE_WAKE_WORD
-                AudioStreamPacket packet;
-                // Encode and send the wake word data to the server
-                while (wake_word_->GetWakeWordOpus(packet.payload)) {
-                    protocol_->SendAudio(packet);
-                }
-                // Set the chat state to wake word detected
-                protocol_->SendWakeWordDetected(wake_word);
-#else
-                // Play the pop up sound to indicate the wake word is detected
-                // And wait 60ms to make sure the queue has been processed by audio task
-                ResetDecoder();
-                PlaySound(Lang::Sounds::P3_POPUP);
-                vTaskDelay(pdMS_TO_TICKS(60));
-#endif
-                SetListeningMode(aec_mode_ == kAecOff ? kListeningModeAutoStop : kListeningModeRealtime);
-            } else if (device_state_ == kDeviceStateSpeaking) {
-                AbortSpeaking(kAbortReasonWakeWordDetected);
-            } else if (device_state_ == kDeviceStateActivating) {
-                SetDeviceState(kDeviceStateIdle);
-            }
-        });
-    });
-    wake_word_->StartDetection();
-
-    // Wait for the new version check to finish
-    xEventGroupWaitBits(event_group_, CHECK_NEW_VERSION_DONE_EVENT, pdTRUE, pdFALSE, portMAX_DELAY);
-    SetDeviceState(kDeviceStateIdle);
+    BootProfiler::GetInstance().Mark("protocol");
 
     has_server_time_ = ota.HasServerTime();
     if (protocol_started) {
         std::string message = std::string(Lang::Strings::VERSION) + ota.GetCurrentVersion();
-        display->ShowNotification(message.c_str());
-        display->SetChatMessage("system", "");
+        display->PostNotification(message.c_str());
+        display->PostChatMessage("system", "");
         // Play the success sound to indicate the device is ready
         ResetDecoder();
         PlaySound(Lang::Sounds::P3_SUCCESS);
     }
 
-    // Print heap stats
-    SystemInfo::PrintHeapStats();
-    
-    // Enter the main event loop
-    MainEventLoop();
+    // 激活完成或被跳过后回到待机，已待机时恢复状态栏
+    if (device_state_ == kDeviceStateActivating) {
+        SetDeviceState(kDeviceStateIdle);
+    } else if (device_state_ == kDeviceStateIdle) {
+        display->PostStatus(Lang::Strings::STANDBY);
+    }
 }
 
 void Application::OnClockTimer() {
@@ -731,29 +834,42 @@ void Application::OnClockTimer() {
         // SystemInfo::PrintTaskCpuUsage(pdMS_TO_TICKS(1000));
         // SystemInfo::PrintTaskList();
         SystemInfo::PrintHeapStats();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (main_tasks_dropped_ != main_tasks_dropped_reported_) {
+                ESP_LOGE(TAG, "Main task queue was full, dropped %lu tasks (%lu in total)",
+                    main_tasks_dropped_ - main_tasks_dropped_reported_, main_tasks_dropped_);
+                main_tasks_dropped_reported_ = main_tasks_dropped_;
+            }
+        }
 
         // If we have synchronized server time, set the status to clock "HH:MM" if the device is idle
         if (has_server_time_) {
             if (device_state_ == kDeviceStateIdle) {
-                Schedule([this]() {
-                    // Set status to clock "HH:MM"
-                    time_t now = time(NULL);
-                    char time_str[64];
-                    strftime(time_str, sizeof(time_str), "%H:%M  ", localtime(&now));
-                    Board::GetInstance().GetDisplay()->SetStatus(time_str);
-                });
+                // Set status to clock "HH:MM"
+                time_t now = time(NULL);
+                char time_str[64];
+                strftime(time_str, sizeof(time_str), "%H:%M  ", localtime(&now));
+                display->PostStatus(time_str);
             }
         }
     }
 }
 
 // Add a async task to MainLoop
-void Application::Schedule(std::function<void()> callback) {
+bool Application::Schedule(MainTask&& callback) {
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        main_tasks_.push_back(std::move(callback));
+        // The queue never grows, drops are counted and reported by the clock timer
+        if (main_tasks_count_ >= MAX_MAIN_TASKS) {
+            main_tasks_dropped_++;
+            return false;
+        }
+        main_tasks_[(main_tasks_head_ + main_tasks_count_) % MAX_MAIN_TASKS] = std::move(callback);
+        main_tasks_count_++;
     }
     xEventGroupSetBits(event_group_, SCHEDULE_EVENT);
+    return true;
 }
 
 // The Main Event Loop controls the chat state and websocket connection
@@ -778,11 +894,16 @@ void Application::MainEventLoop() {
         }
 
         if (bits & SCHEDULE_EVENT) {
+            // Only run the tasks queued so far, tasks scheduled meanwhile wait for the next event
             std::unique_lock<std::mutex> lock(mutex_);
-            auto tasks = std::move(main_tasks_);
-            lock.unlock();
-            for (auto& task : tasks) {
+            int count = main_tasks_count_;
+            while (count-- > 0) {
+                MainTask task = std::move(main_tasks_[main_tasks_head_]);
+                main_tasks_head_ = (main_tasks_head_ + 1) % MAX_MAIN_TASKS;
+                main_tasks_count_--;
+                lock.unlock();
                 task();
+                lock.lock();
             }
         }
     }
@@ -831,7 +952,7 @@ void Application::OnAudioOutput() {
     busy_decoding_audio_ = true;
     if (!background_task_->Schedule([this, codec, packet = std::move(packet)]() mutable {
         busy_decoding_audio_ = false;
-        if (aborted_) {
+        if (packet.session_id != kLocalAudioSession && packet.session_id != audio_session_id_) {
             return;
         }
 
@@ -846,13 +967,17 @@ void Application::OnAudioOutput() {
             output_resampler_.Process(pcm.data(), pcm.size(), resampled.data());
             pcm = std::move(resampled);
         }
+        // The session may have been aborted while decoding
+        if (packet.session_id != kLocalAudioSession && packet.session_id != audio_session_id_) {
+            return;
+        }
         codec->OutputData(pcm);
 #ifdef CONFIG_USE_SERVER_AEC
         std::lock_guard<std::mutex> lock(timestamp_mutex_);
         timestamp_queue_.push_back(packet.timestamp);
 #endif
         last_output_time_ = std::chrono::steady_clock::now();
-    })) {
+    }, kBackgroundTaskLaneAudioDecode)) {
         busy_decoding_audio_ = false;
     }
 }
@@ -872,10 +997,11 @@ void Application::OnAudioInput() {
                     packet.payload = std::move(opus);
                     packet.frame_duration = OPUS_FRAME_DURATION_MS;
                     packet.sample_rate = 16000;
+                    packet.session_id = kLocalAudioSession;
                     std::lock_guard<std::mutex> lock(mutex_);
                     audio_testing_queue_.push_back(std::move(packet));
                 });
-            });
+            }, kBackgroundTaskLaneAudioEncode);
             return;
         }
     }
@@ -954,8 +1080,21 @@ bool Application::ReadAudio(std::vector<int16_t>& data, int sample_rate, int sam
 
 void Application::AbortSpeaking(AbortReason reason) {
     ESP_LOGI(TAG, "Abort speaking");
-    aborted_ = true;
+    // Invalidate the current session, so queued, in-flight and late packets of this turn are dropped
+    audio_session_aborted_ = true;
+    audio_session_id_++;
     protocol_->SendAbortSpeaking(reason);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        audio_decode_queue_.clear();
+    }
+    audio_decode_cv_.notify_all();
+    if (background_task_->Cancel(kBackgroundTaskLaneAudioDecode) > 0) {
+        busy_decoding_audio_ = false;
+    }
+    background_task_->WaitForCompletion();
+    Board::GetInstance().GetAudioCodec()->FlushOutput();
 }
 
 void Application::SetListeningMode(ListeningMode mode) {
@@ -972,6 +1111,10 @@ void Application::SetDeviceState(DeviceState state) {
     auto previous_state = device_state_;
     device_state_ = state;
     ESP_LOGI(TAG, "STATE: %s", STATE_STRINGS[device_state_]);
+    // Audio that has not been decoded yet is stale once we stop speaking
+    if (previous_state == kDeviceStateSpeaking && background_task_->Cancel(kBackgroundTaskLaneAudioDecode) > 0) {
+        busy_decoding_audio_ = false;
+    }
     // The state is changed, wait for all background tasks to finish
     background_task_->WaitForCompletion();
 
@@ -982,20 +1125,21 @@ void Application::SetDeviceState(DeviceState state) {
     switch (state) {
         case kDeviceStateUnknown:
         case kDeviceStateIdle:
-            display->SetStatus(Lang::Strings::STANDBY);
-            display->SetEmotion("neutral");
+            display->PostStatus(Lang::Strings::STANDBY);
+            display->PostEmotion("neutral");
             audio_processor_->Stop();
+            WakeWordStats::GetInstance().OnSessionEnded();
             wake_word_->StartDetection();
             break;
         case kDeviceStateConnecting:
-            display->SetStatus(Lang::Strings::CONNECTING);
-            display->SetEmotion("neutral");
-            display->SetChatMessage("system", "");
+            display->PostStatus(Lang::Strings::CONNECTING);
+            display->PostEmotion("neutral");
+            display->PostChatMessage("system", "");
             timestamp_queue_.clear();
             break;
         case kDeviceStateListening:
-            display->SetStatus(Lang::Strings::LISTENING);
-            display->SetEmotion("neutral");
+            display->PostStatus(Lang::Strings::LISTENING);
+            display->PostEmotion("neutral");
             // Update the IoT states before sending the start listening command
 #if CONFIG_IOT_PROTOCOL_XIAOZHI
             UpdateIotStates();
@@ -1006,10 +1150,13 @@ void Application::SetDeviceState(DeviceState state) {
                 // Send the start listening command
                 protocol_->SendStartListening(listening_mode_);
                 if (previous_state == kDeviceStateSpeaking) {
-                    audio_decode_queue_.clear();
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        audio_decode_queue_.clear();
+                    }
                     audio_decode_cv_.notify_all();
-                    // FIXME: Wait for the speaker to empty the buffer
-                    vTaskDelay(pdMS_TO_TICKS(120));
+                    // Wait for the speaker to play the samples still in the DMA buffers
+                    board.GetAudioCodec()->WaitForOutputDrained();
                 }
                 opus_encoder_->ResetState();
                 audio_processor_->Start();
@@ -1017,7 +1164,7 @@ void Application::SetDeviceState(DeviceState state) {
             }
             break;
         case kDeviceStateSpeaking:
-            display->SetStatus(Lang::Strings::SPEAKING);
+            display->PostStatus(Lang::Strings::SPEAKING);
 
             if (listening_mode_ != kListeningModeRealtime) {
                 audio_processor_->Stop();
@@ -1126,15 +1273,15 @@ void Application::SetAecMode(AecMode mode) {
         switch (aec_mode_) {
         case kAecOff:
             audio_processor_->EnableDeviceAec(false);
-            display->ShowNotification(Lang::Strings::RTC_MODE_OFF);
+            display->PostNotification(Lang::Strings::RTC_MODE_OFF);
             break;
         case kAecOnServerSide:
             audio_processor_->EnableDeviceAec(false);
-            display->ShowNotification(Lang::Strings::RTC_MODE_ON);
+            display->PostNotification(Lang::Strings::RTC_MODE_ON);
             break;
         case kAecOnDeviceSide:
             audio_processor_->EnableDeviceAec(true);
-            display->ShowNotification(Lang::Strings::RTC_MODE_ON);
+            display->PostNotification(Lang::Strings::RTC_MODE_ON);
             break;
         }
 
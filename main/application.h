@@ -12,6 +12,7 @@
 #include <vector>
 #include <condition_variable>
 #include <memory>
+#include <atomic>
 
 #include <opus_encoder.h>
 #include <opus_decoder.h>
@@ -23,10 +24,11 @@
 #include "audio_processor.h"
 #include "wake_word.h"
 #include "audio_debugger.h"
+#include "inline_function.h"
 
 #define SCHEDULE_EVENT (1 << 0)
 #define SEND_AUDIO_EVENT (1 << 1)
-#define CHECK_NEW_VERSION_DONE_EVENT (1 << 2)
+#define AUDIO_PIPELINE_READY_EVENT (1 << 3)
 
 enum AecMode {
     kAecOff,
@@ -51,6 +53,10 @@ enum DeviceState {
 #define OPUS_FRAME_DURATION_MS 60
 #define MAX_AUDIO_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
+#define MAX_MAIN_TASKS 32
+
+// Callables up to 32 bytes (e.g. `this` and a couple of pointers) are stored without heap allocation
+using MainTask = InlineFunction<32>;
 
 class Application {
 public:
@@ -65,7 +71,8 @@ public:
     void Start();
     DeviceState GetDeviceState() const { return device_state_; }
     bool IsVoiceDetected() const { return voice_detected_; }
-    void Schedule(std::function<void()> callback);
+    // Returns false if the task queue is full and the task was dropped
+    bool Schedule(MainTask&& callback);
     void SetDeviceState(DeviceState state);
     void Alert(const char* status, const char* message, const char* emotion = "", const std::string_view& sound = "");
     void DismissAlert();
@@ -91,7 +98,12 @@ private:
     std::unique_ptr<AudioProcessor> audio_processor_;
     std::unique_ptr<AudioDebugger> audio_debugger_;
     std::mutex mutex_;
-    std::list<std::function<void()>> main_tasks_;
+    // Fixed-capacity ring of main loop tasks, multiple producers and the main loop as the consumer
+    MainTask main_tasks_[MAX_MAIN_TASKS];
+    int main_tasks_head_ = 0;
+    int main_tasks_count_ = 0;
+    uint32_t main_tasks_dropped_ = 0;
+    uint32_t main_tasks_dropped_reported_ = 0;
     std::unique_ptr<Protocol> protocol_;
     EventGroupHandle_t event_group_ = nullptr;
     esp_timer_handle_t clock_timer_handle_ = nullptr;
@@ -100,7 +112,11 @@ private:
     AecMode aec_mode_ = kAecOff;
 
     bool has_server_time_ = false;
-    bool aborted_ = false;
+    // Every TTS turn gets a new audio session, packets of older sessions are dropped.
+    // Local sounds use their own session, so a new TTS turn does not drop them
+    static constexpr uint32_t kLocalAudioSession = UINT32_MAX;
+    std::atomic<uint32_t> audio_session_id_ = 0;
+    std::atomic<bool> audio_session_aborted_ = false;
     bool voice_detected_ = false;
     bool busy_decoding_audio_ = false;
     int clock_ticks_ = 0;
@@ -133,6 +149,9 @@ private:
     void ResetDecoder();
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
     void CheckNewVersion(Ota& ota);
+    void CheckNewVersionInBackground();
+    void StartProtocol(Ota& ota);
+    void InitializeAudioPipeline();
     void ShowActivationCode(const std::string& code, const std::string& message);
     void OnClockTimer();
     void SetListeningMode(ListeningMode mode);
@@ -3,19 +3,83 @@
 #include "settings.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
 #include <cstring>
+#include <algorithm>
 #include <driver/i2s_common.h>
 
 #define TAG "AudioCodec"
 
 AudioCodec::AudioCodec() {
+    output_drained_ = xSemaphoreCreateBinary();
 }
 
 AudioCodec::~AudioCodec() {
+    vSemaphoreDelete(output_drained_);
+}
+
+// The driver's completed-buffer queue overflows only when a buffer finishes while all the others
+// are already free, i.e. everything written so far has been sent and the DMA is replaying silence
+static bool IRAM_ATTR OnSendQueueOverflow(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx) {
+    BaseType_t need_yield = pdFALSE;
+    xSemaphoreGiveFromISR((SemaphoreHandle_t)user_ctx, &need_yield);
+    return need_yield == pdTRUE;
+}
+
+void AudioCodec::RegisterOutputEvents() {
+    if (tx_handle_ == nullptr) {
+        return;
+    }
+    i2s_event_callbacks_t callbacks = {};
+    callbacks.on_send_q_ovf = OnSendQueueOverflow;
+    ESP_ERROR_CHECK_WITHOUT_ABORT(i2s_channel_register_event_callback(tx_handle_, &callbacks, output_drained_));
 }
 
 void AudioCodec::OutputData(std::vector<int16_t>& data) {
+    xSemaphoreTake(output_drained_, 0);
     Write(data.data(), data.size());
+    // Write() returns once the samples are queued, so at most the DMA buffers are still pending
+    int64_t dma_duration_us = int64_t(AUDIO_CODEC_DMA_DESC_NUM) * AUDIO_CODEC_DMA_FRAME_NUM * 1000000 / output_sample_rate_;
+    output_drained_time_ = esp_timer_get_time() + dma_duration_us;
+}
+
+void AudioCodec::FlushOutput() {
+    if (!output_enabled_) {
+        return;
+    }
+    if (duplex_) {
+        // Input and output share the I2S clock, let the codec driver stop and restart the output stream
+        EnableOutput(false);
+        EnableOutput(true);
+    } else if (tx_handle_ != nullptr) {
+        // The output has its own I2S controller, stop the DMA, overwrite the pending samples with silence and restart
+        static const uint8_t silence[512] = {0};
+        i2s_channel_disable(tx_handle_);
+        size_t loaded = 0;
+        do {
+            if (i2s_channel_preload_data(tx_handle_, silence, sizeof(silence), &loaded) != ESP_OK) {
+                break;
+            }
+        } while (loaded == sizeof(silence));
+        i2s_channel_enable(tx_handle_);
+    }
+    output_drained_time_ = 0;
+    xSemaphoreGive(output_drained_);
+}
+
+void AudioCodec::WaitForOutputDrained() {
+    if (!output_enabled_ || output_drained_time_ == 0) {
+        return;
+    }
+    // The estimate only bounds the wait in case the driver never reports, e.g. the output was closed meanwhile
+    int64_t remaining_us = output_drained_time_ - esp_timer_get_time();
+    TickType_t timeout = pdMS_TO_TICKS(std::max<int64_t>(remaining_us, 0) / 1000 + 100);
+    if (xSemaphoreTake(output_drained_, timeout) == pdTRUE) {
+        xSemaphoreGive(output_drained_);
+    } else {
+        ESP_LOGW(TAG, "Output drained event not received");
+    }
 }
 
 bool AudioCodec::InputData(std::vector<int16_t>& data) {
@@ -34,6 +98,7 @@ void AudioCodec::Start() {
         output_volume_ = 10;
     }
 
+    RegisterOutputEvents();
     ESP_ERROR_CHECK(i2s_channel_enable(tx_handle_));
     ESP_ERROR_CHECK(i2s_channel_enable(rx_handle_));
 
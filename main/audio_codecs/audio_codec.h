@@ -3,11 +3,13 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
+#include <freertos/semphr.h>
 #include <driver/i2s_std.h>
 
 #include <vector>
 #include <string>
 #include <functional>
+#include <atomic>
 
 #include "board.h"
 
@@ -27,6 +29,10 @@ public:
     virtual void OutputData(std::vector<int16_t>& data);
     virtual bool InputData(std::vector<int16_t>& data);
     virtual void Start();
+    // Drop the samples still queued in the output DMA buffers
+    virtual void FlushOutput();
+    // Block until the I2S driver reports that the samples written so far have been sent
+    void WaitForOutputDrained();
 
     inline bool duplex() const { return duplex_; }
     inline bool input_reference() const { return input_reference_; }
@@ -51,6 +57,13 @@ protected:
     int input_channels_ = 1;
     int output_channels_ = 1;
     int output_volume_ = 70;
+    // Written by the audio output thread, bounds WaitForOutputDrained() if the driver never reports
+    std::atomic<int64_t> output_drained_time_ = 0;
+    // Given by the I2S ISR once every DMA buffer has been sent and nothing new was written
+    SemaphoreHandle_t output_drained_ = nullptr;
+
+    // Call before enabling tx_handle_
+    void RegisterOutputEvents();
 
     virtual int Read(int16_t* dest, int samples) = 0;
     virtual int Write(const int16_t* data, int samples) = 0;
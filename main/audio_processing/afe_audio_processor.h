@@ -12,6 +12,7 @@
 
 #include "audio_processor.h"
 #include "audio_codec.h"
+#include "afe_front_end.h"
 
 class AfeAudioProcessor : public AudioProcessor {
 public:
@@ -30,14 +31,12 @@ public:
 
 private:
     EventGroupHandle_t event_group_ = nullptr;
-    esp_afe_sr_iface_t* afe_iface_ = nullptr;
-    esp_afe_sr_data_t* afe_data_ = nullptr;
     std::function<void(std::vector<int16_t>&& data)> output_callback_;
     std::function<void(bool speaking)> vad_state_change_callback_;
     AudioCodec* codec_ = nullptr;
     bool is_speaking_ = false;
 
-    void AudioProcessorTask();
+    void OnFetch(const afe_fetch_result_t* res);
 };
 
 #endif 
\ No newline at end of file
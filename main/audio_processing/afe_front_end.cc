@@ -0,0 +1,304 @@
+#include "afe_front_end.h"
+#include "settings.h"
+
+#include <esp_log.h>
+#include <cstring>
+#include <string>
+
+#define TAG "AfeFrontEnd"
+
+AfeFrontEnd::~AfeFrontEnd() {
+    if (afe_data_ != nullptr) {
+        afe_iface_->destroy(afe_data_);
+    }
+    if (uplink_data_ != nullptr) {
+        uplink_iface_->destroy(uplink_data_);
+    }
+}
+
+// 语音通话使用的 NS/VAD 配置
+void AfeFrontEnd::ConfigureUplink(afe_config_t* afe_config) {
+#if CONFIG_USE_AUDIO_PROCESSOR
+    char* ns_model_name = models_ != nullptr ? esp_srmodel_filter(models_, ESP_NSNET_PREFIX, NULL) : nullptr;
+    char* vad_model_name = models_ != nullptr ? esp_srmodel_filter(models_, ESP_VADN_PREFIX, NULL) : nullptr;
+    afe_config->vad_mode = VAD_MODE_0;
+    afe_config->vad_min_noise_ms = 100;
+    if (vad_model_name != nullptr) {
+        afe_config->vad_model_name = vad_model_name;
+    }
+
+    if (ns_model_name != nullptr) {
+        afe_config->ns_init = true;
+        afe_config->ns_model_name = ns_model_name;
+        afe_config->afe_ns_mode = AFE_NS_MODE_NET;
+    } else {
+        afe_config->ns_init = false;
+    }
+    afe_config->agc_init = false;
+
+#ifdef CONFIG_USE_DEVICE_AEC
+    afe_config->aec_init = true;
+    afe_config->vad_init = false;
+#else
+    afe_config->vad_init = true;
+#endif
+#endif
+}
+
+bool AfeFrontEnd::Initialize(AudioCodec* codec) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (afe_data_ != nullptr) {
+        return true;
+    }
+
+    codec_ = codec;
+    int ref_num = codec_->input_reference() ? 1 : 0;
+
+    std::string input_format;
+    for (int i = 0; i < codec_->input_channels() - ref_num; i++) {
+        input_format.push_back('M');
+    }
+    for (int i = 0; i < ref_num; i++) {
+        input_format.push_back('R');
+    }
+
+    models_ = esp_srmodel_init("model");
+    if (models_ != nullptr && models_->num == -1) {
+        models_ = nullptr;
+    }
+
+#if CONFIG_USE_AFE_WAKE_WORD
+    // WakeNet 必须有模型；只做语音通话时没有模型分区也能工作，不使用神经网络降噪
+    if (models_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to initialize models");
+        return false;
+    }
+    // 需要 WakeNet 时使用语音识别类型，没有单独的上行实例时处理后的音频同样用于通话上行
+    afe_config_t* afe_config = afe_config_init(input_format.c_str(), models_, AFE_TYPE_SR, AFE_MODE_HIGH_PERF);
+    afe_config->aec_init = codec_->input_reference();
+    afe_config->aec_mode = AEC_MODE_SR_HIGH_PERF;
+    // AFE 最多同时运行两个 WakeNet 模型，第一个由 afe_config_init 选择
+    if (afe_config->wakenet_model_name != nullptr) {
+        wakenet_models_.push_back(afe_config->wakenet_model_name);
+        for (int i = 0; i < models_->num; i++) {
+            char* name = models_->model_name[i];
+            if (strncmp(name, ESP_WN_PREFIX, strlen(ESP_WN_PREFIX)) == 0 && wakenet_models_[0] != name) {
+                afe_config->wakenet_model_name_2 = name;
+                wakenet_models_.push_back(name);
+                break;
+            }
+        }
+    }
+#else
+    afe_config_t* afe_config = afe_config_init(input_format.c_str(), NULL, AFE_TYPE_VC, AFE_MODE_HIGH_PERF);
+    afe_config->aec_init = false;
+    afe_config->aec_mode = AEC_MODE_VOIP_HIGH_PERF;
+#endif
+
+    ConfigureUplink(afe_config);
+    afe_config->afe_perferred_core = 1;
+    afe_config->afe_perferred_priority = 1;
+    afe_config->memory_alloc_mode = AFE_MEMORY_ALLOC_MORE_PSRAM;
+
+    afe_iface_ = esp_afe_handle_from_config(afe_config);
+    afe_data_ = afe_iface_->create_from_config(afe_config);
+
+#if CONFIG_USE_AFE_WAKE_WORD
+    // 灵敏度保存在 wake_word 命名空间，threshold_<序号> 为百分比，未设置时使用模型的默认阈值
+    Settings settings("wake_word");
+    for (size_t i = 0; i < wakenet_models_.size(); i++) {
+        int threshold = settings.GetInt("threshold_" + std::to_string(i));
+        if (threshold > 0 && threshold < 100) {
+            afe_iface_->set_wakenet_threshold(afe_data_, i + 1, threshold / 100.0f);
+        }
+        ESP_LOGI(TAG, "Wake word model %s, threshold: %d%%", wakenet_models_[i].c_str(), threshold);
+    }
+#endif
+
+    xTaskCreate([](void* arg) {
+        auto this_ = (AfeFrontEnd*)arg;
+        this_->AudioProcessingTask();
+        vTaskDelete(NULL);
+    }, "audio_front_end", 4096, this, 3, nullptr);
+
+#if AFE_SEPARATE_UPLINK
+    if (codec_->input_reference()) {
+        CreateUplinkInstance(input_format);
+    }
+#endif
+    return true;
+}
+
+// 与主实例相同的输入格式，不做 AEC，回声留给服务器端消除
+void AfeFrontEnd::CreateUplinkInstance(const std::string& input_format) {
+    afe_config_t* afe_config = afe_config_init(input_format.c_str(), models_, AFE_TYPE_VC, AFE_MODE_HIGH_PERF);
+    afe_config->aec_init = false;
+    afe_config->aec_mode = AEC_MODE_VOIP_HIGH_PERF;
+    afe_config->wakenet_init = false;
+    ConfigureUplink(afe_config);
+    afe_config->afe_perferred_core = 1;
+    afe_config->afe_perferred_priority = 1;
+    afe_config->memory_alloc_mode = AFE_MEMORY_ALLOC_MORE_PSRAM;
+
+    uplink_iface_ = esp_afe_handle_from_config(afe_config);
+    uplink_data_ = uplink_iface_->create_from_config(afe_config);
+    if (uplink_data_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create uplink AFE, the uplink shares the wake word AFE");
+        return;
+    }
+    // 两个实例送入同一帧数据，块大小必须一致
+    if (uplink_iface_->get_feed_chunksize(uplink_data_) != afe_iface_->get_feed_chunksize(afe_data_)) {
+        ESP_LOGE(TAG, "Uplink AFE feed size mismatch, the uplink shares the wake word AFE");
+        uplink_iface_->destroy(uplink_data_);
+        uplink_data_ = nullptr;
+        return;
+    }
+    // 主实例只用于唤醒词，不再需要通话用的降噪和 VAD
+    afe_iface_->disable_ns(afe_data_);
+    afe_iface_->disable_vad(afe_data_);
+
+    xTaskCreate([](void* arg) {
+        auto this_ = (AfeFrontEnd*)arg;
+        this_->UplinkProcessingTask();
+        vTaskDelete(NULL);
+    }, "audio_uplink", 4096, this, 3, nullptr);
+}
+
+size_t AfeFrontEnd::GetFeedSize() {
+    if (afe_data_ == nullptr) {
+        return 0;
+    }
+    return afe_iface_->get_feed_chunksize(afe_data_) * codec_->input_channels();
+}
+
+void AfeFrontEnd::Feed(const std::vector<int16_t>& data) {
+    Feed(data.data());
+}
+
+// 有单独的上行实例时，主实例只在唤醒词检测期间需要数据
+void AfeFrontEnd::Feed(const int16_t* data) {
+    if (afe_data_ == nullptr) {
+        return;
+    }
+    if (uplink_data_ == nullptr) {
+        afe_iface_->feed(afe_data_, data);
+        return;
+    }
+    if (wakenet_enabled_) {
+        afe_iface_->feed(afe_data_, data);
+    }
+    if (uplink_active_) {
+        uplink_iface_->feed(uplink_data_, data);
+    }
+}
+
+void AfeFrontEnd::OnFetch(std::function<void(const afe_fetch_result_t* result)> callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fetch_callbacks_.push_back(callback);
+}
+
+void AfeFrontEnd::OnUplinkFetch(std::function<void(const afe_fetch_result_t* result)> callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uplink_callbacks_.push_back(callback);
+}
+
+// 没有使用方时 Application 不再送入音频，处理任务阻塞在 fetch 上，不需要单独的运行标志
+void AfeFrontEnd::AudioProcessingTask() {
+    auto fetch_size = afe_iface_->get_fetch_chunksize(afe_data_);
+    auto feed_size = afe_iface_->get_feed_chunksize(afe_data_);
+    ESP_LOGI(TAG, "Audio processing task started, feed size: %d fetch size: %d",
+        feed_size, fetch_size);
+
+    // 回调在锁外执行，回调中可以再调用前端的其它接口；复用同一个列表，稳定后不再分配内存
+    std::vector<std::function<void(const afe_fetch_result_t* result)>> callbacks;
+    while (true) {
+        auto res = afe_iface_->fetch_with_delay(afe_data_, portMAX_DELAY);
+        if (res == nullptr || res->ret_value == ESP_FAIL) {
+            if (res != nullptr) {
+                ESP_LOGI(TAG, "Error code: %d", res->ret_value);
+            }
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            callbacks = fetch_callbacks_;
+            if (uplink_data_ == nullptr) {
+                callbacks.insert(callbacks.end(), uplink_callbacks_.begin(), uplink_callbacks_.end());
+            }
+        }
+        for (auto& callback : callbacks) {
+            callback(res);
+        }
+    }
+}
+
+void AfeFrontEnd::UplinkProcessingTask() {
+    ESP_LOGI(TAG, "Uplink processing task started, feed size: %d fetch size: %d",
+        uplink_iface_->get_feed_chunksize(uplink_data_), uplink_iface_->get_fetch_chunksize(uplink_data_));
+
+    std::vector<std::function<void(const afe_fetch_result_t* result)>> callbacks;
+    while (true) {
+        auto res = uplink_iface_->fetch_with_delay(uplink_data_, portMAX_DELAY);
+        if (res == nullptr || res->ret_value == ESP_FAIL) {
+            if (res != nullptr) {
+                ESP_LOGI(TAG, "Uplink error code: %d", res->ret_value);
+            }
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            callbacks = uplink_callbacks_;
+        }
+        for (auto& callback : callbacks) {
+            callback(res);
+        }
+    }
+}
+
+void AfeFrontEnd::EnableWakeNet(bool enable) {
+    wakenet_enabled_ = enable;
+#if CONFIG_USE_AFE_WAKE_WORD
+    if (afe_data_ == nullptr) {
+        return;
+    }
+    if (enable) {
+        afe_iface_->enable_wakenet(afe_data_);
+    } else {
+        afe_iface_->disable_wakenet(afe_data_);
+    }
+#endif
+}
+
+void AfeFrontEnd::EnableDeviceAec(bool enable) {
+    if (afe_data_ == nullptr) {
+        return;
+    }
+    if (enable) {
+#if CONFIG_USE_DEVICE_AEC
+        afe_iface_->disable_vad(afe_data_);
+        afe_iface_->enable_aec(afe_data_);
+#else
+        ESP_LOGE(TAG, "Device AEC is not supported");
+#endif
+    } else {
+        // 唤醒词检测需要用参考信号消除设备自身播放的声音，此时 AEC 保持创建时的状态
+#if !CONFIG_USE_AFE_WAKE_WORD
+        afe_iface_->disable_aec(afe_data_);
+#endif
+        if (uplink_data_ != nullptr) {
+            uplink_iface_->enable_vad(uplink_data_);
+        } else {
+            afe_iface_->enable_vad(afe_data_);
+        }
+    }
+}
+
+// 单独的上行实例在开始时清空上次残留的音频，停止后不再送入数据，处理任务阻塞在 fetch 上
+void AfeFrontEnd::SetUplinkActive(bool active) {
+    if (active && uplink_data_ != nullptr) {
+        uplink_iface_->reset_buffer(uplink_data_);
+    }
+    uplink_active_ = active;
+}
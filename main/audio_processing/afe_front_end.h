@@ -0,0 +1,78 @@
+#ifndef AFE_FRONT_END_H
+#define AFE_FRONT_END_H
+
+#include <esp_afe_sr_models.h>
+#include <model_path.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+
+#include "audio_codec.h"
+
+// 服务器端 AEC 需要未经消除的上行音频，而唤醒词仍需消除设备自身播放的声音，
+// 此时上行使用单独的不带 AEC 的 AFE 实例
+#if CONFIG_USE_AFE_WAKE_WORD && CONFIG_USE_SERVER_AEC && !CONFIG_USE_DEVICE_AEC
+#define AFE_SEPARATE_UPLINK 1
+#endif
+
+// 唤醒词检测与语音通话共用的 AFE 前端，AEC/NS/VAD 每帧只运行一次，处理结果依次交给各个使用方。
+// 使用方启停时不清空缓冲区，说话过程中也能连续检测唤醒词
+class AfeFrontEnd {
+public:
+    static AfeFrontEnd& GetInstance() {
+        static AfeFrontEnd instance;
+        return instance;
+    }
+
+    // Delete copy constructor and assignment operator
+    AfeFrontEnd(const AfeFrontEnd&) = delete;
+    AfeFrontEnd& operator=(const AfeFrontEnd&) = delete;
+
+    // 可以重复调用，只在第一次调用时创建 AFE 和处理任务
+    bool Initialize(AudioCodec* codec);
+    void Feed(const std::vector<int16_t>& data);
+    // data 为 GetFeedSize 个采样
+    void Feed(const int16_t* data);
+    size_t GetFeedSize();
+    // 在处理任务中调用，使用方自行判断是否需要这一帧
+    void OnFetch(std::function<void(const afe_fetch_result_t* result)> callback);
+    // 上行使用的处理结果，没有单独的上行实例时与 OnFetch 相同
+    void OnUplinkFetch(std::function<void(const afe_fetch_result_t* result)> callback);
+    void EnableWakeNet(bool enable);
+    void EnableDeviceAec(bool enable);
+    // 语音上行开始和结束时调用
+    void SetUplinkActive(bool active);
+    // 上行需要每一帧的处理结果，此时唤醒词不能跳过送入
+    bool IsUplinkActive() const { return uplink_active_; }
+    srmodel_list_t* models() const { return models_; }
+    // AFE 中运行的 WakeNet 模型，按 fetch 结果中 wakenet_model_index 的顺序
+    const std::vector<std::string>& wakenet_models() const { return wakenet_models_; }
+
+private:
+    AfeFrontEnd() = default;
+    ~AfeFrontEnd();
+
+    std::mutex mutex_;
+    esp_afe_sr_iface_t* afe_iface_ = nullptr;
+    esp_afe_sr_data_t* afe_data_ = nullptr;
+    srmodel_list_t* models_ = nullptr;
+    std::vector<std::string> wakenet_models_;
+    std::atomic<bool> uplink_active_ = false;
+    std::atomic<bool> wakenet_enabled_ = false;
+    AudioCodec* codec_ = nullptr;
+    std::vector<std::function<void(const afe_fetch_result_t* result)>> fetch_callbacks_;
+    std::vector<std::function<void(const afe_fetch_result_t* result)>> uplink_callbacks_;
+    // 单独的上行实例，只在 AFE_SEPARATE_UPLINK 且有参考信号时创建
+    esp_afe_sr_iface_t* uplink_iface_ = nullptr;
+    esp_afe_sr_data_t* uplink_data_ = nullptr;
+
+    void ConfigureUplink(afe_config_t* afe_config);
+    void CreateUplinkInstance(const std::string& input_format);
+    void AudioProcessingTask();
+    void UplinkProcessingTask();
+};
+
+#endif
@@ -1,7 +1,9 @@
 #include "afe_wake_word.h"
 #include "application.h"
+#include "wake_word_stats.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <model_path.h>
 #include <arpa/inet.h>
 #include <sstream>
@@ -11,18 +13,13 @@
 #define TAG "AfeWakeWord"
 
 AfeWakeWord::AfeWakeWord()
-    : afe_data_(nullptr),
-      wake_word_pcm_(),
+    : wake_word_pcm_(),
       wake_word_opus_() {
 
     event_group_ = xEventGroupCreate();
 }
 
 AfeWakeWord::~AfeWakeWord() {
-    if (afe_data_ != nullptr) {
-        afe_iface_->destroy(afe_data_);
-    }
-
     if (wake_word_encode_task_stack_ != nullptr) {
         heap_caps_free(wake_word_encode_task_stack_);
     }
@@ -32,49 +29,37 @@ AfeWakeWord::~AfeWakeWord() {
 
 void AfeWakeWord::Initialize(AudioCodec* codec) {
     codec_ = codec;
-    int ref_num = codec_->input_reference() ? 1 : 0;
-
-    srmodel_list_t *models = esp_srmodel_init("model");
-    if (models == nullptr || models->num == -1) {
+    auto& front_end = AfeFrontEnd::GetInstance();
+    front_end.OnFetch([this](const afe_fetch_result_t* res) {
+        OnFetch(res);
+    });
+    if (!front_end.Initialize(codec)) {
         ESP_LOGE(TAG, "Failed to initialize wakenet model");
         return;
     }
+
+    srmodel_list_t *models = front_end.models();
     for (int i = 0; i < models->num; i++) {
         ESP_LOGI(TAG, "Model %d: %s", i, models->model_name[i]);
-        if (strstr(models->model_name[i], ESP_WN_PREFIX) != NULL) {
-            wakenet_model_ = models->model_name[i];
-            auto words = esp_srmodel_get_wake_words(models, wakenet_model_);
-            // split by ";" to get all wake words
-            std::stringstream ss(words);
-            std::string word;
-            while (std::getline(ss, word, ';')) {
-                wake_words_.push_back(word);
-            }
+    }
+    for (auto& model : front_end.wakenet_models()) {
+        auto words = esp_srmodel_get_wake_words(models, (char*)model.c_str());
+        // split by ";" to get all wake words
+        std::vector<std::string> model_words;
+        std::stringstream ss(words != nullptr ? words : "");
+        std::string word;
+        while (std::getline(ss, word, ';')) {
+            model_words.push_back(word);
         }
+        wake_words_.push_back(std::move(model_words));
     }
 
-    std::string input_format;
-    for (int i = 0; i < codec_->input_channels() - ref_num; i++) {
-        input_format.push_back('M');
-    }
-    for (int i = 0; i < ref_num; i++) {
-        input_format.push_back('R');
-    }
-    afe_config_t* afe_config = afe_config_init(input_format.c_str(), models, AFE_TYPE_SR, AFE_MODE_HIGH_PERF);
-    afe_config->aec_init = codec_->input_reference();
-    afe_config->aec_mode = AEC_MODE_SR_HIGH_PERF;
-    afe_config->afe_perferred_core = 1;
-    afe_config->afe_perferred_priority = 1;
-    afe_config->memory_alloc_mode = AFE_MEMORY_ALLOC_MORE_PSRAM;
-    
-    afe_iface_ = esp_afe_handle_from_config(afe_config);
-    afe_data_ = afe_iface_->create_from_config(afe_config);
-
-    xTaskCreate([](void* arg) {
-        auto this_ = (AfeWakeWord*)arg;
-        this_->AudioDetectionTask();
-        vTaskDelete(NULL);
-    }, "audio_detection", 4096, this, 3, nullptr);
+    int channels = codec->input_channels();
+    size_t feed_size = front_end.GetFeedSize();
+    frame_duration_us_ = (int64_t)(feed_size / channels) * 1000000 / 16000;
+    gate_.Initialize(channels, feed_size, frame_duration_us_);
+    // 检测开始前不运行 WakeNet
+    front_end.EnableWakeNet(IsDetectionRunning());
 }
 
 void AfeWakeWord::OnWakeWordDetected(std::function<void(const std::string& wake_word)> callback) {
@@ -83,13 +68,12 @@ void AfeWakeWord::OnWakeWordDetected(std::function<void(const std::string& wake_
 
 void AfeWakeWord::StartDetection() {
     xEventGroupSetBits(event_group_, DETECTION_RUNNING_EVENT);
+    AfeFrontEnd::GetInstance().EnableWakeNet(true);
 }
 
 void AfeWakeWord::StopDetection() {
     xEventGroupClearBits(event_group_, DETECTION_RUNNING_EVENT);
-    if (afe_data_ != nullptr) {
-        afe_iface_->reset_buffer(afe_data_);
-    }
+    AfeFrontEnd::GetInstance().EnableWakeNet(false);
 }
 
 bool AfeWakeWord::IsDetectionRunning() {
@@ -97,43 +81,55 @@ bool AfeWakeWord::IsDetectionRunning() {
 }
 
 void AfeWakeWord::Feed(const std::vector<int16_t>& data) {
-    if (afe_data_ == nullptr) {
+    auto& front_end = AfeFrontEnd::GetInstance();
+    // 通话上行也在使用处理结果，每一帧都要送入
+    if (front_end.IsUplinkActive()) {
+        gate_.Reset();
+        front_end.Feed(data);
         return;
     }
-    afe_iface_->feed(afe_data_, data.data());
+
+    bool opened = false;
+    bool inferred = gate_.Process(data, opened);
+    WakeWordStats::GetInstance().AddFrame(inferred, frame_duration_us_);
+    if (!inferred) {
+        return;
+    }
+    if (opened) {
+        // 门限刚打开，先补上之前的音频，避免丢失唤醒词开头
+        while (auto frame = gate_.PopPreroll()) {
+            front_end.Feed(frame);
+        }
+    }
+    front_end.Feed(data);
 }
 
 size_t AfeWakeWord::GetFeedSize() {
-    if (afe_data_ == nullptr) {
-        return 0;
-    }
-    return afe_iface_->get_feed_chunksize(afe_data_) * codec_->input_channels();
+    return AfeFrontEnd::GetInstance().GetFeedSize();
 }
 
-void AfeWakeWord::AudioDetectionTask() {
-    auto fetch_size = afe_iface_->get_fetch_chunksize(afe_data_);
-    auto feed_size = afe_iface_->get_feed_chunksize(afe_data_);
-    ESP_LOGI(TAG, "Audio detection task started, feed size: %d fetch size: %d",
-        feed_size, fetch_size);
+// 在前端的处理任务中调用，与通话上行使用同一帧处理结果
+void AfeWakeWord::OnFetch(const afe_fetch_result_t* res) {
+    if (!IsDetectionRunning()) {
+        return;
+    }
 
-    while (true) {
-        xEventGroupWaitBits(event_group_, DETECTION_RUNNING_EVENT, pdFALSE, pdTRUE, portMAX_DELAY);
+    // Store the wake word data for voice recognition, like who is speaking
+    StoreWakeWordData(res->data, res->data_size / sizeof(int16_t));
 
-        auto res = afe_iface_->fetch_with_delay(afe_data_, portMAX_DELAY);
-        if (res == nullptr || res->ret_value == ESP_FAIL) {
-            continue;;
+    if (res->wakeup_state == WAKENET_DETECTED) {
+        StopDetection();
+        size_t model = res->wakenet_model_index > 0 ? res->wakenet_model_index - 1 : 0;
+        size_t word = res->wake_word_index > 0 ? res->wake_word_index - 1 : 0;
+        if (model < wake_words_.size() && word < wake_words_[model].size()) {
+            last_detected_wake_word_ = wake_words_[model][word];
         }
+        auto& models = AfeFrontEnd::GetInstance().wakenet_models();
+        WakeWordStats::GetInstance().OnDetected(model < models.size() ? models[model] : std::string(),
+            esp_timer_get_time() - gate_.open_time());
 
-        // Store the wake word data for voice recognition, like who is speaking
-        StoreWakeWordData(res->data, res->data_size / sizeof(int16_t));
-
-        if (res->wakeup_state == WAKENET_DETECTED) {
-            StopDetection();
-            last_detected_wake_word_ = wake_words_[res->wake_word_index - 1];
-
-            if (wake_word_detected_callback_) {
-                wake_word_detected_callback_(last_detected_wake_word_);
-            }
+        if (wake_word_detected_callback_) {
+            wake_word_detected_callback_(last_detected_wake_word_);
         }
     }
 }
@@ -17,7 +17,10 @@
 
 #include "audio_codec.h"
 #include "wake_word.h"
+#include "afe_front_end.h"
+#include "wake_word_gate.h"
 
+// 送入 AFE 前先经过能量门限，安静时不送入音频，AFE 的处理任务阻塞在 fetch 上不占用 CPU
 class AfeWakeWord : public WakeWord {
 public:
     AfeWakeWord();
@@ -35,10 +38,10 @@ public:
     const std::string& GetLastDetectedWakeWord() const { return last_detected_wake_word_; }
 
 private:
-    esp_afe_sr_iface_t* afe_iface_ = nullptr;
-    esp_afe_sr_data_t* afe_data_ = nullptr;
-    char* wakenet_model_ = NULL;
-    std::vector<std::string> wake_words_;
+    // 每个 WakeNet 模型的唤醒词，按 fetch 结果中的模型序号和唤醒词序号查找
+    std::vector<std::vector<std::string>> wake_words_;
+    WakeWordGate gate_;
+    int64_t frame_duration_us_ = 0;
     EventGroupHandle_t event_group_;
     std::function<void(const std::string& wake_word)> wake_word_detected_callback_;
     AudioCodec* codec_ = nullptr;
@@ -53,7 +56,7 @@ private:
     std::condition_variable wake_word_cv_;
 
     void StoreWakeWordData(const int16_t* data, size_t size);
-    void AudioDetectionTask();
+    void OnFetch(const afe_fetch_result_t* res);
 };
 
 #endif
@@ -1,9 +1,14 @@
 #include "esp_wake_word.h"
 #include "application.h"
+#include "settings.h"
+#include "wake_word_stats.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <model_path.h>
 #include <arpa/inet.h>
+#include <cstring>
+#include <algorithm>
 #include <sstream>
 
 #define DETECTION_RUNNING_EVENT 1
@@ -15,8 +20,10 @@ EspWakeWord::EspWakeWord() {
 }
 
 EspWakeWord::~EspWakeWord() {
-    if (wakenet_data_ != nullptr) {
-        wakenet_iface_->destroy(wakenet_data_);
+    for (auto& model : models_) {
+        model.iface->destroy(model.data);
+    }
+    if (wakenet_model_ != nullptr) {
         esp_srmodel_deinit(wakenet_model_);
     }
 
@@ -31,19 +38,53 @@ void EspWakeWord::Initialize(AudioCodec* codec) {
         ESP_LOGE(TAG, "Failed to initialize wakenet model");
         return;
     }
-    if(wakenet_model_->num > 1) {
-        ESP_LOGW(TAG, "More than one model found, using the first one");
-    } else if (wakenet_model_->num == 0) {
+
+    // 灵敏度保存在 wake_word 命名空间，threshold_<序号> 为百分比，未设置时使用模型的默认阈值
+    Settings settings("wake_word");
+    for (int i = 0; i < wakenet_model_->num; i++) {
+        char *model_name = wakenet_model_->model_name[i];
+        if (strncmp(model_name, ESP_WN_PREFIX, strlen(ESP_WN_PREFIX)) != 0) {
+            continue;
+        }
+        WakeNetModel model;
+        model.name = model_name;
+        model.iface = (esp_wn_iface_t*)esp_wn_handle_from_name(model_name);
+        if (model.iface == nullptr) {
+            ESP_LOGW(TAG, "Unsupported wakenet model: %s", model_name);
+            continue;
+        }
+        model.data = model.iface->create(model_name, DET_MODE_95);
+        if (model.data == nullptr) {
+            ESP_LOGE(TAG, "Failed to create wakenet model: %s", model_name);
+            continue;
+        }
+
+        int chunk_size = model.iface->get_samp_chunksize(model.data);
+        if (chunk_size_ == 0) {
+            chunk_size_ = chunk_size;
+            chunk_duration_us_ = (int64_t)chunk_size * 1000000 / model.iface->get_samp_rate(model.data);
+        } else if (chunk_size != chunk_size_) {
+            // 所有模型共用同一帧音频
+            ESP_LOGW(TAG, "Skip %s, chunk size %d differs from %d", model_name, chunk_size, chunk_size_);
+            model.iface->destroy(model.data);
+            continue;
+        }
+
+        int threshold = settings.GetInt("threshold_" + std::to_string(models_.size()));
+        if (threshold > 0 && threshold < 100) {
+            for (int word = 1; word <= model.iface->get_word_num(model.data); word++) {
+                model.iface->set_det_threshold(model.data, threshold / 100.0f, word);
+            }
+        }
+        ESP_LOGI(TAG, "Wake word(%s), chunksize: %d, threshold: %d%%", model_name, chunk_size, threshold);
+        models_.push_back(model);
+    }
+
+    if (models_.empty()) {
         ESP_LOGE(TAG, "No model found");
         return;
     }
-    char *model_name = wakenet_model_->model_name[0];
-    wakenet_iface_ = (esp_wn_iface_t*)esp_wn_handle_from_name(model_name);
-    wakenet_data_ = wakenet_iface_->create(model_name, DET_MODE_95);
-
-    int frequency = wakenet_iface_->get_samp_rate(wakenet_data_);
-    int audio_chunksize = wakenet_iface_->get_samp_chunksize(wakenet_data_);
-    ESP_LOGI(TAG, "Wake word(%s),freq: %d, chunksize: %d", model_name, frequency, audio_chunksize);
+    gate_.Initialize(codec_->input_channels(), GetFeedSize(), chunk_duration_us_);
 }
 
 void EspWakeWord::OnWakeWordDetected(std::function<void(const std::string& wake_word)> callback) {
@@ -62,23 +103,62 @@ bool EspWakeWord::IsDetectionRunning() {
     return xEventGroupGetBits(event_group_) & DETECTION_RUNNING_EVENT;
 }
 
-void EspWakeWord::Feed(const std::vector<int16_t>& data) {
-    int res = wakenet_iface_->detect(wakenet_data_, (int16_t *)data.data());
-    if (res > 0) {
-        StopDetection();
-        last_detected_wake_word_ = wakenet_iface_->get_word_name(wakenet_data_, res);
+bool EspWakeWord::Detect(const int16_t* data) {
+    int64_t start_time = esp_timer_get_time();
+    auto& stats = WakeWordStats::GetInstance();
+    for (auto& model : models_) {
+        int res = model.iface->detect(model.data, (int16_t *)data);
+        if (res <= 0) {
+            continue;
+        }
 
+        int64_t now = esp_timer_get_time();
+        stats.AddInferenceTime(now - start_time);
+        stats.OnDetected(model.name, now - gate_.open_time());
+        last_detected_wake_word_ = model.iface->get_word_name(model.data, res);
+        ESP_LOGI(TAG, "Wake word %s detected by %s", last_detected_wake_word_.c_str(), model.name.c_str());
+
+        StopDetection();
+        gate_.Reset();
         if (wake_word_detected_callback_) {
             wake_word_detected_callback_(last_detected_wake_word_);
         }
+        return true;
+    }
+    stats.AddInferenceTime(esp_timer_get_time() - start_time);
+    return false;
+}
+
+void EspWakeWord::Feed(const std::vector<int16_t>& data) {
+    if (models_.empty()) {
+        return;
+    }
+
+    bool opened = false;
+    bool inferred = gate_.Process(data, opened);
+    WakeWordStats::GetInstance().AddFrame(inferred, chunk_duration_us_);
+    if (!inferred) {
+        return;
+    }
+    if (opened) {
+        // 门限刚打开，清空模型状态后先补上之前的音频
+        for (auto& model : models_) {
+            model.iface->clean(model.data);
+        }
+        while (auto frame = gate_.PopPreroll()) {
+            if (Detect(frame)) {
+                return;
+            }
+        }
     }
+    Detect(data.data());
 }
 
 size_t EspWakeWord::GetFeedSize() {
-    if (wakenet_data_ == nullptr) {
+    if (models_.empty()) {
         return 0;
     }
-    return wakenet_iface_->get_samp_chunksize(wakenet_data_) * codec_->input_channels();
+    return chunk_size_ * codec_->input_channels();
 }
 
 void EspWakeWord::EncodeWakeWordData() {
@@ -18,7 +18,10 @@
 
 #include "audio_codec.h"
 #include "wake_word.h"
+#include "wake_word_gate.h"
 
+// 同时运行模型分区中的所有 WakeNet 模型，每个模型可单独设置灵敏度
+// 先用能量门限判断是否有声音，只在有声音的片段上运行模型推理
 class EspWakeWord : public WakeWord {
 public:
     EspWakeWord();
@@ -36,14 +39,24 @@ public:
     const std::string& GetLastDetectedWakeWord() const { return last_detected_wake_word_; }
 
 private:
-    esp_wn_iface_t *wakenet_iface_ = nullptr;
-    model_iface_data_t *wakenet_data_ = nullptr;
+    struct WakeNetModel {
+        std::string name;
+        esp_wn_iface_t* iface = nullptr;
+        model_iface_data_t* data = nullptr;
+    };
+
+    std::vector<WakeNetModel> models_;
     srmodel_list_t *wakenet_model_ = nullptr;
     EventGroupHandle_t event_group_;
     AudioCodec* codec_ = nullptr;
+    int chunk_size_ = 0;
+    int64_t chunk_duration_us_ = 0;
+    WakeWordGate gate_;
 
     std::function<void(const std::string& wake_word)> wake_word_detected_callback_;
     std::string last_detected_wake_word_;
+
+    bool Detect(const int16_t* data);
 };
 
 #endif
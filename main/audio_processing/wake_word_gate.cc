@@ -0,0 +1,111 @@
+#include "wake_word_gate.h"
+
+#include <esp_timer.h>
+#include <sdkconfig.h>
+
+#include <algorithm>
+#include <cstring>
+
+// 帧能量（均方值）超过噪声底的倍数时视为有声，4 倍约为 6 dB
+#define GATE_RATIO              4.0f
+// 低于此能量（约 100 的幅度）一律视为静音
+#define GATE_MIN_ENERGY         (100.0f * 100.0f)
+// 最后一帧有声后继续推理的时间，覆盖唤醒词中的短暂停顿
+#define GATE_HANGOVER_MS        1500
+// 门限打开时补给模型的历史音频
+#define GATE_PREROLL_MS         300
+
+void WakeWordGate::Initialize(int channels, size_t frame_samples, int64_t frame_duration_us) {
+    channels_ = std::max(channels, 1);
+    frame_samples_ = frame_samples;
+    frame_duration_us_ = frame_duration_us;
+    noise_floor_ = GATE_MIN_ENERGY;
+#if CONFIG_USE_WAKE_WORD_GATE
+    if (frame_duration_us_ > 0) {
+        preroll_capacity_ = std::max<int64_t>(1, GATE_PREROLL_MS * 1000 / frame_duration_us_);
+        preroll_.resize(preroll_capacity_ * frame_samples_);
+    }
+#endif
+    Reset();
+}
+
+void WakeWordGate::Reset() {
+    open_ = false;
+    preroll_head_ = 0;
+    preroll_count_ = 0;
+}
+
+// 噪声底在静音时跟随较快，有声时极慢地上升，避免持续的背景噪声让门限一直打开
+bool WakeWordGate::IsVoiced(const std::vector<int16_t>& data) {
+    int64_t sum = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < data.size(); i += channels_) {
+        sum += (int32_t)data[i] * data[i];
+        count++;
+    }
+    float energy = count > 0 ? (float)sum / count : 0;
+
+    bool voiced = energy > std::max(noise_floor_ * GATE_RATIO, GATE_MIN_ENERGY);
+    if (!voiced) {
+        noise_floor_ += (energy - noise_floor_) * (energy < noise_floor_ ? 0.25f : 0.02f);
+    } else {
+        noise_floor_ += (energy - noise_floor_) * 0.002f;
+    }
+    return voiced;
+}
+
+// 缓冲区满时覆盖最旧的一帧
+void WakeWordGate::StorePreroll(const std::vector<int16_t>& data) {
+    if (preroll_capacity_ == 0 || data.size() != frame_samples_) {
+        return;
+    }
+    size_t index = (preroll_head_ + preroll_count_) % preroll_capacity_;
+    memcpy(&preroll_[index * frame_samples_], data.data(), frame_samples_ * sizeof(int16_t));
+    if (preroll_count_ < preroll_capacity_) {
+        preroll_count_++;
+    } else {
+        preroll_head_ = (preroll_head_ + 1) % preroll_capacity_;
+    }
+}
+
+const int16_t* WakeWordGate::PopPreroll() {
+    if (preroll_count_ == 0) {
+        return nullptr;
+    }
+    auto frame = &preroll_[preroll_head_ * frame_samples_];
+    preroll_head_ = (preroll_head_ + 1) % preroll_capacity_;
+    preroll_count_--;
+    return frame;
+}
+
+bool WakeWordGate::Process(const std::vector<int16_t>& data, bool& opened) {
+    int64_t now = esp_timer_get_time();
+    opened = false;
+#if CONFIG_USE_WAKE_WORD_GATE
+    // 检测暂停过（例如对话期间），之前的音频已无效
+    if (now - last_process_time_ > frame_duration_us_ * 4) {
+        Reset();
+    }
+    last_process_time_ = now;
+
+    bool voiced = IsVoiced(data);
+    if (!open_) {
+        if (!voiced) {
+            StorePreroll(data);
+            return false;
+        }
+        open_ = true;
+        open_time_ = now;
+        opened = true;
+    }
+
+    if (voiced) {
+        last_voiced_time_ = now;
+    } else if (now - last_voiced_time_ > GATE_HANGOVER_MS * 1000LL) {
+        open_ = false;
+    }
+#else
+    open_time_ = now;
+#endif
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef WAKE_WORD_GATE_H
+#define WAKE_WORD_GATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 唤醒词模型前的能量门限：只看第一个声道的均方能量，与缓慢跟踪的噪声底比较，
+// 只有有声音的片段才送入模型。门限关闭时最近的一小段音频保存在固定大小的环形缓冲区中，
+// 打开时先补给模型，避免丢失唤醒词开头
+class WakeWordGate {
+public:
+    // frame_samples 为每帧的采样数（包含所有声道），每帧大小必须相同
+    void Initialize(int channels, size_t frame_samples, int64_t frame_duration_us);
+    // 返回本帧是否需要送入模型。门限刚打开时 opened 为 true，调用方应先用 PopPreroll 取出之前的音频
+    bool Process(const std::vector<int16_t>& data, bool& opened);
+    // 按时间顺序取出预录的一帧，没有时返回 nullptr，指针在下一次 Process 前有效
+    const int16_t* PopPreroll();
+    // 音频不再连续时调用，门限关闭并丢弃预录的音频
+    void Reset();
+    // 门限最近一次打开（开始说话）的时刻
+    int64_t open_time() const { return open_time_; }
+
+private:
+    int channels_ = 1;
+    size_t frame_samples_ = 0;
+    int64_t frame_duration_us_ = 0;
+    float noise_floor_ = 0;
+    bool open_ = false;
+    std::atomic<int64_t> open_time_ = 0;
+    int64_t last_voiced_time_ = 0;
+    int64_t last_process_time_ = 0;
+
+    std::vector<int16_t> preroll_;
+    size_t preroll_capacity_ = 0;
+    size_t preroll_head_ = 0;
+    size_t preroll_count_ = 0;
+
+    bool IsVoiced(const std::vector<int16_t>& data);
+    void StorePreroll(const std::vector<int16_t>& data);
+};
+
+#endif // WAKE_WORD_GATE_H
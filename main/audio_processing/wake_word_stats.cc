@@ -0,0 +1,79 @@
+#include "wake_word_stats.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define STATS_INTERVAL_MS       (5 * 60 * 1000)
+
+#define TAG "WakeWordStats"
+
+void WakeWordStats::AddFrame(bool inferred, int64_t duration_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    total_frames_++;
+    if (inferred) {
+        inferred_frames_++;
+    }
+    audio_us_ += duration_us;
+
+    int64_t now = esp_timer_get_time();
+    if (now - last_log_time_ > STATS_INTERVAL_MS * 1000LL) {
+        if (last_log_time_ > 0) {
+            LogStats();
+        }
+        last_log_time_ = now;
+    }
+}
+
+void WakeWordStats::AddInferenceTime(int64_t us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    inference_us_ += us;
+}
+
+void WakeWordStats::OnDetected(const std::string& model, int64_t latency_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    detections_++;
+    total_latency_us_ += latency_us;
+    last_model_ = model;
+    awaiting_speech_ = true;
+    ESP_LOGI(TAG, "Detected by %s, %lld ms after voice onset", model.c_str(), latency_us / 1000);
+}
+
+void WakeWordStats::OnSpeechRecognized() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    awaiting_speech_ = false;
+}
+
+void WakeWordStats::OnSessionEnded() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (awaiting_speech_) {
+        awaiting_speech_ = false;
+        false_wakes_++;
+        ESP_LOGW(TAG, "No speech after wake word, %lu false wakes of %lu detections",
+            (unsigned long)false_wakes_, (unsigned long)detections_);
+    }
+}
+
+// 需持有 mutex_
+void WakeWordStats::LogStats() {
+    ESP_LOGI(TAG, "Duty cycle %.1f%%, inference %.1f%% CPU, %lu detections, %lu false wakes, average latency %lld ms",
+        total_frames_ > 0 ? inferred_frames_ * 100.0f / total_frames_ : 0.0f,
+        audio_us_ > 0 ? inference_us_ * 100.0f / audio_us_ : 0.0f,
+        (unsigned long)detections_, (unsigned long)false_wakes_,
+        detections_ > 0 ? total_latency_us_ / detections_ / 1000 : 0LL);
+}
+
+cJSON* WakeWordStats::GetJson() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "duty_cycle", total_frames_ > 0 ? inferred_frames_ * 100 / total_frames_ : 0);
+    if (inference_us_ > 0 && audio_us_ > 0) {
+        cJSON_AddNumberToObject(json, "inference_cpu", inference_us_ * 100 / audio_us_);
+    }
+    cJSON_AddNumberToObject(json, "detections", detections_);
+    cJSON_AddNumberToObject(json, "false_wakes", false_wakes_);
+    cJSON_AddNumberToObject(json, "average_latency_ms", detections_ > 0 ? total_latency_us_ / detections_ / 1000 : 0);
+    if (!last_model_.empty()) {
+        cJSON_AddStringToObject(json, "last_model", last_model_.c_str());
+    }
+    return json;
+}
@@ -0,0 +1,49 @@
+#ifndef WAKE_WORD_STATS_H
+#define WAKE_WORD_STATS_H
+
+#include <cJSON.h>
+#include <mutex>
+#include <string>
+
+// 唤醒词检测的统计（自启动起累计），定期打印到日志，并在设备状态中上报
+class WakeWordStats {
+public:
+    static WakeWordStats& GetInstance() {
+        static WakeWordStats instance;
+        return instance;
+    }
+    WakeWordStats(const WakeWordStats&) = delete;
+    WakeWordStats& operator=(const WakeWordStats&) = delete;
+
+    // 每检测一帧调用，inferred 表示本帧通过门限送入了模型
+    void AddFrame(bool inferred, int64_t duration_us);
+    // 模型推理耗时，用于计算 CPU 占用，无法单独计时的引擎不调用
+    void AddInferenceTime(int64_t us);
+    // latency_us 为从开始说话（门限打开）到唤醒的时间
+    void OnDetected(const std::string& model, int64_t latency_us);
+    // 唤醒后的对话中识别出了文本，说明确实有人在说话
+    void OnSpeechRecognized();
+    // 回到待机时调用，唤醒后直到此时都没有识别出文本的计为误唤醒
+    void OnSessionEnded();
+    // 返回 { "duty_cycle": 百分比, "detections": 次数, "false_wakes": 次数, ... }
+    cJSON* GetJson();
+
+private:
+    WakeWordStats() = default;
+
+    std::mutex mutex_;
+    uint32_t total_frames_ = 0;
+    uint32_t inferred_frames_ = 0;
+    int64_t audio_us_ = 0;
+    int64_t inference_us_ = 0;
+    uint32_t detections_ = 0;
+    uint32_t false_wakes_ = 0;
+    int64_t total_latency_us_ = 0;
+    std::string last_model_;
+    bool awaiting_speech_ = false;
+    int64_t last_log_time_ = 0;
+
+    void LogStats();
+};
+
+#endif // WAKE_WORD_STATS_H
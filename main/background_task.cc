@@ -5,20 +5,33 @@
 
 #define TAG "BackgroundTask"
 
-BackgroundTask::BackgroundTask(uint32_t stack_size) {
-    xTaskCreate([](void* arg) {
-        BackgroundTask* task = (BackgroundTask*)arg;
-        task->BackgroundTaskLoop();
-    }, "background_task", stack_size, this, 2, &background_task_handle_);
+BackgroundTask::BackgroundTask(uint32_t stack_size, int worker_count) {
+    if (worker_count < 1) {
+        worker_count = 1;
+    }
+    worker_handles_.resize(worker_count, nullptr);
+    for (int i = 0; i < worker_count; i++) {
+        auto loop = [](void* arg) {
+            BackgroundTask* task = (BackgroundTask*)arg;
+            task->BackgroundTaskLoop();
+        };
+        if (worker_count == 1) {
+            xTaskCreate(loop, "background_task", stack_size, this, 2, &worker_handles_[i]);
+        } else {
+            xTaskCreatePinnedToCore(loop, "background_task", stack_size, this, 2, &worker_handles_[i], i % portNUM_PROCESSORS);
+        }
+    }
 }
 
 BackgroundTask::~BackgroundTask() {
-    if (background_task_handle_ != nullptr) {
-        vTaskDelete(background_task_handle_);
+    for (auto handle : worker_handles_) {
+        if (handle != nullptr) {
+            vTaskDelete(handle);
+        }
     }
 }
 
-bool BackgroundTask::Schedule(std::function<void()> callback) {
+bool BackgroundTask::Schedule(Job&& callback, BackgroundTaskLane lane) {
     std::lock_guard<std::mutex> lock(mutex_);
     if (waiting_for_completion_ > 0) {
         return false;
@@ -31,40 +44,65 @@ bool BackgroundTask::Schedule(std::function<void()> callback) {
         }
     }
     active_tasks_++;
-    background_tasks_.emplace_back([this, cb = std::move(callback)]() {
-        cb();
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            active_tasks_--;
-            if (background_tasks_.empty() && active_tasks_ == 0) {
-                condition_variable_.notify_all();
-            }
-        }
-    });
-    condition_variable_.notify_all();
+    lanes_[lane].jobs.emplace_back(std::move(callback));
+    condition_variable_.notify_one();
     return true;
 }
 
+int BackgroundTask::Cancel(BackgroundTaskLane lane) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int dropped = lanes_[lane].jobs.size();
+    lanes_[lane].jobs.clear();
+    active_tasks_ -= dropped;
+    if (active_tasks_ == 0) {
+        completion_variable_.notify_all();
+    }
+    return dropped;
+}
+
 void BackgroundTask::WaitForCompletion() {
     std::unique_lock<std::mutex> lock(mutex_);
     waiting_for_completion_++;
-    condition_variable_.wait(lock, [this]() {
-        return background_tasks_.empty() && active_tasks_ == 0;
+    completion_variable_.wait(lock, [this]() {
+        return active_tasks_ == 0;
     });
     waiting_for_completion_--;
 }
 
+// Take the first job from the highest priority lane that is not already running
+bool BackgroundTask::PopJob(Job& job, int& lane_index) {
+    for (int i = 0; i < kBackgroundTaskLaneCount; i++) {
+        auto& lane = lanes_[i];
+        if (!lane.running && !lane.jobs.empty()) {
+            job = std::move(lane.jobs.front());
+            lane.jobs.pop_front();
+            lane.running = true;
+            lane_index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
 void BackgroundTask::BackgroundTaskLoop() {
     ESP_LOGI(TAG, "background_task started");
+    Job job;
+    int lane_index = 0;
     while (true) {
         std::unique_lock<std::mutex> lock(mutex_);
-        condition_variable_.wait(lock, [this]() { return !background_tasks_.empty(); });
-        
-        std::list<std::function<void()>> tasks = std::move(background_tasks_);
+        condition_variable_.wait(lock, [&]() { return PopJob(job, lane_index); });
         lock.unlock();
 
-        for (auto& task : tasks) {
-            task();
+        job();
+        job.Reset();
+
+        lock.lock();
+        lanes_[lane_index].running = false;
+        active_tasks_--;
+        if (active_tasks_ == 0) {
+            completion_variable_.notify_all();
         }
+        // The lane may have more jobs for another worker
+        condition_variable_.notify_one();
     }
 }
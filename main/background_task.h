@@ -4,26 +4,51 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <mutex>
-#include <list>
+#include <deque>
+#include <vector>
 #include <condition_variable>
 #include <atomic>
 
+#include "inline_function.h"
+
+// Jobs in the same lane run one at a time in FIFO order, so a lane can own
+// non-thread-safe state (e.g. the opus decoder). Lower value means higher priority.
+enum BackgroundTaskLane {
+    kBackgroundTaskLaneAudioDecode,
+    kBackgroundTaskLaneAudioEncode,
+    kBackgroundTaskLaneMisc,
+    kBackgroundTaskLaneCount
+};
+
 class BackgroundTask {
 public:
-    BackgroundTask(uint32_t stack_size = 4096 * 2);
+    // Most audio jobs capture `this`, a codec pointer and an AudioStreamPacket
+    using Job = InlineFunction<48>;
+
+    // With more than one worker, the workers are pinned round-robin to the available cores
+    BackgroundTask(uint32_t stack_size = 4096 * 2, int worker_count = 1);
     ~BackgroundTask();
 
-    bool Schedule(std::function<void()> callback);
+    bool Schedule(Job&& callback, BackgroundTaskLane lane = kBackgroundTaskLaneMisc);
+    // Drop the jobs that are queued but not yet started in the lane, returns the number dropped
+    int Cancel(BackgroundTaskLane lane);
     void WaitForCompletion();
 
 private:
+    struct Lane {
+        std::deque<Job> jobs;
+        bool running = false;
+    };
+
     std::mutex mutex_;
-    std::list<std::function<void()>> background_tasks_;
+    Lane lanes_[kBackgroundTaskLaneCount];
     std::condition_variable condition_variable_;
-    TaskHandle_t background_task_handle_ = nullptr;
+    std::condition_variable completion_variable_;
+    std::vector<TaskHandle_t> worker_handles_;
     int active_tasks_ = 0;
     int waiting_for_completion_ = 0;
 
+    bool PopJob(Job& job, int& lane_index);
     void BackgroundTaskLoop();
 };
 
@@ -3,9 +3,13 @@
 
 #include <string>
 
+#include "image_preprocess.h"
+
 class Camera {
 public:
     virtual void SetExplainUrl(const std::string& url, const std::string& token) = 0;
+    // 上传前对图像缩放、裁剪或转灰度
+    virtual void SetExplainOptions(const ImagePreprocessOptions& options) = 0;
     virtual bool Capture() = 0;
     virtual bool SetHMirror(bool enabled) = 0;
     virtual bool SetVFlip(bool enabled) = 0;
@@ -8,6 +8,7 @@
 #include <esp_heap_caps.h>
 #include <img_converters.h>
 #include <cstring>
+#include <algorithm>
 
 #define TAG "Esp32Camera"
 
@@ -68,6 +69,25 @@ Esp32Camera::Esp32Camera(const camera_config_t& config) {
 }
 
 Esp32Camera::~Esp32Camera() {
+    // 显示只引用预览缓冲区，释放前先解除引用
+    auto display = Board::GetInstance().GetDisplay();
+    if (display != nullptr && preview_image_.data != nullptr) {
+        display->SetPreviewImage(nullptr);
+    }
+    if (encoder_task_ != nullptr) {
+        vTaskDelete(encoder_task_);
+    }
+    heap_caps_free(encoder_task_stack_);
+    if (free_chunks_ != nullptr) {
+        vQueueDelete(free_chunks_);
+    }
+    if (filled_chunks_ != nullptr) {
+        vQueueDelete(filled_chunks_);
+    }
+    for (auto& chunk : jpeg_chunks_) {
+        heap_caps_free(chunk.data);
+    }
+    heap_caps_free(processed_frame_);
     if (fb_) {
         esp_camera_fb_return(fb_);
         fb_ = nullptr;
@@ -84,11 +104,11 @@ void Esp32Camera::SetExplainUrl(const std::string& url, const std::string& token
     explain_token_ = token;
 }
 
-bool Esp32Camera::Capture() {
-    if (encoder_thread_.joinable()) {
-        encoder_thread_.join();
-    }
+void Esp32Camera::SetExplainOptions(const ImagePreprocessOptions& options) {
+    explain_options_ = options;
+}
 
+bool Esp32Camera::Capture() {
     int frames_to_get = 2;
     // Try to get a stable frame
     for (int i = 0; i < frames_to_get; i++) {
@@ -115,12 +135,11 @@ bool Esp32Camera::Capture() {
     // 显示预览图片
     auto display = Board::GetInstance().GetDisplay();
     if (display != nullptr) {
-        auto src = (uint16_t*)fb_->buf;
-        auto dst = (uint16_t*)preview_image_.data;
-        size_t pixel_count = fb_->len / 2;
-        for (size_t i = 0; i < pixel_count; i++) {
-            // 交换每个16位字内的字节
-            dst[i] = __builtin_bswap16(src[i]);
+        size_t pixel_count = std::min(fb_->len, (size_t)preview_image_.data_size) / 2;
+        {
+            // 预览缓冲区被显示直接引用，转换期间持有显示锁避免画面撕裂
+            DisplayLockGuard lock(display);
+            ImageSwapRgb565(fb_->buf, (uint8_t*)preview_image_.data, pixel_count);
         }
         display->SetPreviewImage(&preview_image_);
     }
@@ -160,6 +179,104 @@ bool Esp32Camera::SetVFlip(bool enabled) {
     return true;
 }
 
+bool Esp32Camera::InitializeEncoder() {
+    if (encoder_task_ != nullptr) {
+        return true;
+    }
+
+    for (auto& chunk : jpeg_chunks_) {
+        chunk.data = (uint8_t*)heap_caps_malloc(JPEG_CHUNK_SIZE, MALLOC_CAP_SPIRAM);
+        if (chunk.data == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate JPEG chunk buffer");
+            return false;
+        }
+        chunk.len = 0;
+    }
+    free_chunks_ = xQueueCreate(JPEG_CHUNK_COUNT, sizeof(int));
+    filled_chunks_ = xQueueCreate(JPEG_CHUNK_COUNT + 1, sizeof(int));
+    if (free_chunks_ == nullptr || filled_chunks_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create JPEG chunk queues");
+        return false;
+    }
+    for (int i = 0; i < JPEG_CHUNK_COUNT; i++) {
+        xQueueSend(free_chunks_, &i, 0);
+    }
+
+    // fmt2jpg 的编码器状态和行缓冲在堆上，栈主要用于预处理和回调，放在 PSRAM 中留足余量
+    encoder_task_stack_ = (StackType_t*)heap_caps_malloc(JPEG_ENCODER_STACK_SIZE, MALLOC_CAP_SPIRAM);
+    if (encoder_task_stack_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate JPEG encoder stack");
+        return false;
+    }
+    encoder_task_ = xTaskCreateStatic([](void* arg) {
+        auto camera = (Esp32Camera*)arg;
+        camera->EncoderTask();
+    }, "jpeg_encoder", JPEG_ENCODER_STACK_SIZE, this, 1, encoder_task_stack_, &encoder_task_buffer_);
+    return encoder_task_ != nullptr;
+}
+
+// 常驻的编码任务，每次 Explain 通知一次，编码当前帧后发送结束标记
+void Esp32Camera::EncoderTask() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        const uint8_t* frame = fb_->buf;
+        size_t frame_len = fb_->len;
+        int width = fb_->width;
+        int height = fb_->height;
+        pixformat_t format = fb_->format;
+        if (preprocess_) {
+            ImagePreprocess(fb_->buf, fb_->width, fb_->height, true, encode_options_, processed_frame_, width, height);
+            frame = processed_frame_;
+            if (encode_options_.grayscale) {
+                format = PIXFORMAT_GRAYSCALE;
+                frame_len = width * height;
+            } else {
+                frame_len = width * height * 2;
+            }
+        }
+
+        xQueueReceive(free_chunks_, &encoding_chunk_, portMAX_DELAY);
+        jpeg_chunks_[encoding_chunk_].len = 0;
+        bool ok = fmt2jpg_cb((uint8_t*)frame, frame_len, width, height, format, CONFIG_CAMERA_JPEG_QUALITY,
+            [](void* arg, size_t index, const void* data, size_t len) -> size_t {
+                return ((Esp32Camera*)arg)->OnJpegData((const uint8_t*)data, len);
+            }, this);
+        if (!ok) {
+            ESP_LOGE(TAG, "Failed to encode JPEG");
+        }
+
+        // 发送最后一块（可能为空）和结束标记
+        if (jpeg_chunks_[encoding_chunk_].len > 0) {
+            xQueueSend(filled_chunks_, &encoding_chunk_, portMAX_DELAY);
+        } else {
+            xQueueSend(free_chunks_, &encoding_chunk_, portMAX_DELAY);
+        }
+        int end = -1;
+        xQueueSend(filled_chunks_, &end, portMAX_DELAY);
+        ESP_LOGD(TAG, "JPEG encoder stack high water mark: %u bytes", uxTaskGetStackHighWaterMark(nullptr));
+    }
+}
+
+// 把编码输出拷入当前分块，写满后交给上传方，没有空闲分块时等待上传
+size_t Esp32Camera::OnJpegData(const uint8_t* data, size_t len) {
+    size_t remaining = len;
+    while (remaining > 0) {
+        auto& chunk = jpeg_chunks_[encoding_chunk_];
+        size_t n = std::min(remaining, (size_t)JPEG_CHUNK_SIZE - chunk.len);
+        memcpy(chunk.data + chunk.len, data, n);
+        chunk.len += n;
+        data += n;
+        remaining -= n;
+        if (chunk.len == JPEG_CHUNK_SIZE) {
+            xQueueSend(filled_chunks_, &encoding_chunk_, portMAX_DELAY);
+            xQueueReceive(free_chunks_, &encoding_chunk_, portMAX_DELAY);
+            jpeg_chunks_[encoding_chunk_].len = 0;
+        }
+    }
+    return len;
+}
+
 /**
  * @brief 将摄像头捕获的图像发送到远程服务器进行AI分析和解释
  * 
@@ -168,9 +285,10 @@ bool Esp32Camera::SetVFlip(bool enabled) {
  * 问题对图像进行AI分析并返回结果。
  * 
  * 实现特点：
- * - 使用独立线程编码JPEG，与主线程分离
+ * - 由常驻的编码任务编码JPEG，与HTTP连接和上传并行进行
+ * - 编码输出写入固定的大块缓冲区，写满一块再上传，不做逐块分配
  * - 采用分块传输编码(chunked transfer encoding)优化内存使用
- * - 通过队列机制实现编码线程和发送线程的数据同步
+ * - 编码前按服务端协商的参数缩放、裁剪或转灰度，JPEG质量可通过 menuconfig 配置
  * - 支持设备ID、客户端ID和认证令牌的HTTP头部配置
  * 
  * @param question 要向AI提出的关于图像的问题，将作为表单字段发送
@@ -180,34 +298,39 @@ bool Esp32Camera::SetVFlip(bool enabled) {
  *                  {"success": false, "message": "错误信息"}
  * 
  * @note 调用此函数前必须先调用SetExplainUrl()设置服务器URL
- * @note 函数会等待之前的编码线程完成后再开始新的处理
+ * @note 函数返回前会等待本次编码完成，因此下一次 Capture() 可以安全替换帧缓冲区
  * @warning 如果摄像头缓冲区为空或网络连接失败，将返回错误信息
  */
 std::string Esp32Camera::Explain(const std::string& question) {
     if (explain_url_.empty()) {
         return "{\"success\": false, \"message\": \"Image explain URL or token is not set\"}";
     }
+    if (fb_ == nullptr) {
+        return "{\"success\": false, \"message\": \"No captured image\"}";
+    }
+    if (!InitializeEncoder()) {
+        return "{\"success\": false, \"message\": \"Failed to initialize JPEG encoder\"}";
+    }
 
-    // 创建局部的 JPEG 队列, 40 entries is about to store 512 * 40 = 20480 bytes of JPEG data
-    QueueHandle_t jpeg_queue = xQueueCreate(40, sizeof(JpegChunk));
-    if (jpeg_queue == nullptr) {
-        ESP_LOGE(TAG, "Failed to create JPEG queue");
-        return "{\"success\": false, \"message\": \"Failed to create JPEG queue\"}";
+    // 服务端没有指定尺寸时，使用本地配置的缩小倍数
+    encode_options_ = explain_options_;
+    if (encode_options_.max_width == 0 && encode_options_.max_height == 0) {
+        encode_options_.max_width = fb_->width / CONFIG_CAMERA_EXPLAIN_DOWNSCALE;
+    }
+    ImageRect roi;
+    int out_width, out_height;
+    preprocess_ = fb_->format == PIXFORMAT_RGB565 &&
+        ImagePreprocessGetLayout(encode_options_, fb_->width, fb_->height, roi, out_width, out_height);
+    if (preprocess_ && processed_frame_ == nullptr) {
+        processed_frame_ = (uint8_t*)heap_caps_malloc(fb_->len, MALLOC_CAP_SPIRAM);
+        if (processed_frame_ == nullptr) {
+            ESP_LOGW(TAG, "Failed to allocate preprocess buffer, upload the original frame");
+            preprocess_ = false;
+        }
     }
 
-    // We spawn a thread to encode the image to JPEG
-    encoder_thread_ = std::thread([this, jpeg_queue]() {
-        frame2jpg_cb(fb_, 80, [](void* arg, size_t index, const void* data, size_t len) -> unsigned int {
-            auto jpeg_queue = (QueueHandle_t)arg;
-            JpegChunk chunk = {
-                .data = (uint8_t*)heap_caps_aligned_alloc(16, len, MALLOC_CAP_SPIRAM),
-                .len = len
-            };
-            memcpy(chunk.data, data, len);
-            xQueueSend(jpeg_queue, &chunk, portMAX_DELAY);
-            return len;
-        }, jpeg_queue);
-    });
+    // 先开始编码，与建立连接并行
+    xTaskNotifyGive(encoder_task_);
 
     auto http = Board::GetInstance().CreateHttp();
     // 构造multipart/form-data请求体
@@ -221,63 +344,44 @@ std::string Esp32Camera::Explain(const std::string& question) {
     }
     http->SetHeader("Content-Type", "multipart/form-data; boundary=" + boundary);
     http->SetHeader("Transfer-Encoding", "chunked");
-    if (!http->Open("POST", explain_url_)) {
+    bool connected = http->Open("POST", explain_url_);
+    if (!connected) {
         ESP_LOGE(TAG, "Failed to connect to explain URL");
-        // Clear the queue
-        encoder_thread_.join();
-        JpegChunk chunk;
-        while (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) == pdPASS) {
-            if (chunk.data != nullptr) {
-                heap_caps_free(chunk.data);
-            } else {
-                break;
-            }
-        }
-        vQueueDelete(jpeg_queue);
-        return "{\"success\": false, \"message\": \"Failed to connect to explain URL\"}";
-    }
-    
-    {
-        // 第一块：question字段
-        std::string question_field;
-        question_field += "--" + boundary + "\r\n";
-        question_field += "Content-Disposition: form-data; name=\"question\"\r\n";
-        question_field += "\r\n";
-        question_field += question + "\r\n";
-        http->Write(question_field.c_str(), question_field.size());
-    }
-    {
-        // 第二块：文件字段头部
-        std::string file_header;
-        file_header += "--" + boundary + "\r\n";
-        file_header += "Content-Disposition: form-data; name=\"file\"; filename=\"camera.jpg\"\r\n";
-        file_header += "Content-Type: image/jpeg\r\n";
-        file_header += "\r\n";
-        http->Write(file_header.c_str(), file_header.size());
+    } else {
+        // 第一块：question字段和文件字段头部，合并为一次写入
+        std::string form_header;
+        form_header += "--" + boundary + "\r\n";
+        form_header += "Content-Disposition: form-data; name=\"question\"\r\n";
+        form_header += "\r\n";
+        form_header += question + "\r\n";
+        form_header += "--" + boundary + "\r\n";
+        form_header += "Content-Disposition: form-data; name=\"file\"; filename=\"camera.jpg\"\r\n";
+        form_header += "Content-Type: image/jpeg\r\n";
+        form_header += "\r\n";
+        http->Write(form_header.c_str(), form_header.size());
     }
 
-    // 第三块：JPEG数据
+    // 第二块：JPEG数据，每次写入一个完整的分块；连接失败时也要取完，让编码任务结束
     size_t total_sent = 0;
     while (true) {
-        JpegChunk chunk;
-        if (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) != pdPASS) {
-            ESP_LOGE(TAG, "Failed to receive JPEG chunk");
-            break;
-        }
-        if (chunk.data == nullptr) {
+        int index;
+        xQueueReceive(filled_chunks_, &index, portMAX_DELAY);
+        if (index < 0) {
             break; // The last chunk
         }
-        http->Write((const char*)chunk.data, chunk.len);
-        total_sent += chunk.len;
-        heap_caps_free(chunk.data);
+        if (connected) {
+            http->Write((const char*)jpeg_chunks_[index].data, jpeg_chunks_[index].len);
+            total_sent += jpeg_chunks_[index].len;
+        }
+        xQueueSend(free_chunks_, &index, portMAX_DELAY);
+    }
+
+    if (!connected) {
+        return "{\"success\": false, \"message\": \"Failed to connect to explain URL\"}";
     }
-    // Wait for the encoder thread to finish
-    encoder_thread_.join();
-    // 清理队列
-    vQueueDelete(jpeg_queue);
 
     {
-        // 第四块：multipart尾部
+        // 第三块：multipart尾部
         std::string multipart_footer;
         multipart_footer += "\r\n--" + boundary + "--\r\n";
         http->Write(multipart_footer.c_str(), multipart_footer.size());
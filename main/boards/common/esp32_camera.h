@@ -3,14 +3,20 @@
 
 #include <esp_camera.h>
 #include <lvgl.h>
-#include <thread>
 #include <memory>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
+#include <freertos/task.h>
 
 #include "camera.h"
 
+// 编码任务与上传共用的固定分块缓冲区
+#define JPEG_CHUNK_SIZE         (8 * 1024)
+#define JPEG_CHUNK_COUNT        3
+// 编码任务的栈分配在 PSRAM 中，每次编码后以 debug 级别输出剩余量
+#define JPEG_ENCODER_STACK_SIZE (8 * 1024)
+
 struct JpegChunk {
     uint8_t* data;
     size_t len;
@@ -22,13 +28,31 @@ private:
     lv_img_dsc_t preview_image_;
     std::string explain_url_;
     std::string explain_token_;
-    std::thread encoder_thread_;
+    ImagePreprocessOptions explain_options_;
+
+    // 编码任务写满一块就交给上传方，上传后归还，队列中传递分块序号，-1 表示编码结束
+    JpegChunk jpeg_chunks_[JPEG_CHUNK_COUNT] = {};
+    QueueHandle_t free_chunks_ = nullptr;
+    QueueHandle_t filled_chunks_ = nullptr;
+    TaskHandle_t encoder_task_ = nullptr;
+    StaticTask_t encoder_task_buffer_;
+    StackType_t* encoder_task_stack_ = nullptr;
+    int encoding_chunk_ = -1;
+    // 本次编码使用的预处理参数和结果，结果按原始帧大小分配一次
+    ImagePreprocessOptions encode_options_;
+    uint8_t* processed_frame_ = nullptr;
+    bool preprocess_ = false;
+
+    bool InitializeEncoder();
+    void EncoderTask();
+    size_t OnJpegData(const uint8_t* data, size_t len);
 
 public:
     Esp32Camera(const camera_config_t& config);
     ~Esp32Camera();
 
     virtual void SetExplainUrl(const std::string& url, const std::string& token);
+    virtual void SetExplainOptions(const ImagePreprocessOptions& options) override;
     virtual bool Capture();
     // 翻转控制函数
     virtual bool SetHMirror(bool enabled) override;
@@ -0,0 +1,147 @@
+#include "image_preprocess.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+inline uint16_t LoadPixel(const uint16_t* row, int x, bool big_endian) {
+    return big_endian ? __builtin_bswap16(row[x]) : row[x];
+}
+
+inline void UnpackRgb565(uint16_t pixel, int& r, int& g, int& b) {
+    r = pixel >> 11;
+    g = (pixel >> 5) & 0x3F;
+    b = pixel & 0x1F;
+}
+
+// 输入为 5/6/5 位分量，按 BT.601 近似系数计算 8 位亮度
+inline uint8_t Luma(int r, int g, int b) {
+    return (uint8_t)((r * 8 * 77 + g * 4 * 150 + b * 8 * 29) >> 8);
+}
+
+inline void StorePixel(uint8_t* dst, int index, int r, int g, int b, bool grayscale) {
+    if (grayscale) {
+        dst[index] = Luma(r, g, b);
+    } else {
+        ((uint16_t*)dst)[index] = __builtin_bswap16((uint16_t)((r << 11) | (g << 5) | b));
+    }
+}
+
+// 整数倍缩小时使用盒式滤波，每个输出像素是 factor x factor 区域的平均值
+void BoxDownscale(const uint8_t* src, int width, const ImageRect& roi, int factor, bool big_endian,
+                  bool grayscale, uint8_t* dst, int out_width, int out_height) {
+    auto src16 = (const uint16_t*)src;
+    int area = factor * factor;
+    for (int y = 0; y < out_height; y++) {
+        for (int x = 0; x < out_width; x++) {
+            int r = 0, g = 0, b = 0;
+            for (int dy = 0; dy < factor; dy++) {
+                const uint16_t* row = src16 + (roi.y + y * factor + dy) * width + roi.x + x * factor;
+                for (int dx = 0; dx < factor; dx++) {
+                    int pr, pg, pb;
+                    UnpackRgb565(LoadPixel(row, dx, big_endian), pr, pg, pb);
+                    r += pr;
+                    g += pg;
+                    b += pb;
+                }
+            }
+            StorePixel(dst, y * out_width + x, r / area, g / area, b / area, grayscale);
+        }
+    }
+}
+
+// 非整数倍时使用双线性插值，坐标为 16.16 定点数，横向坐标和权重每行复用
+void BilinearResize(const uint8_t* src, int width, const ImageRect& roi, bool big_endian,
+                    bool grayscale, uint8_t* dst, int out_width, int out_height) {
+    auto src16 = (const uint16_t*)src;
+    std::vector<int> x0(out_width);
+    std::vector<int> wx(out_width);
+    int step_x = (roi.width << 16) / out_width;
+    int step_y = (roi.height << 16) / out_height;
+    for (int x = 0; x < out_width; x++) {
+        int fx = std::max(0, x * step_x + step_x / 2 - 0x8000);
+        x0[x] = std::min(fx >> 16, roi.width - 1);
+        wx[x] = (fx >> 8) & 0xFF;
+    }
+    for (int y = 0; y < out_height; y++) {
+        int fy = std::max(0, y * step_y + step_y / 2 - 0x8000);
+        int y0 = std::min(fy >> 16, roi.height - 1);
+        int y1 = std::min(y0 + 1, roi.height - 1);
+        int wy = (fy >> 8) & 0xFF;
+        const uint16_t* row0 = src16 + (roi.y + y0) * width + roi.x;
+        const uint16_t* row1 = src16 + (roi.y + y1) * width + roi.x;
+        for (int x = 0; x < out_width; x++) {
+            int xa = x0[x];
+            int xb = std::min(xa + 1, roi.width - 1);
+            int r00, g00, b00, r01, g01, b01, r10, g10, b10, r11, g11, b11;
+            UnpackRgb565(LoadPixel(row0, xa, big_endian), r00, g00, b00);
+            UnpackRgb565(LoadPixel(row0, xb, big_endian), r01, g01, b01);
+            UnpackRgb565(LoadPixel(row1, xa, big_endian), r10, g10, b10);
+            UnpackRgb565(LoadPixel(row1, xb, big_endian), r11, g11, b11);
+            int w = wx[x];
+            int r0 = r00 * (256 - w) + r01 * w, r1 = r10 * (256 - w) + r11 * w;
+            int g0 = g00 * (256 - w) + g01 * w, g1 = g10 * (256 - w) + g11 * w;
+            int b0 = b00 * (256 - w) + b01 * w, b1 = b10 * (256 - w) + b11 * w;
+            int r = (r0 * (256 - wy) + r1 * wy + 0x8000) >> 16;
+            int g = (g0 * (256 - wy) + g1 * wy + 0x8000) >> 16;
+            int b = (b0 * (256 - wy) + b1 * wy + 0x8000) >> 16;
+            StorePixel(dst, y * out_width + x, r, g, b, grayscale);
+        }
+    }
+}
+
+} // namespace
+
+bool ImagePreprocessGetLayout(const ImagePreprocessOptions& options, int width, int height,
+                              ImageRect& roi, int& out_width, int& out_height) {
+    auto clamp01 = [](float v) { return std::min(1.0f, std::max(0.0f, v)); };
+    float roi_x = clamp01(options.roi_x);
+    float roi_y = clamp01(options.roi_y);
+    roi.x = std::min((int)(roi_x * width), width - 1);
+    roi.y = std::min((int)(roi_y * height), height - 1);
+    roi.width = std::max(1, std::min((int)(clamp01(options.roi_width) * width), width - roi.x));
+    roi.height = std::max(1, std::min((int)(clamp01(options.roi_height) * height), height - roi.y));
+
+    // 保持宽高比缩小到最大尺寸以内，不放大
+    out_width = roi.width;
+    out_height = roi.height;
+    if (options.max_width > 0 && out_width > options.max_width) {
+        out_height = std::max(1, out_height * options.max_width / out_width);
+        out_width = options.max_width;
+    }
+    if (options.max_height > 0 && out_height > options.max_height) {
+        out_width = std::max(1, out_width * options.max_height / out_height);
+        out_height = options.max_height;
+    }
+
+    return options.grayscale || roi.width != width || roi.height != height ||
+        out_width != width || out_height != height;
+}
+
+void ImagePreprocess(const uint8_t* src, int width, int height, bool src_big_endian,
+                     const ImagePreprocessOptions& options, uint8_t* dst, int& out_width, int& out_height) {
+    ImageRect roi;
+    ImagePreprocessGetLayout(options, width, height, roi, out_width, out_height);
+
+    int factor = roi.width / out_width;
+    if (roi.width == out_width * factor && roi.height == out_height * factor) {
+        BoxDownscale(src, width, roi, factor, src_big_endian, options.grayscale, dst, out_width, out_height);
+    } else {
+        BilinearResize(src, width, roi, src_big_endian, options.grayscale, dst, out_width, out_height);
+    }
+}
+
+// 每次处理两个像素
+void ImageSwapRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    auto src32 = (const uint32_t*)src;
+    auto dst32 = (uint32_t*)dst;
+    size_t word_count = pixel_count / 2;
+    for (size_t i = 0; i < word_count; i++) {
+        uint32_t v = src32[i];
+        dst32[i] = ((v & 0x00FF00FF) << 8) | ((v >> 8) & 0x00FF00FF);
+    }
+    if (pixel_count & 1) {
+        ((uint16_t*)dst)[pixel_count - 1] = __builtin_bswap16(((const uint16_t*)src)[pixel_count - 1]);
+    }
+}
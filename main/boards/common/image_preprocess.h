@@ -0,0 +1,41 @@
+#ifndef IMAGE_PREPROCESS_H
+#define IMAGE_PREPROCESS_H
+
+#include <cstdint>
+#include <cstddef>
+
+// 识图上传前的预处理参数，由服务端 vision 能力协商
+struct ImagePreprocessOptions {
+    // 输出的最大尺寸，按比例缩小，0 表示不限制
+    int max_width = 0;
+    int max_height = 0;
+    // 输出灰度图（每像素 1 字节）
+    bool grayscale = false;
+    // 感兴趣区域，取值为相对于整幅图像的比例
+    float roi_x = 0.0f;
+    float roi_y = 0.0f;
+    float roi_width = 1.0f;
+    float roi_height = 1.0f;
+};
+
+struct ImageRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// 计算预处理后的感兴趣区域和输出尺寸，返回 false 表示无需处理
+bool ImagePreprocessGetLayout(const ImagePreprocessOptions& options, int width, int height,
+                              ImageRect& roi, int& out_width, int& out_height);
+
+// 对 RGB565 图像裁剪、缩放，并可选转为灰度
+// src_big_endian 表示输入的字节序（摄像头输出为大端），RGB565 输出统一为大端，可直接交给 JPEG 编码
+// dst 至少需要 out_width * out_height * (grayscale ? 1 : 2) 字节
+void ImagePreprocess(const uint8_t* src, int width, int height, bool src_big_endian,
+                     const ImagePreprocessOptions& options, uint8_t* dst, int& out_width, int& out_height);
+
+// 交换 RGB565 像素的高低字节，用于摄像头预览，src 与 dst 可以相同，都需要 4 字节对齐
+void ImageSwapRgb565(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+
+#endif // IMAGE_PREPROCESS_H
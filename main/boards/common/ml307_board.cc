@@ -2,6 +2,8 @@
 
 #include "application.h"
 #include "display.h"
+#include "boot_profiler.h"
+#include "wake_word_stats.h"
 #include "font_awesome_symbols.h"
 #include "assets/lang_config.h"
 
@@ -149,6 +151,17 @@ std::string Ml307Board::GetDeviceStatusJson() {
      *         "type": "cellular",
      *         "carrier": "CHINA MOBILE",
      *         "csq": 10
+     *     },
+     *     "boot": {
+     *         "codec": 850,
+     *         "wake_word_ready": 2100,
+     *         "ready": 4300
+     *     },
+     *     "wake_word": {
+     *         "duty_cycle": 12,
+     *         "detections": 5,
+     *         "false_wakes": 1,
+     *         "average_latency_ms": 650
      *     }
      * }
      */
@@ -204,6 +217,12 @@ std::string Ml307Board::GetDeviceStatusJson() {
     }
     cJSON_AddItemToObject(root, "network", network);
 
+    // Boot phases, milliseconds since power on
+    cJSON_AddItemToObject(root, "boot", BootProfiler::GetInstance().GetJson());
+
+    // Wake word detection since boot
+    cJSON_AddItemToObject(root, "wake_word", WakeWordStats::GetInstance().GetJson());
+
     auto json_str = cJSON_PrintUnformatted(root);
     std::string json(json_str);
     cJSON_free(json_str);
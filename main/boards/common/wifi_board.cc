@@ -5,6 +5,8 @@
 #include "system_info.h"
 #include "font_awesome_symbols.h"
 #include "settings.h"
+#include "boot_profiler.h"
+#include "wake_word_stats.h"
 #include "assets/lang_config.h"
 
 #include <freertos/FreeRTOS.h>
@@ -206,6 +208,17 @@ std::string WifiBoard::GetDeviceStatusJson() {
      *     },
      *     "chip": {
      *         "temperature": 25
+     *     },
+     *     "boot": {
+     *         "codec": 850,
+     *         "wake_word_ready": 2100,
+     *         "ready": 4300
+     *     },
+     *     "wake_word": {
+     *         "duty_cycle": 12,
+     *         "detections": 5,
+     *         "false_wakes": 1,
+     *         "average_latency_ms": 650
      *     }
      * }
      */
@@ -266,6 +279,12 @@ std::string WifiBoard::GetDeviceStatusJson() {
         cJSON_AddItemToObject(root, "chip", chip);
     }
 
+    // Boot phases, milliseconds since power on
+    cJSON_AddItemToObject(root, "boot", BootProfiler::GetInstance().GetJson());
+
+    // Wake word detection since boot
+    cJSON_AddItemToObject(root, "wake_word", WakeWordStats::GetInstance().GetJson());
+
     auto json_str = cJSON_PrintUnformatted(root);
     std::string json(json_str);
     cJSON_free(json_str);
@@ -53,8 +53,7 @@ ElectronEmojiDisplay::ElectronEmojiDisplay(esp_lcd_panel_io_handle_t panel_io,
                                            int offset_x, int offset_y, bool mirror_x, bool mirror_y,
                                            bool swap_xy, DisplayFonts fonts)
     : SpiLcdDisplay(panel_io, panel, width, height, offset_x, offset_y, mirror_x, mirror_y, swap_xy,
-                    fonts),
-      emotion_gif_(nullptr) {
+                    fonts) {
     SetupGifContainer();
 }
 
@@ -85,13 +84,15 @@ void ElectronEmojiDisplay::SetupGifContainer() {
     lv_obj_set_style_border_width(emotion_label_, 0, 0);
     lv_obj_add_flag(emotion_label_, LV_OBJ_FLAG_HIDDEN);
 
-    emotion_gif_ = lv_gif_create(content_);
-    int gif_size = LV_HOR_RES;
-    lv_obj_set_size(emotion_gif_, gif_size, gif_size);
-    lv_obj_set_style_border_width(emotion_gif_, 0, 0);
-    lv_obj_set_style_bg_opa(emotion_gif_, LV_OPA_TRANSP, 0);
-    lv_obj_center(emotion_gif_);
-    lv_gif_set_src(emotion_gif_, &staticstate);
+    // 按映射表顺序预解码，默认表情在最前
+    emotion_cache_ = std::make_unique<GifEmotionCache>(CONFIG_EMOTION_CACHE_SIZE_KB * 1024);
+    for (const auto& map : emotion_maps_) {
+        if (map.gif) {
+            emotion_cache_->Preload(map.gif);
+        }
+    }
+    emotion_player_ = std::make_unique<GifEmotionPlayer>(content_, LV_HOR_RES, emotion_cache_.get());
+    emotion_player_->Play(&staticstate);
 
     chat_message_label_ = lv_label_create(content_);
     lv_label_set_text(chat_message_label_, "");
@@ -111,7 +112,7 @@ void ElectronEmojiDisplay::SetupGifContainer() {
 }
 
 void ElectronEmojiDisplay::SetEmotion(const char* emotion) {
-    if (!emotion || !emotion_gif_) {
+    if (!emotion || !emotion_player_) {
         return;
     }
 
@@ -119,13 +120,13 @@ void ElectronEmojiDisplay::SetEmotion(const char* emotion) {
 
     for (const auto& map : emotion_maps_) {
         if (map.name && strcmp(map.name, emotion) == 0) {
-            lv_gif_set_src(emotion_gif_, map.gif);
+            emotion_player_->Play(map.gif);
             ESP_LOGI(TAG, "设置表情: %s", emotion);
             return;
         }
     }
 
-    lv_gif_set_src(emotion_gif_, &staticstate);
+    emotion_player_->Play(&staticstate);
     ESP_LOGI(TAG, "未知表情'%s'，使用默认", emotion);
 }
 
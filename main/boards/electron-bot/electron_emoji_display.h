@@ -3,6 +3,9 @@
 #include <libs/gif/lv_gif.h>
 
 #include "display/lcd_display.h"
+#include "display/gif_emotion_cache.h"
+
+#include <memory>
 
 // Electron Bot表情GIF声明 - 使用与Otto相同的6个表情
 LV_IMAGE_DECLARE(staticstate);  // 静态状态/中性表情
@@ -39,7 +42,8 @@ public:
 private:
     void SetupGifContainer();
 
-    lv_obj_t* emotion_gif_;  ///< GIF表情组件
+    std::unique_ptr<GifEmotionCache> emotion_cache_;  ///< 预解码的表情帧缓存
+    std::unique_ptr<GifEmotionPlayer> emotion_player_;  ///< GIF表情组件
 
     // 表情映射
     struct EmotionMap {
@@ -4,6 +4,7 @@
 #include "button.h"
 #include "config.h"
 #include "iot/thing_manager.h"
+#include "settings.h"
 #include "sdkconfig.h"
 
 #include <wifi_station.h>
@@ -104,6 +105,7 @@ private:
                     ESP_LOGW(TAG, "Key button long pressed the second time within 5s, shutting down...");
                     led->SetSingleColor(0, {0, 0, 0});
 
+                    Settings::Flush();
                     gpio_hold_dis(MCU_VCC_CTL);
                     gpio_set_level(MCU_VCC_CTL, 0);
 
@@ -148,6 +148,7 @@ private:
             GetBacklight()->RestoreBrightness();
         });
         power_save_timer_->OnShutdownRequest([this]() {
+            Settings::Flush();
             pmic_->PowerOff();
         });
         power_save_timer_->SetEnabled(true);
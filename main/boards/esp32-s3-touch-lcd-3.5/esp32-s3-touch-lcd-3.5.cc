@@ -26,6 +26,7 @@
 #include <esp_lvgl_port.h>
 
 #include "esp32_camera.h"
+#include "settings.h"
 
 #define TAG "waveshare_lcd_3_5"
 
@@ -133,6 +134,7 @@ private:
             GetBacklight()->RestoreBrightness();
         });
         power_save_timer_->OnShutdownRequest([this]() {
+            Settings::Flush();
             pmic_->PowerOff();
         });
         power_save_timer_->SetEnabled(true);
@@ -20,6 +20,7 @@
 #include "power_manager.h"
 #include "power_controller.h"
 #include "gpio_manager.h"
+#include "settings.h"
 #include <driver/rtc_io.h>
 #include <esp_sleep.h>
 
@@ -77,6 +78,7 @@ private:
                 ESP_ERROR_CHECK(esp_sleep_enable_ext0_wakeup(PWR_BUTTON_GPIO, 0));
                 ESP_ERROR_CHECK(rtc_gpio_pullup_en(PWR_BUTTON_GPIO));  // 内部上拉
                 ESP_ERROR_CHECK(rtc_gpio_pulldown_dis(PWR_BUTTON_GPIO));
+                Settings::Flush();
                 esp_deep_sleep_start();
             }
         }
@@ -103,6 +105,7 @@ private:
             ESP_ERROR_CHECK(rtc_gpio_pulldown_dis(PWR_BUTTON_GPIO));
 
             esp_lcd_panel_disp_on_off(panel, false); //关闭显示
+            Settings::Flush();
             esp_deep_sleep_start();
             #else
             rtc_gpio_set_level(PWR_EN_GPIO, 0);
@@ -215,6 +218,7 @@ private:
                     if (PowerController::Instance().GetState() != PowerController::PowerState::SHUTDOWN) {
                         ESP_LOGE(TAG, "State inconsistency! Forcing shutdown");
                     }
+                    Settings::Flush();
                     esp_deep_sleep_start();
                     break;
                 }
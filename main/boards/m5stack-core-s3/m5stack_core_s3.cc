@@ -16,6 +16,7 @@
 #include <esp_lcd_ili9341.h>
 #include <esp_timer.h>
 #include "esp32_camera.h"
+#include "settings.h"
 
 
 #define TAG "M5StackCoreS3Board"
@@ -152,6 +153,7 @@ private:
             GetBacklight()->RestoreBrightness();
         });
         power_save_timer_->OnShutdownRequest([this]() {
+            Settings::Flush();
             pmic_->PowerOff();
         });
         power_save_timer_->SetEnabled(true);
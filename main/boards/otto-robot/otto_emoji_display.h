@@ -3,6 +3,9 @@
 #include <libs/gif/lv_gif.h>
 
 #include "display/lcd_display.h"
+#include "display/gif_emotion_cache.h"
+
+#include <memory>
 #include "otto_emoji_gif.h"
 
 /**
@@ -32,7 +35,8 @@ public:
 private:
     void SetupGifContainer();
 
-    lv_obj_t* emotion_gif_;  ///< GIF表情组件
+    std::unique_ptr<GifEmotionCache> emotion_cache_;  ///< 预解码的表情帧缓存
+    std::unique_ptr<GifEmotionPlayer> emotion_player_;  ///< GIF表情组件
 
     // 表情映射
     struct EmotionMap {
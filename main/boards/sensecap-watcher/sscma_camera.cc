@@ -9,10 +9,30 @@
 #include <esp_heap_caps.h>
 #include <img_converters.h>
 #include <cstring>
+#include <algorithm>
 
 #define TAG "SscmaCamera"
 
-#define IMG_JPEG_BUF_SIZE   48 * 1024
+#define PREVIEW_IDLE_BIT        BIT0
+#define BASE64_DECODE_CHUNK     512
+#define CAPTURE_TIMEOUT_MS      3000
+
+// 分块原地解码 base64，每块先拷贝到临时缓冲区，输出位置始终落后于尚未读取的输入
+static bool DecodeBase64InPlace(uint8_t* data, size_t len, size_t* out_len) {
+    uint8_t chunk[BASE64_DECODE_CHUNK];
+    size_t written = 0;
+    for (size_t offset = 0; offset < len; offset += BASE64_DECODE_CHUNK) {
+        size_t chunk_len = std::min(len - offset, (size_t)BASE64_DECODE_CHUNK);
+        memcpy(chunk, data + offset, chunk_len);
+        size_t decoded = 0;
+        if (mbedtls_base64_decode(data + written, len - written, &decoded, chunk, chunk_len) != 0) {
+            return false;
+        }
+        written += decoded;
+    }
+    *out_len = written;
+    return written > 0;
+}
 
 SscmaCamera::SscmaCamera(esp_io_expander_handle_t io_exp_handle) {
     sscma_client_io_spi_config_t spi_io_config = {0};
@@ -44,6 +64,8 @@ SscmaCamera::SscmaCamera(esp_io_expander_handle_t io_exp_handle) {
     sscma_client_new(sscma_client_io_handle_, &sscma_client_config, &sscma_client_handle_);
 
     sscma_data_queue_ = xQueueCreate(1, sizeof(SscmaData));
+    preview_event_group_ = xEventGroupCreate();
+    xEventGroupSetBits(preview_event_group_, PREVIEW_IDLE_BIT);
 
     sscma_client_callback_t callback = {0};
 
@@ -54,11 +76,16 @@ SscmaCamera::SscmaCamera(esp_io_expander_handle_t io_exp_handle) {
         int img_size = 0;
         if (sscma_utils_fetch_image_from_reply(reply, &img, &img_size) == ESP_OK)
         {
-            ESP_LOGI(TAG, "image_size: %d\n", img_size);
-            // 将数据通过队列发送出去
+            // 收到回复后立即在原缓冲区内解码，拍照方拿到的就是 JPEG 数据
             SscmaData data;
             data.img = (uint8_t*)img;
-            data.len = img_size;
+            data.sequence = ++self->image_sequence_;
+            if (!DecodeBase64InPlace(data.img, img_size, &data.len)) {
+                ESP_LOGE(TAG, "Failed to decode base64 image data, size: %d", img_size);
+                heap_caps_free(img);
+                return;
+            }
+            ESP_LOGI(TAG, "image_size: %d, jpeg_size: %zu", img_size, data.len);
 
             // 清空队列，保证只保存最新的数据
             SscmaData dummy;
@@ -100,14 +127,6 @@ SscmaCamera::SscmaCamera(esp_io_expander_handle_t io_exp_handle) {
             info->id ? info->id : "NULL", 
             info->name ? info->name : "NULL");
     }
-    // 初始化JPEG数据的内存
-    jpeg_data_.len = 0;
-    jpeg_data_.buf = (uint8_t*)heap_caps_malloc(IMG_JPEG_BUF_SIZE, MALLOC_CAP_SPIRAM);;
-    if ( jpeg_data_.buf == nullptr ) {
-        ESP_LOGE(TAG, "Failed to allocate memory for JPEG buffer");
-        return;
-    }
-
     //初始化JPEG解码
     jpeg_dec_config_t config = { .output_type = JPEG_RAW_TYPE_RGB565_LE, .rotate = JPEG_ROTATE_0D };
     jpeg_dec_ = jpeg_dec_open(&config);
@@ -143,21 +162,46 @@ SscmaCamera::SscmaCamera(esp_io_expander_handle_t io_exp_handle) {
     preview_image_.header.stride = preview_image_.header.w * 2;
     preview_image_.data_size = preview_image_.header.w * preview_image_.header.h * 2;
     preview_image_.data = (uint8_t*)heap_caps_malloc(preview_image_.data_size, MALLOC_CAP_SPIRAM);
-    if (preview_image_.data == nullptr) {
+    preview_back_buffer_ = (uint8_t*)heap_caps_malloc(preview_image_.data_size, MALLOC_CAP_SPIRAM);
+    if (preview_image_.data == nullptr || preview_back_buffer_ == nullptr) {
         ESP_LOGE(TAG, "Failed to allocate memory for preview image");
         return;
     }
+
+    xTaskCreate([](void* arg) {
+        static_cast<SscmaCamera*>(arg)->PreviewTask();
+    }, "sscma_preview", 4096, this, 1, &preview_task_);
 }
 
 SscmaCamera::~SscmaCamera() {
+    if (preview_task_) {
+        WaitForPreview(portMAX_DELAY);
+        vTaskDelete(preview_task_);
+        preview_task_ = nullptr;
+    }
+    auto display = Board::GetInstance().GetDisplay();
+    if (display != nullptr) {
+        display->SetPreviewImage(nullptr);
+    }
+    if (preview_event_group_) {
+        vEventGroupDelete(preview_event_group_);
+    }
     if (preview_image_.data) {
         heap_caps_free((void*)preview_image_.data);
         preview_image_.data = nullptr;
     }
+    if (preview_back_buffer_) {
+        heap_caps_free(preview_back_buffer_);
+        preview_back_buffer_ = nullptr;
+    }
     if (sscma_client_handle_) {
         sscma_client_del(sscma_client_handle_);
     }
     if (sscma_data_queue_) {
+        SscmaData data;
+        while (xQueueReceive(sscma_data_queue_, &data, 0) == pdPASS) {
+            heap_caps_free(data.img);
+        }
         vQueueDelete(sscma_data_queue_);
     }
     if (jpeg_data_.buf) {
@@ -183,55 +227,34 @@ void SscmaCamera::SetExplainUrl(const std::string& url, const std::string& token
     explain_token_ = token;
 }
 
-bool SscmaCamera::Capture() {
-
-    SscmaData data;
-    size_t output_len = 0;
-    int ret = 0;
-    
-    if (sscma_client_handle_ == nullptr) {
-        ESP_LOGE(TAG, "SSCMA client handle is not initialized");
-        return false;
-    }
-
-    ESP_LOGI(TAG, "Capturing image...");
-
-    // himax 有缓存数据,需要拍两张照片, 只获取最新的照片即可.
-    if (sscma_client_sample(sscma_client_handle_, 2) ) {
-        ESP_LOGE(TAG, "Failed to capture image from SSCMA client");
-        return false;
-    }
-    vTaskDelay(pdMS_TO_TICKS(500)); // 等待SSCMA客户端处理数据
-    if (xQueueReceive(sscma_data_queue_, &data, pdMS_TO_TICKS(1000)) != pdPASS) {
-        ESP_LOGE(TAG, "Failed to receive JPEG data from SSCMA client");
-        return false;
-    }
+void SscmaCamera::SetExplainOptions(const ImagePreprocessOptions& options) {
+    explain_options_ = options;
+}
 
-    if (jpeg_data_.buf == nullptr) {
-        heap_caps_free(data.img);
-        return false;
-    }
+bool SscmaCamera::WaitForPreview(TickType_t timeout) {
+    return xEventGroupWaitBits(preview_event_group_, PREVIEW_IDLE_BIT, pdFALSE, pdTRUE, timeout) & PREVIEW_IDLE_BIT;
+}
 
-    ret = mbedtls_base64_decode(jpeg_data_.buf, IMG_JPEG_BUF_SIZE, &jpeg_data_.len, data.img, data.len);
-    if (ret != 0 || jpeg_data_.len == 0) {
-        ESP_LOGE(TAG, "Failed to decode base64 image data, ret: %d, output_len: %zu", ret, jpeg_data_.len);
-        heap_caps_free(data.img);
-        return false;
+void SscmaCamera::PreviewTask() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        DecodePreview();
+        xEventGroupSetBits(preview_event_group_, PREVIEW_IDLE_BIT);
     }
-    heap_caps_free(data.img);
+}
 
-    //DECODE JPEG
-    if (!jpeg_dec_ || !jpeg_io_ || !jpeg_out_ || !preview_image_.data) {
-        return true;
+void SscmaCamera::DecodePreview() {
+    if (!jpeg_dec_ || !jpeg_io_ || !jpeg_out_ || !preview_image_.data || !preview_back_buffer_) {
+        return;
     }
     jpeg_io_->inbuf = jpeg_data_.buf;
     jpeg_io_->inbuf_len = jpeg_data_.len;
-    ret = jpeg_dec_parse_header(jpeg_dec_, jpeg_io_, jpeg_out_);
+    int ret = jpeg_dec_parse_header(jpeg_dec_, jpeg_io_, jpeg_out_);
     if (ret < 0) {
         ESP_LOGE(TAG, "Failed to parse JPEG header, ret: %d", ret);
-        return true;
+        return;
     }
-    jpeg_io_->outbuf = (unsigned char*)preview_image_.data;
+    jpeg_io_->outbuf = preview_back_buffer_;
     int inbuf_consumed = jpeg_io_->inbuf_len - jpeg_io_->inbuf_remain;
     jpeg_io_->inbuf =  jpeg_data_.buf + inbuf_consumed;
     jpeg_io_->inbuf_len = jpeg_io_->inbuf_remain;
@@ -239,16 +262,79 @@ bool SscmaCamera::Capture() {
     ret = jpeg_dec_process(jpeg_dec_, jpeg_io_);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to decode JPEG image, ret: %d", ret);
-        return true;
+        return;
     }
 
-    // 显示预览图片
+    // 显示预览图片，交换缓冲区与刷新在同一把显示锁内完成
     auto display = Board::GetInstance().GetDisplay();
     if (display != nullptr) {
+        DisplayLockGuard lock(display);
+        SwapPreviewBuffer();
         display->SetPreviewImage(&preview_image_);
+    } else {
+        SwapPreviewBuffer();
+    }
+}
+
+void SscmaCamera::SwapPreviewBuffer() {
+    auto front = (uint8_t*)preview_image_.data;
+    preview_image_.data = preview_back_buffer_;
+    preview_back_buffer_ = front;
+    preview_decoded_ = true;
+}
+
+bool SscmaCamera::Capture() {
+    SscmaData data;
+
+    if (sscma_client_handle_ == nullptr) {
+        ESP_LOGE(TAG, "SSCMA client handle is not initialized");
+        return false;
+    }
+
+    // 上一张预览还在解码时不能替换 JPEG 数据
+    if (!WaitForPreview(pdMS_TO_TICKS(CAPTURE_TIMEOUT_MS))) {
+        ESP_LOGE(TAG, "Previous preview is still decoding");
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Capturing image...");
+    preview_decoded_ = false;
+
+    // himax 有缓存数据,需要拍两张照片, 只获取最新的照片即可.
+    // 按序号等待第二张图片到达，不再固定延时
+    uint32_t target_sequence = image_sequence_ + 2;
+    if (sscma_client_sample(sscma_client_handle_, 2) ) {
+        ESP_LOGE(TAG, "Failed to capture image from SSCMA client");
+        return false;
+    }
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(CAPTURE_TIMEOUT_MS);
+    while (true) {
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(deadline - now) <= 0 ||
+            xQueueReceive(sscma_data_queue_, &data, deadline - now) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to receive JPEG data from SSCMA client");
+            return false;
+        }
+        if ((int32_t)(data.sequence - target_sequence) >= 0) {
+            break;
+        }
+        heap_caps_free(data.img);
+    }
+
+    if (jpeg_data_.buf) {
+        heap_caps_free(jpeg_data_.buf);
+    }
+    jpeg_data_.buf = data.img;
+    jpeg_data_.len = data.len;
+
+    // JPEG 数据已就绪，预览在后台解码，识图上传可以立即开始
+    if (preview_task_ != nullptr) {
+        xEventGroupClearBits(preview_event_group_, PREVIEW_IDLE_BIT);
+        xTaskNotifyGive(preview_task_);
     }
     return true;
 }
+
 bool SscmaCamera::SetHMirror(bool enabled) {
     return false;
 }
@@ -297,6 +383,38 @@ std::string SscmaCamera::Explain(const std::string& question) {
     file_header += "Content-Type: image/jpeg\r\n";
     file_header += "\r\n";
     
+    if (jpeg_data_.buf == nullptr) {
+        return "{\"success\": false, \"message\": \"No captured image\"}";
+    }
+    // 预处理需要解码后的尺寸和像素，第一帧预览解码完成前拒绝识图
+    if (!WaitForPreview(pdMS_TO_TICKS(CAPTURE_TIMEOUT_MS)) || !preview_decoded_) {
+        return "{\"success\": false, \"message\": \"Preview image is not ready\"}";
+    }
+
+    // 需要缩放、裁剪或转灰度时，用解码后的预览重新编码，否则直接上传原始 JPEG
+    const uint8_t* jpeg = jpeg_data_.buf;
+    size_t jpeg_len = jpeg_data_.len;
+    uint8_t* reencoded = nullptr;
+    ImageRect roi;
+    int out_width, out_height;
+    if (ImagePreprocessGetLayout(explain_options_, preview_image_.header.w, preview_image_.header.h,
+            roi, out_width, out_height)) {
+        size_t processed_size = out_width * out_height * (explain_options_.grayscale ? 1 : 2);
+        auto processed = (uint8_t*)heap_caps_malloc(processed_size, MALLOC_CAP_SPIRAM);
+        if (processed != nullptr) {
+            ImagePreprocess(preview_image_.data, preview_image_.header.w, preview_image_.header.h, false,
+                explain_options_, processed, out_width, out_height);
+            size_t reencoded_len = 0;
+            if (fmt2jpg(processed, processed_size, out_width, out_height,
+                    explain_options_.grayscale ? PIXFORMAT_GRAYSCALE : PIXFORMAT_RGB565,
+                    CONFIG_CAMERA_JPEG_QUALITY, &reencoded, &reencoded_len)) {
+                jpeg = reencoded;
+                jpeg_len = reencoded_len;
+            }
+            heap_caps_free(processed);
+        }
+    }
+
     // 构造尾部
     std::string multipart_footer;
     multipart_footer += "\r\n--" + boundary + "--\r\n";
@@ -311,6 +429,7 @@ std::string SscmaCamera::Explain(const std::string& question) {
     http->SetHeader("Transfer-Encoding", "chunked");
     if (!http->Open("POST", explain_url_)) {
         ESP_LOGE(TAG, "Failed to connect to explain URL");
+        free(reencoded);
         return "{\"success\": false, \"message\": \"Failed to connect to explain URL\"}";
     }
     
@@ -321,7 +440,8 @@ std::string SscmaCamera::Explain(const std::string& question) {
     http->Write(file_header.c_str(), file_header.size());
     
     // 第三块：JPEG数据
-    http->Write((const char*)jpeg_data_.buf, jpeg_data_.len);
+    http->Write((const char*)jpeg, jpeg_len);
+    free(reencoded);
 
     // 第四块：multipart尾部
     http->Write(multipart_footer.c_str(), multipart_footer.size());
@@ -337,6 +457,6 @@ std::string SscmaCamera::Explain(const std::string& question) {
     std::string result = http->ReadAll();
     http->Close();
 
-    ESP_LOGI(TAG, "Explain image size=%d, question=%s\n%s", jpeg_data_.len, question.c_str(), result.c_str());
+    ESP_LOGI(TAG, "Explain image size=%d, question=%s\n%s", jpeg_len, question.c_str(), result.c_str());
     return result;
 }
@@ -2,11 +2,13 @@
 #define SSCMA_CAMERA_H
 
 #include <lvgl.h>
-#include <thread>
+#include <atomic>
 #include <memory>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
 #include <esp_io_expander_tca95xx_16bit.h>
 #include <esp_jpeg_dec.h>
 #include <mbedtls/base64.h>
@@ -14,9 +16,11 @@
 #include "sscma_client.h"
 #include "camera.h"
 
+// 回调中已解码为 JPEG 的图片，sequence 为收到图片的序号
 struct SscmaData {
     uint8_t* img;
     size_t len;
+    uint32_t sequence;
 };
 struct JpegData {
     uint8_t* buf;
@@ -26,20 +30,35 @@ struct JpegData {
 class SscmaCamera : public Camera {
 private:
     lv_img_dsc_t preview_image_;
+    // 后台解码写入后备缓冲区，完成后在显示锁内与 preview_image_ 交换，避免显示读到半帧
+    uint8_t* preview_back_buffer_ = nullptr;
     std::string explain_url_;
     std::string explain_token_;
-    sscma_client_io_handle_t sscma_client_io_handle_;
-    sscma_client_handle_t sscma_client_handle_;
-    QueueHandle_t sscma_data_queue_;
-    JpegData jpeg_data_;
-    jpeg_dec_handle_t *jpeg_dec_;
-    jpeg_dec_io_t *jpeg_io_;
-    jpeg_dec_header_info_t *jpeg_out_;
+    ImagePreprocessOptions explain_options_;
+    // 预览图已成功解码，可用于重新编码上传
+    bool preview_decoded_ = false;
+    sscma_client_io_handle_t sscma_client_io_handle_ = nullptr;
+    sscma_client_handle_t sscma_client_handle_ = nullptr;
+    QueueHandle_t sscma_data_queue_ = nullptr;
+    std::atomic<uint32_t> image_sequence_ = 0;
+    JpegData jpeg_data_ = {};
+    jpeg_dec_handle_t *jpeg_dec_ = nullptr;
+    jpeg_dec_io_t *jpeg_io_ = nullptr;
+    jpeg_dec_header_info_t *jpeg_out_ = nullptr;
+    // 预览解码在后台任务中进行，空闲时置位，拍照返回后即可开始上传
+    TaskHandle_t preview_task_ = nullptr;
+    EventGroupHandle_t preview_event_group_ = nullptr;
+
+    void PreviewTask();
+    void DecodePreview();
+    void SwapPreviewBuffer();
+    bool WaitForPreview(TickType_t timeout);
 public:
     SscmaCamera(esp_io_expander_handle_t io_exp_handle);
     ~SscmaCamera();
 
     virtual void SetExplainUrl(const std::string& url, const std::string& token);
+    virtual void SetExplainOptions(const ImagePreprocessOptions& options) override;
     virtual bool Capture();
     // 翻转控制函数
     virtual bool SetHMirror(bool enabled) override;
@@ -172,6 +172,7 @@ private:
             display->SetEmotion("neutral");
             GetBacklight()->RestoreBrightness(); });
         power_save_timer_->OnShutdownRequest([this](){ 
+            Settings::Flush();
             pmic_->PowerOff(); });
         power_save_timer_->SetEnabled(true);
     }
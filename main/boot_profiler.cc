@@ -0,0 +1,44 @@
+#include "boot_profiler.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cstring>
+#include <string>
+
+#define TAG "BootProfiler"
+
+void BootProfiler::Mark(const char* phase) {
+    int64_t now = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < count_; i++) {
+        if (strcmp(phases_[i].name, phase) == 0) {
+            return;
+        }
+    }
+    if (count_ >= BOOT_PROFILER_MAX_PHASES) {
+        ESP_LOGW(TAG, "Too many boot phases, dropping %s", phase);
+        return;
+    }
+    phases_[count_++] = {phase, now};
+    ESP_LOGI(TAG, "%s at %lld ms", phase, now / 1000);
+}
+
+cJSON* BootProfiler::GetJson() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto json = cJSON_CreateObject();
+    for (int i = 0; i < count_; i++) {
+        cJSON_AddNumberToObject(json, phases_[i].name, phases_[i].time_us / 1000);
+    }
+    return json;
+}
+
+void BootProfiler::PrintSummary() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string summary;
+    for (int i = 0; i < count_; i++) {
+        char buffer[48];
+        snprintf(buffer, sizeof(buffer), "%s%s=%lld", i > 0 ? ", " : "", phases_[i].name, phases_[i].time_us / 1000);
+        summary += buffer;
+    }
+    ESP_LOGI(TAG, "Boot phases (ms): %s", summary.c_str());
+}
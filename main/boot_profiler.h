@@ -0,0 +1,38 @@
+#ifndef _BOOT_PROFILER_H_
+#define _BOOT_PROFILER_H_
+
+#include <cJSON.h>
+#include <mutex>
+
+#define BOOT_PROFILER_MAX_PHASES 16
+
+// 记录启动各阶段完成的时刻（自上电起），用于日志和设备状态上报
+class BootProfiler {
+public:
+    static BootProfiler& GetInstance() {
+        static BootProfiler instance;
+        return instance;
+    }
+    BootProfiler(const BootProfiler&) = delete;
+    BootProfiler& operator=(const BootProfiler&) = delete;
+
+    // phase 需为字符串常量，同一阶段只记录第一次
+    void Mark(const char* phase);
+    // 返回 { "阶段": 毫秒, ... }
+    cJSON* GetJson();
+    void PrintSummary();
+
+private:
+    BootProfiler() = default;
+
+    struct Phase {
+        const char* name;
+        int64_t time_us;
+    };
+
+    std::mutex mutex_;
+    Phase phases_[BOOT_PROFILER_MAX_PHASES];
+    int count_ = 0;
+};
+
+#endif // _BOOT_PROFILER_H_
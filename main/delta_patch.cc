@@ -0,0 +1,260 @@
+#include "delta_patch.h"
+
+#include <esp_log.h>
+#include <cstring>
+#include <algorithm>
+
+#define TAG "DeltaPatch"
+
+DeltaPatch::DeltaPatch(std::function<bool(const DeltaPatchHeader& header)> on_header,
+    std::function<bool(size_t offset, uint8_t* data, size_t len)> read_old,
+    std::function<bool(const uint8_t* data, size_t len)> output)
+    : on_header_(on_header), read_old_(read_old), output_(output) {
+}
+
+bool DeltaPatch::Feed(const uint8_t* data, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        switch (state_) {
+        case kStateHeader: {
+            size_t n = std::min(sizeof(header_buffer_) - header_filled_, len - i);
+            memcpy(header_buffer_ + header_filled_, data + i, n);
+            header_filled_ += n;
+            i += n;
+            if (header_filled_ < sizeof(header_buffer_)) {
+                break;
+            }
+            if (memcmp(header_buffer_, DELTA_PATCH_MAGIC, 8) != 0) {
+                ESP_LOGE(TAG, "Invalid patch magic");
+                return false;
+            }
+            memcpy(&header_.old_size, header_buffer_ + 8, 4);
+            memcpy(&header_.new_size, header_buffer_ + 12, 4);
+            memcpy(header_.old_sha256, header_buffer_ + 16, 32);
+            memcpy(header_.new_sha256, header_buffer_ + 48, 32);
+            ESP_LOGI(TAG, "Patch %lu -> %lu bytes", header_.old_size, header_.new_size);
+            if (!on_header_(header_)) {
+                return false;
+            }
+            old_buffer_.resize(DELTA_PATCH_BUFFER_SIZE);
+            out_buffer_.resize(DELTA_PATCH_BUFFER_SIZE);
+            if (!NextBlock()) {
+                return false;
+            }
+            break;
+        }
+        case kStateSeek:
+        case kStateExtraLen:
+        case kStateDiffLen:
+        case kStateZeroRun:
+        case kStateLiteralLen: {
+            bool done = false;
+            if (!ReadVarint(data[i++], done)) {
+                return false;
+            }
+            if (done && !OnVarint()) {
+                return false;
+            }
+            break;
+        }
+        case kStateExtra: {
+            size_t n = std::min(remaining_, len - i);
+            if (!Output(data + i, n)) {
+                return false;
+            }
+            i += n;
+            remaining_ -= n;
+            if (remaining_ == 0) {
+                if (diff_remaining_ > 0) {
+                    state_ = kStateZeroRun;
+                } else if (!NextBlock()) {
+                    return false;
+                }
+            }
+            break;
+        }
+        case kStateLiteral: {
+            size_t n = std::min(remaining_, len - i);
+            for (size_t k = 0; k < n; k++) {
+                if (old_pos_ < old_buffer_start_ || old_pos_ >= old_buffer_start_ + old_buffer_len_) {
+                    if (!FillOld(old_pos_)) {
+                        return false;
+                    }
+                }
+                uint8_t value = old_buffer_[old_pos_ - old_buffer_start_] + data[i + k];
+                old_pos_++;
+                if (!Output(&value, 1)) {
+                    return false;
+                }
+            }
+            i += n;
+            remaining_ -= n;
+            if (remaining_ == 0) {
+                if (diff_remaining_ > 0) {
+                    state_ = kStateZeroRun;
+                } else if (!NextBlock()) {
+                    return false;
+                }
+            }
+            break;
+        }
+        case kStateFinished:
+            ESP_LOGE(TAG, "Unexpected data after the end of patch");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DeltaPatch::ReadVarint(uint8_t byte, bool& done) {
+    if (varint_shift_ > 28) {
+        ESP_LOGE(TAG, "Varint is too long");
+        return false;
+    }
+    varint_ |= (uint32_t)(byte & 0x7F) << varint_shift_;
+    varint_shift_ += 7;
+    done = (byte & 0x80) == 0;
+    return true;
+}
+
+bool DeltaPatch::OnVarint() {
+    uint32_t value = varint_;
+    varint_ = 0;
+    varint_shift_ = 0;
+
+    switch (state_) {
+    case kStateSeek: {
+        int64_t seek = (value & 1) ? -(int64_t)((value >> 1) + 1) : (int64_t)(value >> 1);
+        int64_t pos = (int64_t)old_pos_ + seek;
+        if (pos < 0 || pos > header_.old_size) {
+            ESP_LOGE(TAG, "Seek out of range: %lld", pos);
+            return false;
+        }
+        old_pos_ = pos;
+        state_ = kStateExtraLen;
+        return true;
+    }
+    case kStateExtraLen:
+        if (value > header_.new_size - output_size_) {
+            ESP_LOGE(TAG, "Extra length out of range: %lu", value);
+            return false;
+        }
+        remaining_ = value;
+        state_ = kStateDiffLen;
+        return true;
+    case kStateDiffLen:
+        if (value > header_.new_size - output_size_ - remaining_ || value > header_.old_size - old_pos_) {
+            ESP_LOGE(TAG, "Diff length out of range: %lu", value);
+            return false;
+        }
+        diff_remaining_ = value;
+        if (remaining_ > 0) {
+            state_ = kStateExtra;
+        } else if (diff_remaining_ > 0) {
+            state_ = kStateZeroRun;
+        } else {
+            ESP_LOGE(TAG, "Empty block");
+            return false;
+        }
+        return true;
+    case kStateZeroRun:
+        if (value > diff_remaining_) {
+            ESP_LOGE(TAG, "Zero run out of range: %lu", value);
+            return false;
+        }
+        diff_remaining_ -= value;
+        if (!CopyOld(value)) {
+            return false;
+        }
+        state_ = kStateLiteralLen;
+        return true;
+    case kStateLiteralLen:
+        if (value > diff_remaining_) {
+            ESP_LOGE(TAG, "Literal length out of range: %lu", value);
+            return false;
+        }
+        diff_remaining_ -= value;
+        remaining_ = value;
+        if (remaining_ > 0) {
+            state_ = kStateLiteral;
+        } else if (diff_remaining_ > 0) {
+            state_ = kStateZeroRun;
+        } else {
+            return NextBlock();
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+// 一个块结束，输出已完整时写出剩余数据并结束
+bool DeltaPatch::NextBlock() {
+    if (output_size_ == header_.new_size) {
+        if (!Flush()) {
+            return false;
+        }
+        state_ = kStateFinished;
+    } else {
+        state_ = kStateSeek;
+    }
+    return true;
+}
+
+bool DeltaPatch::FillOld(size_t pos) {
+    size_t len = std::min(old_buffer_.size(), (size_t)header_.old_size - pos);
+    if (!read_old_(pos, old_buffer_.data(), len)) {
+        ESP_LOGE(TAG, "Failed to read old firmware at %u", pos);
+        return false;
+    }
+    old_buffer_start_ = pos;
+    old_buffer_len_ = len;
+    return true;
+}
+
+bool DeltaPatch::CopyOld(size_t len) {
+    while (len > 0) {
+        if (old_pos_ < old_buffer_start_ || old_pos_ >= old_buffer_start_ + old_buffer_len_) {
+            if (!FillOld(old_pos_)) {
+                return false;
+            }
+        }
+        size_t offset = old_pos_ - old_buffer_start_;
+        size_t n = std::min(len, old_buffer_len_ - offset);
+        if (!Output(old_buffer_.data() + offset, n)) {
+            return false;
+        }
+        old_pos_ += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool DeltaPatch::Output(const uint8_t* data, size_t len) {
+    if (len > header_.new_size - output_size_) {
+        ESP_LOGE(TAG, "Output exceeds new size");
+        return false;
+    }
+    output_size_ += len;
+    while (len > 0) {
+        size_t n = std::min(len, out_buffer_.size() - out_filled_);
+        memcpy(out_buffer_.data() + out_filled_, data, n);
+        out_filled_ += n;
+        data += n;
+        len -= n;
+        if (out_filled_ == out_buffer_.size() && !Flush()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DeltaPatch::Flush() {
+    if (out_filled_ > 0) {
+        if (!output_(out_buffer_.data(), out_filled_)) {
+            return false;
+        }
+        out_filled_ = 0;
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef _DELTA_PATCH_H
+#define _DELTA_PATCH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#define DELTA_PATCH_MAGIC       "XZDELTA1"
+#define DELTA_PATCH_BUFFER_SIZE 4096
+
+/*
+ * 差分补丁格式，由 scripts/delta_patch.py 生成，整数为小端，varint 为 7 位一组的无符号变长整数
+ *
+ * 头部: magic[8] old_size(u32) new_size(u32) old_sha256[32] new_sha256[32]
+ * 之后是若干个块，输出达到 new_size 时结束:
+ *   seek (zigzag varint)  旧固件读取位置的相对移动
+ *   extra_len (varint)    随后的 extra_len 字节原样输出
+ *   diff_len (varint)     从旧固件读取 diff_len 字节，逐字节加上差值后输出
+ *   差值按 (zero_run, literal_len, literal_len 个差值字节) 分组，zero_run 为差值为 0 的字节数
+ */
+struct DeltaPatchHeader {
+    uint32_t old_size;
+    uint32_t new_size;
+    uint8_t old_sha256[32];
+    uint8_t new_sha256[32];
+};
+
+// 流式应用差分补丁，补丁数据可以任意分段输入，只使用两块固定大小的缓冲区
+class DeltaPatch {
+public:
+    // on_header 在解析出头部后调用，用于确认旧固件匹配；read_old 读取旧固件；output 写出新固件
+    DeltaPatch(std::function<bool(const DeltaPatchHeader& header)> on_header,
+        std::function<bool(size_t offset, uint8_t* data, size_t len)> read_old,
+        std::function<bool(const uint8_t* data, size_t len)> output);
+
+    bool Feed(const uint8_t* data, size_t len);
+    // 补丁已完整应用，所有输出都已写出
+    bool IsFinished() const { return state_ == kStateFinished; }
+    const DeltaPatchHeader& header() const { return header_; }
+
+private:
+    enum State {
+        kStateHeader,
+        kStateSeek,
+        kStateExtraLen,
+        kStateDiffLen,
+        kStateExtra,
+        kStateZeroRun,
+        kStateLiteralLen,
+        kStateLiteral,
+        kStateFinished,
+    };
+
+    std::function<bool(const DeltaPatchHeader& header)> on_header_;
+    std::function<bool(size_t offset, uint8_t* data, size_t len)> read_old_;
+    std::function<bool(const uint8_t* data, size_t len)> output_;
+
+    State state_ = kStateHeader;
+    DeltaPatchHeader header_ = {};
+    uint8_t header_buffer_[80];
+    size_t header_filled_ = 0;
+    uint32_t varint_ = 0;
+    int varint_shift_ = 0;
+    // 当前块剩余的 extra / diff / literal 字节数
+    size_t remaining_ = 0;
+    size_t diff_remaining_ = 0;
+    size_t old_pos_ = 0;
+    size_t output_size_ = 0;
+
+    // 旧固件读取窗口和输出缓冲区
+    std::vector<uint8_t> old_buffer_;
+    size_t old_buffer_start_ = 0;
+    size_t old_buffer_len_ = 0;
+    std::vector<uint8_t> out_buffer_;
+    size_t out_filled_ = 0;
+
+    bool ReadVarint(uint8_t byte, bool& done);
+    bool OnVarint();
+    bool NextBlock();
+    bool FillOld(size_t pos);
+    bool Output(const uint8_t* data, size_t len);
+    bool Flush();
+    bool CopyOld(size_t len);
+};
+
+#endif // _DELTA_PATCH_H
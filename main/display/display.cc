@@ -66,7 +66,10 @@ void Display::SetStatus(const char* status) {
     if (status_label_ == nullptr) {
         return;
     }
-    lv_label_set_text(status_label_, status);
+    // 文本未变化时不重绘
+    if (strcmp(lv_label_get_text(status_label_), status) != 0) {
+        lv_label_set_text(status_label_, status);
+    }
     lv_obj_clear_flag(status_label_, LV_OBJ_FLAG_HIDDEN);
     lv_obj_add_flag(notification_label_, LV_OBJ_FLAG_HIDDEN);
 }
@@ -91,31 +94,17 @@ void Display::ShowNotification(const char* notification, int duration_ms) {
 void Display::UpdateStatusBar(bool update_all) {
     auto& board = Board::GetInstance();
     auto codec = board.GetAudioCodec();
-
-    {
-        DisplayLockGuard lock(this);
-        if (mute_label_ == nullptr) {
-            return;
-        }
-
-        // 如果静音状态改变，则更新图标
-        if (codec->output_volume() == 0 && !muted_) {
-            muted_ = true;
-            lv_label_set_text(mute_label_, FONT_AWESOME_VOLUME_MUTE);
-        } else if (codec->output_volume() > 0 && muted_) {
-            muted_ = false;
-            lv_label_set_text(mute_label_, "");
-        }
-    }
+    bool muted = codec->output_volume() == 0;
 
     esp_pm_lock_acquire(pm_lock_);
     // 更新电池图标
     int battery_level;
     bool charging, discharging;
-    const char* icon = nullptr;
+    const char* battery_icon = nullptr;
+    bool low_battery = false;
     if (board.GetBatteryLevel(battery_level, charging, discharging)) {
         if (charging) {
-            icon = FONT_AWESOME_BATTERY_CHARGING;
+            battery_icon = FONT_AWESOME_BATTERY_CHARGING;
         } else {
             const char* levels[] = {
                 FONT_AWESOME_BATTERY_EMPTY, // 0-19%
@@ -125,31 +114,13 @@ void Display::UpdateStatusBar(bool update_all) {
                 FONT_AWESOME_BATTERY_FULL, // 80-99%
                 FONT_AWESOME_BATTERY_FULL, // 100%
             };
-            icon = levels[battery_level / 20];
-        }
-        DisplayLockGuard lock(this);
-        if (battery_label_ != nullptr && battery_icon_ != icon) {
-            battery_icon_ = icon;
-            lv_label_set_text(battery_label_, battery_icon_);
-        }
-
-        if (low_battery_popup_ != nullptr) {
-            if (strcmp(icon, FONT_AWESOME_BATTERY_EMPTY) == 0 && discharging) {
-                if (lv_obj_has_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN)) { // 如果低电量提示框隐藏，则显示
-                    lv_obj_clear_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
-                    auto& app = Application::GetInstance();
-                    app.PlaySound(Lang::Sounds::P3_LOW_BATTERY);
-                }
-            } else {
-                // Hide the low battery popup when the battery is not empty
-                if (!lv_obj_has_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN)) { // 如果低电量提示框显示，则隐藏
-                    lv_obj_add_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
-                }
-            }
+            battery_icon = levels[battery_level / 20];
         }
+        low_battery = strcmp(battery_icon, FONT_AWESOME_BATTERY_EMPTY) == 0 && discharging;
     }
 
     // 每 10 秒更新一次网络图标
+    const char* network_icon = nullptr;
     static int seconds_counter = 0;
     if (update_all || seconds_counter++ % 10 == 0) {
         // 升级固件时，不读取 4G 网络状态，避免占用 UART 资源
@@ -162,18 +133,171 @@ void Display::UpdateStatusBar(bool update_all) {
             kDeviceStateActivating,
         };
         if (std::find(allowed_states.begin(), allowed_states.end(), device_state) != allowed_states.end()) {
-            icon = board.GetNetworkStateIcon();
-            if (network_label_ != nullptr && icon != nullptr && network_icon_ != icon) {
-                DisplayLockGuard lock(this);
-                network_icon_ = icon;
-                lv_label_set_text(network_label_, network_icon_);
-            }
+            network_icon = board.GetNetworkStateIcon();
         }
     }
-
     esp_pm_lock_release(pm_lock_);
+
+    bool play_low_battery_sound = false;
+    {
+        std::lock_guard<std::mutex> lock(model_.mutex);
+        model_.muted = muted;
+        if (battery_icon != nullptr) {
+            model_.battery_icon = battery_icon;
+            // 低电量提示框从隐藏变为显示时播放提示音
+            play_low_battery_sound = low_battery && !model_.low_battery && low_battery_popup_ != nullptr;
+            model_.low_battery = low_battery;
+        }
+        if (network_icon != nullptr) {
+            model_.network_icon = network_icon;
+        }
+        model_.status_bar_dirty = true;
+    }
+    RequestApply();
+
+    if (play_low_battery_sound) {
+        Application::GetInstance().PlaySound(Lang::Sounds::P3_LOW_BATTERY);
+    }
 }
 
+void Display::PostUpdate(UpdateType type, const char* role, const char* text, int duration_ms) {
+    {
+        std::lock_guard<std::mutex> lock(model_.mutex);
+        auto& updates = model_.updates;
+        bool is_emotion = type == kUpdateEmotion || type == kUpdateIcon;
+        if (type != kUpdateChatMessage && !updates.empty() && (updates.back().type == type ||
+            (is_emotion && (updates.back().type == kUpdateEmotion || updates.back().type == kUpdateIcon)))) {
+            // 与队尾同类的更新合并，顺序不变
+            updates.back().type = type;
+        } else {
+            updates.emplace_back();
+            updates.back().type = type;
+        }
+        auto& update = updates.back();
+        strlcpy(update.role, role, sizeof(update.role));
+        update.text = text;
+        update.duration_ms = duration_ms;
+    }
+    RequestApply();
+}
+
+void Display::PostStatus(const char* status) {
+    PostUpdate(kUpdateStatus, "", status);
+}
+
+void Display::PostNotification(const char* notification, int duration_ms) {
+    PostUpdate(kUpdateNotification, "", notification, duration_ms);
+}
+
+void Display::PostEmotion(const char* emotion) {
+    PostUpdate(kUpdateEmotion, "", emotion);
+}
+
+void Display::PostIcon(const char* icon) {
+    PostUpdate(kUpdateIcon, "", icon);
+}
+
+void Display::PostChatMessage(const char* role, const char* content) {
+    PostUpdate(kUpdateChatMessage, role, content);
+}
+
+void Display::StartUpdateTimer() {
+    DisplayLockGuard lock(this);
+    if (update_timer_ != nullptr) {
+        return;
+    }
+    update_timer_ = lv_timer_create([](lv_timer_t* timer) {
+        static_cast<Display*>(lv_timer_get_user_data(timer))->ApplyModel();
+    }, LV_DEF_REFR_PERIOD, this);
+}
+
+void Display::StopUpdateTimer() {
+    // 定时器回调在 LVGL 任务中运行，删除前先持有显示锁
+    DisplayLockGuard lock(this);
+    if (update_timer_ != nullptr) {
+        lv_timer_delete(update_timer_);
+        update_timer_ = nullptr;
+    }
+}
+
+void Display::RequestApply() {
+    // 没有 LVGL 定时器的显示（如 NoDisplay）直接应用
+    if (update_timer_ == nullptr) {
+        ApplyModel();
+    }
+}
+
+// 在 LVGL 任务中运行，每个刷新周期最多应用一次
+void Display::ApplyModel() {
+    const char* battery_icon = nullptr;
+    const char* network_icon = nullptr;
+    bool muted = false;
+    bool low_battery = false;
+    bool status_bar_dirty = false;
+    applying_updates_.clear();
+    {
+        std::lock_guard<std::mutex> lock(model_.mutex);
+        if (model_.updates.empty() && !model_.status_bar_dirty) {
+            return;
+        }
+        applying_updates_.swap(model_.updates);
+        status_bar_dirty = model_.status_bar_dirty;
+        model_.status_bar_dirty = false;
+        battery_icon = model_.battery_icon;
+        network_icon = model_.network_icon;
+        muted = model_.muted;
+        low_battery = model_.low_battery;
+    }
+
+    DisplayLockGuard lock(this);
+    for (auto& update : applying_updates_) {
+        switch (update.type) {
+        case kUpdateStatus:
+            SetStatus(update.text.c_str());
+            break;
+        case kUpdateNotification:
+            ShowNotification(update.text.c_str(), update.duration_ms);
+            break;
+        case kUpdateEmotion:
+            SetEmotion(update.text.c_str());
+            break;
+        case kUpdateIcon:
+            SetIcon(update.text.c_str());
+            break;
+        case kUpdateChatMessage:
+            SetChatMessage(update.role, update.text.c_str());
+            break;
+        }
+    }
+    if (status_bar_dirty) {
+        ApplyStatusBar(battery_icon, network_icon, muted, low_battery);
+    }
+}
+
+void Display::ApplyStatusBar(const char* battery_icon, const char* network_icon, bool muted, bool low_battery) {
+    // 如果静音状态改变，则更新图标
+    if (mute_label_ != nullptr && muted != muted_) {
+        muted_ = muted;
+        lv_label_set_text(mute_label_, muted_ ? FONT_AWESOME_VOLUME_MUTE : "");
+    }
+    if (battery_label_ != nullptr && battery_icon != nullptr && battery_icon_ != battery_icon) {
+        battery_icon_ = battery_icon;
+        lv_label_set_text(battery_label_, battery_icon_);
+    }
+    if (network_label_ != nullptr && network_icon != nullptr && network_icon_ != network_icon) {
+        network_icon_ = network_icon;
+        lv_label_set_text(network_label_, network_icon_);
+    }
+    if (low_battery_popup_ != nullptr && battery_icon != nullptr) {
+        if (low_battery == lv_obj_has_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN)) {
+            if (low_battery) {
+                lv_obj_clear_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
+            } else {
+                lv_obj_add_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
+            }
+        }
+    }
+}
 
 void Display::SetEmotion(const char* emotion) {
     struct Emotion {
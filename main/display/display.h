@@ -7,6 +7,8 @@
 #include <esp_pm.h>
 
 #include <string>
+#include <mutex>
+#include <vector>
 
 struct DisplayFonts {
     const lv_font_t* text_font = nullptr;
@@ -30,6 +32,14 @@ public:
     virtual std::string GetTheme() { return current_theme_name_; }
     virtual void UpdateStatusBar(bool update_all = false);
 
+    // 只记录期望的显示状态，可在任意任务中调用，不会争用显示锁
+    // 由 LVGL 任务在每个刷新周期合并后统一应用
+    void PostStatus(const char* status);
+    void PostNotification(const char* notification, int duration_ms = 3000);
+    void PostEmotion(const char* emotion);
+    void PostIcon(const char* icon);
+    void PostChatMessage(const char* role, const char* content);
+
     inline int width() const { return width_; }
     inline int height() const { return height_; }
 
@@ -57,9 +67,53 @@ protected:
 
     esp_timer_handle_t notification_timer_ = nullptr;
 
+    // 需要在 LVGL 初始化之后调用，之前 Post 的状态会立即应用
+    void StartUpdateTimer();
+    // 子类析构时在删除 LVGL 对象之前调用，基类析构时已无法获取显示锁
+    void StopUpdateTimer();
+
     friend class DisplayLockGuard;
     virtual bool Lock(int timeout_ms = 0) = 0;
     virtual void Unlock() = 0;
+
+private:
+    enum UpdateType {
+        kUpdateStatus,
+        kUpdateNotification,
+        kUpdateEmotion,
+        kUpdateIcon,
+        kUpdateChatMessage,
+    };
+
+    struct Update {
+        UpdateType type;
+        char role[16];
+        std::string text;
+        int duration_ms;
+    };
+
+    // 生产者按调用顺序写入的更新，由 update_timer_ 按同样的顺序应用
+    struct Model {
+        std::mutex mutex;
+        // 聊天消息全部保留；状态、通知和表情与队尾同类的更新合并，只保留最新的值
+        std::vector<Update> updates;
+        bool status_bar_dirty = false;
+        const char* battery_icon = nullptr;
+        const char* network_icon = nullptr;
+        bool muted = false;
+        bool low_battery = false;
+    } model_;
+
+    lv_timer_t* update_timer_ = nullptr;
+
+    // 正在应用的更新，与队列交换以复用内存
+    std::vector<Update> applying_updates_;
+
+    void PostUpdate(UpdateType type, const char* role, const char* text, int duration_ms = 0);
+
+    void RequestApply();
+    void ApplyModel();
+    void ApplyStatusBar(const char* battery_icon, const char* network_icon, bool muted, bool low_battery);
 };
 
 
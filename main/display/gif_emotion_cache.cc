@@ -0,0 +1,310 @@
+#include "gif_emotion_cache.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <esp_lvgl_port.h>
+#include <libs/gif/lv_gif.h>
+#include <libs/gif/gifdec.h>
+
+#include <algorithm>
+
+#define TAG "GifEmotionCache"
+
+// GIF 未指定帧间隔时按 100ms 播放
+#define GIF_DEFAULT_DELAY_MS    100
+
+GifEmotionCache::GifEmotionCache(size_t budget_bytes) : budget_(budget_bytes) {
+    request_queue_ = xQueueCreate(16, sizeof(const lv_image_dsc_t*));
+    xTaskCreate([](void* arg) {
+        static_cast<GifEmotionCache*>(arg)->DecoderTask();
+    }, "emotion_cache", 4096, this, 1, &decoder_task_);
+}
+
+GifEmotionCache::~GifEmotionCache() {
+    if (decoder_task_ != nullptr) {
+        vTaskDelete(decoder_task_);
+    }
+    if (request_queue_ != nullptr) {
+        vQueueDelete(request_queue_);
+    }
+    FreeFrames(entries_);
+}
+
+void GifEmotionCache::Preload(const lv_image_dsc_t* gif) {
+    if (budget_ == 0 || gif == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 多个表情可能共用同一个 GIF
+        if (std::find(preload_.begin(), preload_.end(), gif) != preload_.end() || Find(gif) != nullptr ||
+            std::find(rejected_.begin(), rejected_.end(), gif) != rejected_.end()) {
+            return;
+        }
+        preload_.push_back(gif);
+    }
+    // 空请求只用于唤醒解码任务，队列已满时任务本来就会被唤醒
+    const lv_image_dsc_t* wakeup = nullptr;
+    xQueueSend(request_queue_, &wakeup, 0);
+}
+
+const lv_image_dsc_t* GifEmotionCache::NextPreload() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (preload_.empty()) {
+        return nullptr;
+    }
+    auto gif = preload_.front();
+    preload_.pop_front();
+    return gif;
+}
+
+GifFrames* GifEmotionCache::Acquire(const lv_image_dsc_t* gif) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = Find(gif);
+    if (entry != nullptr) {
+        entry->pins++;
+        entry->last_used = ++use_counter_;
+        return entry;
+    }
+    if (budget_ > 0 && std::find(rejected_.begin(), rejected_.end(), gif) == rejected_.end()) {
+        xQueueSendToFront(request_queue_, &gif, 0);
+    }
+    return nullptr;
+}
+
+void GifEmotionCache::Release(GifFrames* frames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frames->pins--;
+}
+
+GifFrames* GifEmotionCache::Find(const lv_image_dsc_t* gif) {
+    for (auto entry : entries_) {
+        if (entry->source == gif) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+// 需持有 mutex_，预算不足时淘汰最久未使用且未在播放的动画
+// 被淘汰的动画放入 evicted，由调用方在释放 mutex_ 后调用 FreeFrames
+bool GifEmotionCache::Reserve(size_t size, std::vector<GifFrames*>& evicted) {
+    while (used_ + size > budget_) {
+        auto victim = entries_.end();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if ((*it)->pins == 0 && (victim == entries_.end() || (*it)->last_used < (*victim)->last_used)) {
+                victim = it;
+            }
+        }
+        if (victim == entries_.end()) {
+            return false;
+        }
+        ESP_LOGI(TAG, "Evict %p, %zu frames, %zu bytes", (*victim)->source, (*victim)->frames.size(), (*victim)->size);
+        used_ -= (*victim)->size;
+        evicted.push_back(*victim);
+        entries_.erase(victim);
+    }
+    used_ += size;
+    return true;
+}
+
+// 图片缓存中可能还有以帧描述符为键的条目，需要在显示锁内清除，因此不能持有 mutex_ 调用
+void GifEmotionCache::FreeFrames(std::vector<GifFrames*>& entries) {
+    if (entries.empty()) {
+        return;
+    }
+    lvgl_port_lock(0);
+    for (auto entry : entries) {
+        for (auto& frame : entry->frames) {
+            lv_image_cache_drop(&frame);
+        }
+    }
+    lvgl_port_unlock();
+    for (auto entry : entries) {
+        for (auto& frame : entry->frames) {
+            heap_caps_free((void*)frame.data);
+        }
+        delete entry;
+    }
+    entries.clear();
+}
+
+void GifEmotionCache::DecoderTask() {
+    while (true) {
+        const lv_image_dsc_t* gif = nullptr;
+        // 优先处理播放时的请求，空闲时再按顺序预解码
+        if (xQueueReceive(request_queue_, &gif, 0) != pdTRUE) {
+            gif = NextPreload();
+            if (gif == nullptr) {
+                xQueueReceive(request_queue_, &gif, portMAX_DELAY);
+            }
+        }
+        if (gif != nullptr) {
+            Decode(gif);
+        }
+    }
+}
+
+void GifEmotionCache::Decode(const lv_image_dsc_t* gif) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (Find(gif) != nullptr || std::find(rejected_.begin(), rejected_.end(), gif) != rejected_.end()) {
+            return;
+        }
+    }
+
+    gd_GIF* decoder = gd_open_gif_data(gif->data);
+    if (decoder == nullptr) {
+        ESP_LOGE(TAG, "Failed to open gif %p", gif);
+        std::lock_guard<std::mutex> lock(mutex_);
+        rejected_.push_back(gif);
+        return;
+    }
+
+    int64_t start_time = esp_timer_get_time();
+    auto entry = new GifFrames();
+    entry->source = gif;
+    int width = decoder->width;
+    int height = decoder->height;
+    size_t frame_size = width * height * 3;
+    bool ok = true;
+    std::vector<GifFrames*> evicted;
+    while (gd_get_frame(decoder) == 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ok = Reserve(frame_size, evicted);
+        }
+        FreeFrames(evicted);
+        auto data = ok ? (uint8_t*)heap_caps_malloc(frame_size, MALLOC_CAP_SPIRAM) : nullptr;
+        if (data == nullptr) {
+            if (ok) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                used_ -= frame_size;
+            }
+            ok = false;
+            break;
+        }
+        entry->size += frame_size;
+
+        // 与 lv_gif 相同，直接渲染到解码器画布（ARGB8888），再拆分为 RGB565 平面和 Alpha 平面
+        gd_render_frame(decoder, decoder->canvas);
+        auto argb = (const lv_color32_t*)decoder->canvas;
+        auto rgb = (uint16_t*)data;
+        auto alpha = data + width * height * 2;
+        for (int i = 0; i < width * height; i++) {
+            rgb[i] = lv_color_to_u16(lv_color_make(argb[i].red, argb[i].green, argb[i].blue));
+            alpha[i] = argb[i].alpha;
+        }
+
+        lv_image_dsc_t frame = {};
+        frame.header.magic = LV_IMAGE_HEADER_MAGIC;
+        frame.header.cf = LV_COLOR_FORMAT_RGB565A8;
+        frame.header.w = width;
+        frame.header.h = height;
+        frame.header.stride = width * 2;
+        frame.data_size = frame_size;
+        frame.data = data;
+        entry->frames.push_back(frame);
+        entry->delays_ms.push_back(decoder->gce.delay > 0 ? decoder->gce.delay * 10 : GIF_DEFAULT_DELAY_MS);
+        // 解码任务优先级低，逐帧让出 CPU，避免影响音频和界面
+        taskYIELD();
+    }
+    gd_close_gif(decoder);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ok || entry->frames.empty()) {
+        ESP_LOGW(TAG, "Gif %p does not fit in the cache budget (%zu bytes)", gif, budget_);
+        used_ -= entry->size;
+        // 尚未显示过，不在图片缓存中，可以直接释放
+        for (auto& frame : entry->frames) {
+            heap_caps_free((void*)frame.data);
+        }
+        delete entry;
+        rejected_.push_back(gif);
+        return;
+    }
+    entry->last_used = ++use_counter_;
+    entries_.push_back(entry);
+    ESP_LOGI(TAG, "Cached %p, %dx%d, %zu frames, %zu bytes in %lld ms, used %zu/%zu", gif, width, height,
+        entry->frames.size(), entry->size, (esp_timer_get_time() - start_time) / 1000, used_, budget_);
+}
+
+GifEmotionPlayer::GifEmotionPlayer(lv_obj_t* parent, int size, GifEmotionCache* cache)
+    : cache_(cache), parent_(parent), size_(size) {
+    image_ = lv_image_create(parent_);
+    lv_obj_set_size(image_, size_, size_);
+    lv_obj_set_style_border_width(image_, 0, 0);
+    lv_obj_set_style_bg_opa(image_, LV_OPA_TRANSP, 0);
+    lv_obj_center(image_);
+    lv_obj_add_flag(image_, LV_OBJ_FLAG_HIDDEN);
+
+    timer_ = lv_timer_create([](lv_timer_t* timer) {
+        auto self = static_cast<GifEmotionPlayer*>(lv_timer_get_user_data(timer));
+        if (self->frames_ != nullptr) {
+            self->ShowFrame((self->frame_index_ + 1) % self->frames_->frames.size());
+        }
+    }, GIF_DEFAULT_DELAY_MS, this);
+    lv_timer_pause(timer_);
+}
+
+GifEmotionPlayer::~GifEmotionPlayer() {
+    lv_timer_delete(timer_);
+    if (frames_ != nullptr) {
+        cache_->Release(frames_);
+    }
+}
+
+void GifEmotionPlayer::ShowFrame(size_t index) {
+    frame_index_ = index;
+    lv_image_set_src(image_, &frames_->frames[index]);
+    lv_timer_set_period(timer_, frames_->delays_ms[index]);
+}
+
+void GifEmotionPlayer::Play(const lv_image_dsc_t* gif) {
+    if (gif == source_ && frames_ != nullptr) {
+        return;
+    }
+
+    // 同一表情正在实时解码时，也检查后台是否已经缓存完成
+    auto frames = cache_->Acquire(gif);
+    if (frames != nullptr) {
+        if (frames_ != nullptr) {
+            cache_->Release(frames_);
+        }
+        frames_ = frames;
+        source_ = gif;
+        if (gif_ != nullptr) {
+            lv_obj_delete(gif_);
+            gif_ = nullptr;
+        }
+        lv_obj_remove_flag(image_, LV_OBJ_FLAG_HIDDEN);
+        ShowFrame(0);
+        lv_timer_reset(timer_);
+        lv_timer_resume(timer_);
+        return;
+    }
+
+    if (gif == source_ && gif_ != nullptr) {
+        return;
+    }
+
+    // 尚未缓存，回退到 lv_gif
+    lv_timer_pause(timer_);
+    lv_obj_add_flag(image_, LV_OBJ_FLAG_HIDDEN);
+    lv_image_set_src(image_, nullptr);
+    if (frames_ != nullptr) {
+        cache_->Release(frames_);
+        frames_ = nullptr;
+    }
+    if (gif_ == nullptr) {
+        gif_ = lv_gif_create(parent_);
+        lv_obj_set_size(gif_, size_, size_);
+        lv_obj_set_style_border_width(gif_, 0, 0);
+        lv_obj_set_style_bg_opa(gif_, LV_OPA_TRANSP, 0);
+        lv_obj_center(gif_);
+        lv_obj_move_to_index(gif_, lv_obj_get_index(image_));
+    }
+    lv_gif_set_src(gif_, gif);
+    source_ = gif;
+}
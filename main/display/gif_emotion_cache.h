@@ -0,0 +1,80 @@
+#ifndef GIF_EMOTION_CACHE_H
+#define GIF_EMOTION_CACHE_H
+
+#include <lvgl.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// 预解码的 GIF 动画，每帧为 RGB565A8 格式存放在 PSRAM，LVGL 可直接绘制
+struct GifFrames {
+    const lv_image_dsc_t* source = nullptr;
+    std::vector<lv_image_dsc_t> frames;
+    std::vector<uint32_t> delays_ms;
+    size_t size = 0;
+    uint32_t last_used = 0;
+    // 正在播放的动画不会被淘汰
+    int pins = 0;
+};
+
+// 表情动画缓存，在后台任务中预解码 GIF，超出内存预算时淘汰最久未使用的动画
+class GifEmotionCache {
+public:
+    GifEmotionCache(size_t budget_bytes);
+    ~GifEmotionCache();
+
+    // 按调用顺序在后台预解码，常用表情应先加入，重复的 GIF 只解码一次
+    void Preload(const lv_image_dsc_t* gif);
+    // 返回已解码的动画并标记为使用中，未缓存时返回 nullptr 并优先安排解码
+    GifFrames* Acquire(const lv_image_dsc_t* gif);
+    void Release(GifFrames* frames);
+
+private:
+    size_t budget_;
+    size_t used_ = 0;
+    uint32_t use_counter_ = 0;
+    std::mutex mutex_;
+    std::vector<GifFrames*> entries_;
+    // 超出预算无法缓存的动画，不再重复尝试
+    std::vector<const lv_image_dsc_t*> rejected_;
+    // 待预解码的动画不限数量，队列只用于播放时的优先请求和唤醒解码任务
+    std::deque<const lv_image_dsc_t*> preload_;
+    QueueHandle_t request_queue_ = nullptr;
+    TaskHandle_t decoder_task_ = nullptr;
+
+    void DecoderTask();
+    void Decode(const lv_image_dsc_t* gif);
+    const lv_image_dsc_t* NextPreload();
+    GifFrames* Find(const lv_image_dsc_t* gif);
+    bool Reserve(size_t size, std::vector<GifFrames*>& evicted);
+    void FreeFrames(std::vector<GifFrames*>& entries);
+};
+
+// 表情动画播放器，已缓存的动画逐帧切换图片源，未缓存时回退到 lv_gif 实时解码
+// 所有方法都需要在持有显示锁时调用
+class GifEmotionPlayer {
+public:
+    GifEmotionPlayer(lv_obj_t* parent, int size, GifEmotionCache* cache);
+    ~GifEmotionPlayer();
+
+    void Play(const lv_image_dsc_t* gif);
+
+private:
+    GifEmotionCache* cache_;
+    lv_obj_t* parent_;
+    int size_;
+    lv_obj_t* image_ = nullptr;
+    lv_obj_t* gif_ = nullptr;
+    lv_timer_t* timer_ = nullptr;
+    const lv_image_dsc_t* source_ = nullptr;
+    GifFrames* frames_ = nullptr;
+    size_t frame_index_ = 0;
+
+    void ShowFrame(size_t index);
+};
+
+#endif // GIF_EMOTION_CACHE_H
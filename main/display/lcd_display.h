@@ -5,6 +5,7 @@
 
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_ops.h>
+#include <esp_lvgl_port.h>
 #include <font_emoji.h>
 
 #include <atomic>
@@ -38,7 +39,38 @@ protected:
     DisplayFonts fonts_;
     ThemeColors current_theme_;
 
+    struct RenderTiming {
+        int64_t frame_start = 0;
+        int64_t render_start = 0;
+        int64_t flush_wait_start = 0;
+        int64_t frame_us = 0;
+        int64_t render_us = 0;
+        int64_t flush_wait_us = 0;
+        int frames = 0;
+    } render_timing_;
+
+    // 按角色划分的共享样式，切换主题时只更新样式本身
+    lv_style_t style_background_;
+    lv_style_t style_chat_background_;
+    lv_style_t style_low_battery_;
+#if CONFIG_USE_WECHAT_MESSAGE_STYLE
+    // 消息行超过上限后循环复用
+    lv_style_t style_message_row_;
+    lv_style_t style_bubble_;
+    lv_style_t style_bubble_user_;
+    lv_style_t style_bubble_assistant_;
+    lv_style_t style_bubble_system_;
+    // 引用摄像头预览缓冲区的气泡，同一时间只有一个
+    lv_obj_t* preview_bubble_ = nullptr;
+
+    lv_obj_t* CreateMessageRow();
+#endif
+
+    void InitializeStyles();
+    void UpdateStyles();
     void SetupUI();
+    void ConfigureDrawBuffer(lvgl_port_display_cfg_t& cfg);
+    void EnableRenderTiming();
     virtual bool Lock(int timeout_ms = 0) override;
     virtual void Unlock() override;
 
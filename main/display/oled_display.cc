@@ -3,11 +3,13 @@
 #include "assets/lang_config.h"
 
 #include <string>
+#include <cstring>
 #include <algorithm>
 
 #include <esp_log.h>
 #include <esp_err.h>
 #include <esp_lvgl_port.h>
+#include <esp_heap_caps.h>
 
 #define TAG "OledDisplay"
 
@@ -56,14 +58,29 @@ OledDisplay::OledDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handl
         return;
     }
 
+    // 使用自己的刷新回调：LVGL 只重绘失效区域，刷新时按页比较，只通过 I2C 发送变化的部分
+    panel_pages_ = (uint8_t*)heap_caps_malloc(width_ * height_ / 8, MALLOC_CAP_DMA);
+    page_scratch_ = (uint8_t*)heap_caps_malloc(width_, MALLOC_CAP_INTERNAL);
+    if (panel_pages_ != nullptr && page_scratch_ != nullptr) {
+        // 刷新回调已替换，用户数据改为指向本对象，移除显示前还原为 esp_lvgl_port 的上下文
+        port_ctx_ = lv_display_get_user_data(display_);
+        lv_display_set_user_data(display_, this);
+        lv_display_set_render_mode(display_, LV_DISPLAY_RENDER_MODE_DIRECT);
+        lv_display_set_flush_cb(display_, FlushCallback);
+    } else {
+        ESP_LOGW(TAG, "Failed to allocate page buffers, fall back to full refresh");
+    }
+
     if (height_ == 64) {
         SetupUI_128x64();
     } else {
         SetupUI_128x32();
     }
+    StartUpdateTimer();
 }
 
 OledDisplay::~OledDisplay() {
+    StopUpdateTimer();
     if (content_ != nullptr) {
         lv_obj_del(content_);
     }
@@ -83,7 +100,74 @@ OledDisplay::~OledDisplay() {
     if (panel_io_ != nullptr) {
         esp_lcd_panel_io_del(panel_io_);
     }
+    if (display_ != nullptr && port_ctx_ != nullptr) {
+        lv_display_set_user_data(display_, port_ctx_);
+    }
     lvgl_port_deinit();
+    heap_caps_free(panel_pages_);
+    heap_caps_free(page_scratch_);
+}
+
+void OledDisplay::FlushCallback(lv_display_t* disp, const lv_area_t* area, uint8_t* px_map) {
+    auto self = static_cast<OledDisplay*>(lv_display_get_user_data(disp));
+    // 直接模式下缓冲区常驻，px_map 指向整屏缓冲区起始，收集本次所有失效区域后统一发送
+    self->dirty_y1_ = std::min(self->dirty_y1_, (int)area->y1);
+    self->dirty_y2_ = std::max(self->dirty_y2_, (int)area->y2);
+    if (lv_display_flush_is_last(disp)) {
+        self->FlushPages(px_map, self->dirty_y1_, self->dirty_y2_);
+        self->dirty_y1_ = INT_MAX;
+        self->dirty_y2_ = -1;
+    }
+    lv_display_flush_ready(disp);
+}
+
+void OledDisplay::FlushPages(const uint8_t* px_map, int y1, int y2) {
+    if (!panel_synced_) {
+        y1 = 0;
+        y2 = height_ - 1;
+        panel_synced_ = true;
+    }
+    auto cf = lv_display_get_color_format(display_);
+    uint32_t stride = lv_draw_buf_width_to_stride(width_, cf);
+    if (cf == LV_COLOR_FORMAT_I1) {
+        px_map += 8;  // 跳过调色板
+    }
+
+    for (int page = y1 / 8; page <= y2 / 8; page++) {
+        // 深色像素点亮，与 esp_lvgl_port 的单色转换一致
+        memset(page_scratch_, 0, width_);
+        for (int bit = 0; bit < 8; bit++) {
+            const uint8_t* row = px_map + (page * 8 + bit) * stride;
+            for (int x = 0; x < width_; x++) {
+                bool lit;
+                if (cf == LV_COLOR_FORMAT_I1) {
+                    lit = !(row[x >> 3] & (0x80 >> (x & 7)));
+                } else {
+                    uint16_t pixel = ((const uint16_t*)row)[x];
+                    int luma = ((pixel >> 11) * 8 * 77 + ((pixel >> 5) & 0x3F) * 4 * 150 + (pixel & 0x1F) * 8 * 29) >> 8;
+                    lit = luma < 128;
+                }
+                if (lit) {
+                    page_scratch_[x] |= 1 << bit;
+                }
+            }
+        }
+
+        uint8_t* panel_page = panel_pages_ + page * width_;
+        int first = 0;
+        while (first < width_ && page_scratch_[first] == panel_page[first]) {
+            first++;
+        }
+        if (first == width_) {
+            continue;
+        }
+        int last = width_ - 1;
+        while (page_scratch_[last] == panel_page[last]) {
+            last--;
+        }
+        memcpy(panel_page + first, page_scratch_ + first, last - first + 1);
+        esp_lcd_panel_draw_bitmap(panel_, first, page * 8, last + 1, page * 8 + 8, panel_page + first);
+    }
 }
 
 bool OledDisplay::Lock(int timeout_ms) {
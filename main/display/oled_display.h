@@ -6,6 +6,8 @@
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_ops.h>
 
+#include <climits>
+
 class OledDisplay : public Display {
 private:
     esp_lcd_panel_io_handle_t panel_io_ = nullptr;
@@ -20,6 +22,18 @@ private:
 
     DisplayFonts fonts_;
 
+    // 面板显存的镜像（SSD1306 页格式），只发送与之不同的列区间
+    uint8_t* panel_pages_ = nullptr;
+    uint8_t* page_scratch_ = nullptr;
+    bool panel_synced_ = false;
+    int dirty_y1_ = INT_MAX;
+    int dirty_y2_ = -1;
+
+    // esp_lvgl_port 存放在显示用户数据中的上下文，析构时还原
+    void* port_ctx_ = nullptr;
+    static void FlushCallback(lv_display_t* disp, const lv_area_t* area, uint8_t* px_map);
+    void FlushPages(const uint8_t* px_map, int y1, int y2);
+
     virtual bool Lock(int timeout_ms = 0) override;
     virtual void Unlock() override;
 
@@ -0,0 +1,67 @@
+#include "inflate_stream.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+
+#define TAG "InflateStream"
+
+InflateStream::InflateStream(std::function<bool(const uint8_t* data, size_t len)> output) : output_(output) {
+}
+
+InflateStream::~InflateStream() {
+    heap_caps_free(decompressor_);
+    heap_caps_free(dict_);
+}
+
+bool InflateStream::Initialize() {
+    // 解压状态约 11KB，与窗口一样优先放在 PSRAM
+    decompressor_ = (tinfl_decompressor*)heap_caps_malloc(sizeof(tinfl_decompressor), MALLOC_CAP_SPIRAM);
+    if (decompressor_ == nullptr) {
+        decompressor_ = (tinfl_decompressor*)heap_caps_malloc(sizeof(tinfl_decompressor), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    dict_ = (uint8_t*)heap_caps_malloc(TINFL_LZ_DICT_SIZE, MALLOC_CAP_SPIRAM);
+    if (dict_ == nullptr) {
+        dict_ = (uint8_t*)heap_caps_malloc(TINFL_LZ_DICT_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (decompressor_ == nullptr || dict_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate decompressor");
+        return false;
+    }
+    tinfl_init(decompressor_);
+    return true;
+}
+
+bool InflateStream::Feed(const uint8_t* data, size_t len) {
+    const mz_uint32 flags = TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT | TINFL_FLAG_COMPUTE_ADLER32;
+    while (!finished_) {
+        size_t in_bytes = len;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - dict_offset_;
+        auto status = tinfl_decompress(decompressor_, data, &in_bytes, dict_, dict_ + dict_offset_, &out_bytes, flags);
+        data += in_bytes;
+        len -= in_bytes;
+
+        if (out_bytes > 0) {
+            if (!output_(dict_ + dict_offset_, out_bytes)) {
+                return false;
+            }
+            dict_offset_ = (dict_offset_ + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+            output_size_ += out_bytes;
+        }
+
+        if (status < TINFL_STATUS_DONE) {
+            ESP_LOGE(TAG, "Failed to decompress, status: %d", status);
+            return false;
+        }
+        if (status == TINFL_STATUS_DONE) {
+            finished_ = true;
+        } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+            return true;
+        }
+        // TINFL_STATUS_HAS_MORE_OUTPUT: 窗口已写满一圈，继续输出
+    }
+    if (len > 0) {
+        ESP_LOGE(TAG, "Unexpected data after the end of stream");
+        return false;
+    }
+    return true;
+}
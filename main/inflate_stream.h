@@ -0,0 +1,35 @@
+#ifndef _INFLATE_STREAM_H
+#define _INFLATE_STREAM_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+#include <rom/miniz.h>
+
+// zlib 格式的头两个字节，deflate 使用 32KB 窗口时第一个字节固定为 0x78
+#define INFLATE_STREAM_ZLIB_CMF 0x78
+
+// 使用 ROM 中的 tinfl 流式解压 zlib 数据，窗口为固定的 32KB 环形缓冲区，解压结果直接从窗口输出
+class InflateStream {
+public:
+    InflateStream(std::function<bool(const uint8_t* data, size_t len)> output);
+    ~InflateStream();
+
+    // 分配解压状态和窗口，失败时返回 false
+    bool Initialize();
+    bool Feed(const uint8_t* data, size_t len);
+    // 已解压到 zlib 流结尾并通过 Adler-32 校验
+    bool IsFinished() const { return finished_; }
+    size_t output_size() const { return output_size_; }
+
+private:
+    std::function<bool(const uint8_t* data, size_t len)> output_;
+    tinfl_decompressor* decompressor_ = nullptr;
+    uint8_t* dict_ = nullptr;
+    size_t dict_offset_ = 0;
+    size_t output_size_ = 0;
+    bool finished_ = false;
+};
+
+#endif // _INFLATE_STREAM_H
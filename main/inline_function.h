@@ -0,0 +1,97 @@
+#ifndef INLINE_FUNCTION_H
+#define INLINE_FUNCTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// A move-only void() callable with inline storage.
+// Callables up to Capacity bytes are stored in place, larger ones fall back to the heap.
+template<size_t Capacity>
+class InlineFunction {
+public:
+    template<typename F>
+    static constexpr bool fits_inline = sizeof(std::decay_t<F>) <= Capacity &&
+        alignof(std::decay_t<F>) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<std::decay_t<F>>;
+
+    InlineFunction() = default;
+
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunction>>>
+    InlineFunction(F&& callback) {
+        using T = std::decay_t<F>;
+        if constexpr (fits_inline<F>) {
+            new (storage_) T(std::forward<F>(callback));
+            invoke_ = [](void* storage) { (*static_cast<T*>(storage))(); };
+            manage_ = [](void* dst, void* src) {
+                if (dst != nullptr) {
+                    new (dst) T(std::move(*static_cast<T*>(src)));
+                }
+                static_cast<T*>(src)->~T();
+            };
+        } else {
+            *reinterpret_cast<T**>(storage_) = new T(std::forward<F>(callback));
+            invoke_ = [](void* storage) { (**static_cast<T**>(storage))(); };
+            manage_ = [](void* dst, void* src) {
+                if (dst != nullptr) {
+                    *static_cast<T**>(dst) = *static_cast<T**>(src);
+                } else {
+                    delete *static_cast<T**>(src);
+                }
+            };
+        }
+    }
+
+    InlineFunction(InlineFunction&& other) noexcept {
+        MoveFrom(other);
+    }
+
+    InlineFunction& operator=(InlineFunction&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    ~InlineFunction() {
+        Reset();
+    }
+
+    void operator()() {
+        invoke_(storage_);
+    }
+
+    explicit operator bool() const { return invoke_ != nullptr; }
+
+    void Reset() {
+        if (manage_ != nullptr) {
+            manage_(nullptr, storage_);
+        }
+        invoke_ = nullptr;
+        manage_ = nullptr;
+    }
+
+private:
+    alignas(std::max_align_t) uint8_t storage_[Capacity < sizeof(void*) ? sizeof(void*) : Capacity];
+    void (*invoke_)(void* storage) = nullptr;
+    // Move the callable from src into dst and destroy src, or just destroy src if dst is null
+    void (*manage_)(void* dst, void* src) = nullptr;
+
+    void MoveFrom(InlineFunction& other) {
+        if (other.manage_ != nullptr) {
+            other.manage_(storage_, other.storage_);
+        }
+        invoke_ = other.invoke_;
+        manage_ = other.manage_;
+        other.invoke_ = nullptr;
+        other.manage_ = nullptr;
+    }
+};
+
+#endif // INLINE_FUNCTION_H
@@ -8,12 +8,13 @@
 
 namespace iot {
 
-#if CONFIG_IOT_PROTOCOL_XIAOZHI
+#if CONFIG_IOT_PROTOCOL_XIAOZHI || CONFIG_IOT_MCP_BRIDGE
+// In MCP mode things are only created when the board opts in to the MCP bridge
 static std::map<std::string, std::function<Thing*()>>* thing_creators = nullptr;
 #endif
 
 void RegisterThing(const std::string& type, std::function<Thing*()> creator) {
-#if CONFIG_IOT_PROTOCOL_XIAOZHI
+#if CONFIG_IOT_PROTOCOL_XIAOZHI || CONFIG_IOT_MCP_BRIDGE
     if (thing_creators == nullptr) {
         thing_creators = new std::map<std::string, std::function<Thing*()>>();
     }
@@ -22,7 +23,10 @@ void RegisterThing(const std::string& type, std::function<Thing*()> creator) {
 }
 
 Thing* CreateThing(const std::string& type) {
-#if CONFIG_IOT_PROTOCOL_XIAOZHI
+#if CONFIG_IOT_PROTOCOL_XIAOZHI || CONFIG_IOT_MCP_BRIDGE
+    if (thing_creators == nullptr) {
+        return nullptr;
+    }
     auto creator = thing_creators->find(type);
     if (creator == thing_creators->end()) {
         ESP_LOGE(TAG, "Thing type not found: %s", type.c_str());
@@ -44,12 +48,16 @@ std::string Thing::GetDescriptorJson() {
     return json_str;
 }
 
-std::string Thing::GetStateJson() {
-    std::string json_str = "{";
-    json_str += "\"name\":\"" + name_ + "\",";
-    json_str += "\"state\":" + properties_.GetStateJson();
-    json_str += "}";
-    return json_str;
+bool Thing::GetStateJson(std::string& json, bool delta, bool compact) {
+    std::string state;
+    if (!properties_.GetStateJson(state, delta, compact)) {
+        return false;
+    }
+    json = "{";
+    json += "\"name\":\"" + name_ + "\",";
+    json += "\"state\":" + state;
+    json += "}";
+    return true;
 }
 
 void Thing::Invoke(const cJSON* command) {
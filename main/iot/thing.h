@@ -25,6 +25,13 @@ private:
     std::function<int()> number_getter_;
     std::function<std::string()> string_getter_;
 
+    // Last value pulled through the getter, compared by value instead of by serialised JSON
+    bool boolean_value_ = false;
+    int number_value_ = 0;
+    std::string string_value_;
+    bool has_value_ = false;
+    bool dirty_ = true;
+
 public:
     Property(const std::string& name, const std::string& description, std::function<bool()> getter) :
         name_(name), description_(description), type_(kValueTypeBoolean), boolean_getter_(getter) {}
@@ -36,6 +43,7 @@ public:
     const std::string& name() const { return name_; }
     const std::string& description() const { return description_; }
     ValueType type() const { return type_; }
+    bool dirty() const { return dirty_; }
 
     bool boolean() const { return boolean_getter_(); }
     int number() const { return number_getter_(); }
@@ -55,7 +63,48 @@ public:
         return json_str;
     }
 
-    std::string GetStateJson() {
+    // Pull the current value through the getter and mark the property dirty if it changed
+    bool UpdateState() {
+        bool changed = !has_value_;
+        if (type_ == kValueTypeBoolean) {
+            bool value = boolean_getter_();
+            changed = changed || value != boolean_value_;
+            boolean_value_ = value;
+        } else if (type_ == kValueTypeNumber) {
+            int value = number_getter_();
+            changed = changed || value != number_value_;
+            number_value_ = value;
+        } else if (type_ == kValueTypeString) {
+            std::string value = string_getter_();
+            if (changed || value != string_value_) {
+                changed = true;
+                string_value_ = std::move(value);
+            }
+        }
+        has_value_ = true;
+        dirty_ = dirty_ || changed;
+        return dirty_;
+    }
+
+    void ClearDirty() { dirty_ = false; }
+
+    // Serialise the value captured by the last UpdateState()
+    std::string GetStateJson(bool compact = false) {
+        if (type_ == kValueTypeBoolean) {
+            if (compact) {
+                return boolean_value_ ? "1" : "0";
+            }
+            return boolean_value_ ? "true" : "false";
+        } else if (type_ == kValueTypeNumber) {
+            return std::to_string(number_value_);
+        } else if (type_ == kValueTypeString) {
+            return "\"" + string_value_ + "\"";
+        }
+        return "null";
+    }
+
+    // Serialise the current value without touching the state tracked for reporting
+    std::string GetValueJson() const {
         if (type_ == kValueTypeBoolean) {
             return boolean_getter_() ? "true" : "false";
         } else if (type_ == kValueTypeNumber) {
@@ -106,16 +155,45 @@ public:
         return json_str;
     }
 
-    std::string GetStateJson() {
-        std::string json_str = "{";
+    // Serialise all properties, or only the dirty ones if delta is true.
+    // In compact mode the keys are the property indexes in descriptor order.
+    // Returns false if delta is true and no property changed.
+    bool GetStateJson(std::string& json, bool delta = false, bool compact = false) {
+        bool changed = false;
+        json = "{";
+        for (size_t i = 0; i < properties_.size(); ++i) {
+            auto& property = properties_[i];
+            if (property.UpdateState()) {
+                changed = true;
+            } else if (delta) {
+                continue;
+            }
+            property.ClearDirty();
+            if (compact) {
+                json += "\"" + std::to_string(i) + "\":";
+            } else {
+                json += "\"" + property.name() + "\":";
+            }
+            json += property.GetStateJson(compact) + ",";
+        }
+        if (json.back() == ',') {
+            json.pop_back();
+        }
+        json += "}";
+        return changed || !delta;
+    }
+
+    // Read-only snapshot of all properties, used by queries that are not state reports
+    std::string GetValuesJson() const {
+        std::string json = "{";
         for (auto& property : properties_) {
-            json_str += "\"" + property.name() + "\":" + property.GetStateJson() + ",";
+            json += "\"" + property.name() + "\":" + property.GetValueJson() + ",";
         }
-        if (json_str.back() == ',') {
-            json_str.pop_back();
+        if (json.back() == ',') {
+            json.pop_back();
         }
-        json_str += "}";
-        return json_str;
+        json += "}";
+        return json;
     }
 };
 
@@ -125,8 +203,8 @@ private:
     std::string description_;
     ValueType type_;
     bool required_;
-    bool boolean_;
-    int number_;
+    bool boolean_ = false;
+    int number_ = 0;
     std::string string_;
 
 public:
@@ -184,6 +262,8 @@ public:
     // iterator
     auto begin() { return parameters_.begin(); }
     auto end() { return parameters_.end(); }
+    auto begin() const { return parameters_.begin(); }
+    auto end() const { return parameters_.end(); }
 
     std::string GetDescriptorJson() {
         std::string json_str = "{";
@@ -224,6 +304,11 @@ public:
     void Invoke() {
         callback_(parameters_);
     }
+
+    // Invoke with a caller-owned parameter list, so concurrent calls do not share state
+    void Invoke(const ParameterList& parameters) {
+        callback_(parameters);
+    }
 };
 
 class MethodList {
@@ -247,6 +332,9 @@ public:
         throw std::runtime_error("Method not found: " + name);
     }
 
+    auto begin() { return methods_.begin(); }
+    auto end() { return methods_.end(); }
+
     std::string GetDescriptorJson() {
         std::string json_str = "{";
         for (auto& method : methods_) {
@@ -267,12 +355,15 @@ public:
     virtual ~Thing() = default;
 
     virtual std::string GetDescriptorJson();
-    virtual std::string GetStateJson();
+    virtual bool GetStateJson(std::string& json, bool delta = false, bool compact = false);
+    std::string GetValuesJson() const { return properties_.GetValuesJson(); }
     virtual void Invoke(const cJSON* command);
 
     const std::string& name() const { return name_; }
     const std::string& description() const { return description_; }
 
+    MethodList& methods() { return methods_; }
+
 protected:
     PropertyList properties_;
     MethodList methods_;
@@ -1,16 +1,35 @@
 #include "thing_manager.h"
+#include "application.h"
+
+#if CONFIG_IOT_MCP_BRIDGE
+#include "mcp_server.h"
+#endif
 
 #include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 #define TAG "ThingManager"
 
 namespace iot {
 
 void ThingManager::AddThing(Thing* thing) {
+    if (thing == nullptr) {
+        return;
+    }
     things_.push_back(thing);
+    things_by_name_[thing->name()] = thing;
+    // Descriptors are static once the things are added, rebuild them on next request
+    descriptors_json_.clear();
+#if CONFIG_IOT_MCP_BRIDGE
+    AddMcpTools(thing);
+#endif
 }
 
 std::string ThingManager::GetDescriptorsJson() {
+    if (!descriptors_json_.empty()) {
+        return descriptors_json_;
+    }
     std::string json_str = "[";
     for (auto& thing : things_) {
         json_str += thing->GetDescriptorJson() + ",";
@@ -19,28 +38,25 @@ std::string ThingManager::GetDescriptorsJson() {
         json_str.pop_back();
     }
     json_str += "]";
+    descriptors_json_ = json_str;
     return json_str;
 }
 
 bool ThingManager::GetStatesJson(std::string& json, bool delta) {
-    if (!delta) {
-        last_states_.clear();
-    }
+#if CONFIG_IOT_COMPACT_STATES
+    const bool compact = true;
+#else
+    const bool compact = false;
+#endif
     bool changed = false;
     json = "[";
-    // 枚举thing，获取每个thing的state，如果发生变化，则更新，保存到last_states_
-    // 如果delta为true，则只返回变化的部分
+    // 每个属性记录上次上报的值，delta 为 true 时只序列化发生变化的属性
     for (auto& thing : things_) {
-        std::string state = thing->GetStateJson();
-        if (delta) {
-            // 如果delta为true，则只返回变化的部分
-            auto it = last_states_.find(thing->name());
-            if (it != last_states_.end() && it->second == state) {
-                continue;
-            }
-            changed = true;
-            last_states_[thing->name()] = state;
+        std::string state;
+        if (!thing->GetStateJson(state, delta, compact)) {
+            continue;
         }
+        changed = true;
         json += state + ",";
     }
     if (json.back() == ',') {
@@ -52,12 +68,109 @@ bool ThingManager::GetStatesJson(std::string& json, bool delta) {
 
 void ThingManager::Invoke(const cJSON* command) {
     auto name = cJSON_GetObjectItem(command, "name");
-    for (auto& thing : things_) {
-        if (thing->name() == name->valuestring) {
-            thing->Invoke(command);
+    if (!cJSON_IsString(name)) {
+        ESP_LOGE(TAG, "Invalid thing name");
+        return;
+    }
+    auto it = things_by_name_.find(name->valuestring);
+    if (it == things_by_name_.end()) {
+        ESP_LOGW(TAG, "Thing not found: %s", name->valuestring);
+        return;
+    }
+    it->second->Invoke(command);
+}
+
+#if CONFIG_IOT_MCP_BRIDGE
+// Things are written to run in the main loop, as with the Xiaozhi IoT protocol.
+// MCP tool calls run in their own thread, so they can wait for the main loop to finish the call.
+static bool RunInMainLoop(std::function<void()> callback) {
+    auto done = xSemaphoreCreateBinary();
+    bool scheduled = Application::GetInstance().Schedule([&callback, done]() {
+        callback();
+        xSemaphoreGive(done);
+    });
+    if (scheduled) {
+        xSemaphoreTake(done, portMAX_DELAY);
+    }
+    vSemaphoreDelete(done);
+    return scheduled;
+}
+
+// Expose the thing as MCP tools: one tool per method and one tool for the current state.
+// Argument validation is done by McpServer against the generated property list.
+void ThingManager::AddMcpTools(Thing* thing) {
+    // These things are already covered by the common MCP tools (self.audio_speaker.*, self.screen.*)
+    static const char* const kMcpNativeThings[] = {"Speaker", "Screen"};
+    for (auto name : kMcpNativeThings) {
+        if (thing->name() == name) {
+            ESP_LOGI(TAG, "Skip bridging %s, it has native MCP tools", name);
             return;
         }
     }
+
+    auto& mcp_server = McpServer::GetInstance();
+    std::string prefix = "self." + thing->name() + ".";
+
+    // Read-only, the state reported to the server is tracked separately by GetStatesJson
+    mcp_server.AddTool(prefix + "get_state",
+        "Get the current state of " + thing->name() + ": " + thing->description(),
+        ::PropertyList(),
+        [thing](const ::PropertyList& properties) -> ReturnValue {
+            std::string state;
+            if (!RunInMainLoop([thing, &state]() {
+                state = thing->GetValuesJson();
+            })) {
+                throw std::runtime_error("Device is busy");
+            }
+            return state;
+        });
+
+    for (auto& method : thing->methods()) {
+        ::PropertyList mcp_properties;
+        std::string description = method.description();
+        for (const auto& parameter : method.parameters()) {
+            ::PropertyType type = kPropertyTypeString;
+            if (parameter.type() == kValueTypeBoolean) {
+                type = kPropertyTypeBoolean;
+            } else if (parameter.type() == kValueTypeNumber) {
+                type = kPropertyTypeInteger;
+            }
+            if (parameter.required()) {
+                mcp_properties.AddProperty(::Property(parameter.name(), type));
+            } else {
+                mcp_properties.AddProperty(::Property::Optional(parameter.name(), type));
+            }
+            description += "\n  `" + parameter.name() + "`: " + parameter.description();
+        }
+
+        Method* target = &method;
+        mcp_server.AddTool(prefix + method.name(), description, mcp_properties,
+            [target](const ::PropertyList& properties) -> ReturnValue {
+                // Copy the parameter list so the call does not share state with other invocations
+                ParameterList parameters = target->parameters();
+                for (auto& parameter : parameters) {
+                    auto& property = properties[parameter.name()];
+                    // Omitted optional parameters are left as they are, like Thing::Invoke does
+                    if (!property.has_value()) {
+                        continue;
+                    }
+                    if (parameter.type() == kValueTypeBoolean) {
+                        parameter.set_boolean(property.value<bool>());
+                    } else if (parameter.type() == kValueTypeNumber) {
+                        parameter.set_number(property.value<int>());
+                    } else {
+                        parameter.set_string(property.value<std::string>());
+                    }
+                }
+                if (!RunInMainLoop([target, &parameters]() {
+                    target->Invoke(parameters);
+                })) {
+                    throw std::runtime_error("Device is busy");
+                }
+                return true;
+            });
+    }
 }
+#endif
 
 } // namespace iot
@@ -33,7 +33,12 @@ private:
     ~ThingManager() = default;
 
     std::vector<Thing*> things_;
-    std::map<std::string, std::string> last_states_;
+    std::map<std::string, Thing*> things_by_name_;
+    std::string descriptors_json_;
+
+#if CONFIG_IOT_MCP_BRIDGE
+    void AddMcpTools(Thing* thing);
+#endif
 };
 
 
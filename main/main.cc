@@ -7,6 +7,8 @@
 
 #include "application.h"
 #include "system_info.h"
+#include "settings.h"
+#include "boot_profiler.h"
 
 #define TAG "main"
 
@@ -23,6 +25,8 @@ extern "C" void app_main(void)
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    Settings::LoadSnapshot();
+    BootProfiler::GetInstance().Mark("settings");
 
     // Launch the application
     Application::GetInstance().Start();
@@ -148,6 +148,32 @@ void McpServer::ParseCapabilities(const cJSON* capabilities) {
                 camera->SetExplainUrl(url_str, token_str);
             }
         }
+
+        // 识图前的预处理参数，未指定的保持默认（不缩放、不裁剪）
+        auto camera = Board::GetInstance().GetCamera();
+        if (camera) {
+            ImagePreprocessOptions options;
+            auto max_width = cJSON_GetObjectItem(vision, "max_width");
+            auto max_height = cJSON_GetObjectItem(vision, "max_height");
+            auto grayscale = cJSON_GetObjectItem(vision, "grayscale");
+            auto roi = cJSON_GetObjectItem(vision, "roi");
+            if (cJSON_IsNumber(max_width)) {
+                options.max_width = max_width->valueint;
+            }
+            if (cJSON_IsNumber(max_height)) {
+                options.max_height = max_height->valueint;
+            }
+            if (cJSON_IsBool(grayscale)) {
+                options.grayscale = cJSON_IsTrue(grayscale);
+            }
+            if (cJSON_IsArray(roi) && cJSON_GetArraySize(roi) == 4) {
+                options.roi_x = cJSON_GetArrayItem(roi, 0)->valuedouble;
+                options.roi_y = cJSON_GetArrayItem(roi, 1)->valuedouble;
+                options.roi_width = cJSON_GetArrayItem(roi, 2)->valuedouble;
+                options.roi_height = cJSON_GetArrayItem(roi, 3)->valuedouble;
+            }
+            camera->SetExplainOptions(options);
+        }
     }
 }
 
@@ -335,7 +361,7 @@ void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* to
                 }
             }
 
-            if (!argument.has_default_value() && !found) {
+            if (argument.required() && !found) {
                 ESP_LOGE(TAG, "tools/call: Missing valid argument: %s", argument.name().c_str());
                 ReplyError(id, "Missing valid argument: " + argument.name());
                 return;
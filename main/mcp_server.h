@@ -27,6 +27,9 @@ private:
     PropertyType type_;
     std::variant<bool, int, std::string> value_;
     bool has_default_value_;
+    // 可选且没有默认值的参数，调用时未提供则不设置值
+    bool optional_ = false;
+    bool has_value_ = false;
     std::optional<int> min_value_;  // 新增：整数最小值
     std::optional<int> max_value_;  // 新增：整数最大值
 
@@ -63,6 +66,15 @@ public:
     inline const std::string& name() const { return name_; }
     inline PropertyType type() const { return type_; }
     inline bool has_default_value() const { return has_default_value_; }
+    inline bool required() const { return !has_default_value_ && !optional_; }
+    // 是否有可用的值：默认值或调用时提供的值
+    inline bool has_value() const { return has_default_value_ || has_value_; }
+
+    static Property Optional(const std::string& name, PropertyType type) {
+        Property property(name, type);
+        property.optional_ = true;
+        return property;
+    }
     inline bool has_range() const { return min_value_.has_value() && max_value_.has_value(); }
     inline int min_value() const { return min_value_.value_or(0); }
     inline int max_value() const { return max_value_.value_or(0); }
@@ -84,6 +96,7 @@ public:
             }
         }
         value_ = value;
+        has_value_ = true;
     }
 
     std::string to_json() const {
@@ -147,7 +160,7 @@ public:
     std::vector<std::string> GetRequired() const {
         std::vector<std::string> required;
         for (auto& property : properties_) {
-            if (!property.has_default_value()) {
+            if (property.required()) {
                 required.push_back(property.name());
             }
         }
@@ -177,22 +190,10 @@ private:
     std::string description_;
     PropertyList properties_;
     std::function<ReturnValue(const PropertyList&)> callback_;
+    // The descriptor never changes after construction, so it is built once in the constructor
+    std::string json_;
 
-public:
-    McpTool(const std::string& name, 
-            const std::string& description, 
-            const PropertyList& properties, 
-            std::function<ReturnValue(const PropertyList&)> callback)
-        : name_(name), 
-        description_(description), 
-        properties_(properties), 
-        callback_(callback) {}
-
-    inline const std::string& name() const { return name_; }
-    inline const std::string& description() const { return description_; }
-    inline const PropertyList& properties() const { return properties_; }
-
-    std::string to_json() const {
+    std::string BuildJson() const {
         std::vector<std::string> required = properties_.GetRequired();
         
         cJSON *json = cJSON_CreateObject();
@@ -219,10 +220,29 @@ public:
         std::string result(json_str);
         cJSON_free(json_str);
         cJSON_Delete(json);
-        
         return result;
     }
 
+public:
+    McpTool(const std::string& name, 
+            const std::string& description, 
+            const PropertyList& properties, 
+            std::function<ReturnValue(const PropertyList&)> callback)
+        : name_(name), 
+        description_(description), 
+        properties_(properties), 
+        callback_(callback) {
+        json_ = BuildJson();
+    }
+
+    inline const std::string& name() const { return name_; }
+    inline const std::string& description() const { return description_; }
+    inline const PropertyList& properties() const { return properties_; }
+
+    const std::string& to_json() const {
+        return json_;
+    }
+
     std::string Call(const PropertyList& properties) {
         ReturnValue return_value = callback_(properties);
         // 返回结果
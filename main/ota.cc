@@ -10,6 +10,9 @@
 #include <esp_app_format.h>
 #include <esp_efuse.h>
 #include <esp_efuse_table.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <sys/time.h>
 #ifdef SOC_HMAC_SUPPORTED
 #include <esp_hmac.h>
 #endif
@@ -21,6 +24,25 @@
 
 #define TAG "Ota"
 
+// 每块缓冲区为整数个 flash 扇区，没有 PSRAM 时使用较小的内部内存
+#define OTA_BUFFER_SIZE             (32 * 1024)
+#define OTA_BUFFER_SIZE_INTERNAL    (4 * 1024)
+// 每写入这么多数据保存一次断点
+#define OTA_CHECKPOINT_INTERVAL     (256 * 1024)
+// 补丁无法续传，连续失败这么多次后改为下载可以续传的完整固件
+#define OTA_PATCH_MAX_FAILURES      3
+
+static std::string ToHex(const uint8_t* data, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(len * 2);
+    for (size_t i = 0; i < len; i++) {
+        result.push_back(hex[data[i] >> 4]);
+        result.push_back(hex[data[i] & 0x0F]);
+    }
+    return result;
+}
+
 
 Ota::Ota() {
 #ifdef ESP_EFUSE_BLOCK_USR_DATA
@@ -35,9 +57,11 @@ Ota::Ota() {
         }
     }
 #endif
+    mbedtls_sha256_init(&upgrade_sha256_);
 }
 
 Ota::~Ota() {
+    mbedtls_sha256_free(&upgrade_sha256_);
 }
 
 std::string Ota::GetCheckVersionUrl() {
@@ -104,6 +128,100 @@ bool Ota::CheckVersion() {
     data = http->ReadAll();
     http->Close();
 
+    if (!ParseResponse(data, false)) {
+        return false;
+    }
+    UpdateCachedResponse(data);
+    return true;
+}
+
+// 缓存保存在 ota_cache 命名空间：response 为原始响应，version 为当时运行的固件版本，
+// time 为保存时的服务器时间。系统时间在软件重启后保留，断电后时间回到 1970 年，缓存自然失效
+bool Ota::LoadCachedResponse() {
+#if CONFIG_OTA_RESPONSE_CACHE_TTL > 0
+    Settings settings("ota_cache");
+    std::string data = settings.GetString("response");
+    if (data.empty()) {
+        return false;
+    }
+
+    current_version_ = esp_app_get_description()->version;
+    if (settings.GetString("version") != current_version_) {
+        ESP_LOGI(TAG, "Cached response is for another firmware version");
+        return false;
+    }
+    time_t now = time(nullptr);
+    time_t cached_at = settings.GetInt("time");
+    if (now < cached_at || now - cached_at > CONFIG_OTA_RESPONSE_CACHE_TTL * 3600) {
+        ESP_LOGI(TAG, "Cached response expired");
+        return false;
+    }
+
+    if (!ParseResponse(data, true)) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Using cached response from %lld seconds ago", (long long)(now - cached_at));
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Ota::UpdateCachedResponse(const std::string& data) {
+#if CONFIG_OTA_RESPONSE_CACHE_TTL > 0
+    Settings settings("ota_cache", true);
+    // 需要升级或激活时下次启动必须先完成检查；没有服务器时间则无法判断缓存是否过期
+    // NVS 字符串最长 4000 字节（含结尾的 0）
+    if (has_new_version_ || has_activation_code_ || has_activation_challenge_ || !has_server_time_ ||
+        data.size() >= 4000) {
+        if (!settings.GetString("response").empty()) {
+            settings.EraseAll();
+        }
+        return;
+    }
+
+    config_changed_ = false;
+    bool unchanged = false;
+    std::string previous = settings.GetString("response");
+    if (!previous.empty()) {
+        cJSON* old_root = cJSON_Parse(previous.c_str());
+        cJSON* new_root = cJSON_Parse(data.c_str());
+        for (auto section : {"mqtt", "websocket"}) {
+            cJSON* old_item = cJSON_GetObjectItem(old_root, section);
+            cJSON* new_item = cJSON_GetObjectItem(new_root, section);
+            if (old_item == nullptr && new_item == nullptr) {
+                continue;
+            }
+            if (!cJSON_Compare(old_item, new_item, true)) {
+                ESP_LOGI(TAG, "Server %s config changed", section);
+                config_changed_ = true;
+            }
+        }
+        // 服务器时间每次都不同，比较其余内容
+        if (old_root != nullptr && new_root != nullptr) {
+            cJSON_DeleteItemFromObject(old_root, "server_time");
+            cJSON_DeleteItemFromObject(new_root, "server_time");
+            unchanged = cJSON_Compare(old_root, new_root, true);
+        }
+        cJSON_Delete(old_root);
+        cJSON_Delete(new_root);
+    }
+
+    // 内容没变且缓存还没过半个有效期时不重写，避免每次启动都写 NVS
+    time_t now = time(nullptr);
+    time_t cached_at = settings.GetInt("time");
+    if (unchanged && settings.GetString("version") == current_version_ &&
+        now >= cached_at && now - cached_at < CONFIG_OTA_RESPONSE_CACHE_TTL * 3600 / 2) {
+        return;
+    }
+
+    settings.SetString("response", data);
+    settings.SetString("version", current_version_);
+    settings.SetInt("time", now);
+#endif
+}
+
+bool Ota::ParseResponse(const std::string& data, bool from_cache) {
     // Response: { "firmware": { "version": "1.0.0", "url": "http://" } }
     // Parse the JSON response and check if the version is newer
     // If it is, set has_new_version_ to true and store the new version and URL
@@ -186,7 +304,10 @@ bool Ota::CheckVersion() {
         cJSON *timestamp = cJSON_GetObjectItem(server_time, "timestamp");
         cJSON *timezone_offset = cJSON_GetObjectItem(server_time, "timezone_offset");
         
-        if (cJSON_IsNumber(timestamp)) {
+        if (from_cache) {
+            // 缓存未过期说明系统时间在重启后仍然有效
+            has_server_time_ = true;
+        } else if (cJSON_IsNumber(timestamp)) {
             // 设置系统时间
             struct timeval tv;
             double ts = timestamp->valuedouble;
@@ -206,6 +327,7 @@ bool Ota::CheckVersion() {
     }
 
     has_new_version_ = false;
+    patch_url_.clear();
     cJSON *firmware = cJSON_GetObjectItem(root, "firmware");
     if (cJSON_IsObject(firmware)) {
         cJSON *version = cJSON_GetObjectItem(firmware, "version");
@@ -231,6 +353,17 @@ bool Ota::CheckVersion() {
                 has_new_version_ = true;
             }
         }
+
+        // 可选的差分补丁: "patch": { "from": "1.0.0", "url": "http://" }，只适用于 from 版本
+        cJSON *patch = cJSON_GetObjectItem(firmware, "patch");
+        if (cJSON_IsObject(patch)) {
+            cJSON *from = cJSON_GetObjectItem(patch, "from");
+            cJSON *patch_url = cJSON_GetObjectItem(patch, "url");
+            if (cJSON_IsString(from) && cJSON_IsString(patch_url) && current_version_ == from->valuestring) {
+                patch_url_ = patch_url->valuestring;
+                ESP_LOGI(TAG, "Delta patch available: %s", patch_url_.c_str());
+            }
+        }
     } else {
         ESP_LOGW(TAG, "No firmware section found!");
     }
@@ -259,119 +392,467 @@ void Ota::MarkCurrentVersionValid() {
     }
 }
 
-void Ota::Upgrade(const std::string& firmware_url) {
-    ESP_LOGI(TAG, "Upgrading firmware from %s", firmware_url.c_str());
-    esp_ota_handle_t update_handle = 0;
-    auto update_partition = esp_ota_get_next_update_partition(NULL);
-    if (update_partition == NULL) {
-        ESP_LOGE(TAG, "Failed to get update partition");
-        return;
+// 断点保存在 NVS 的 ota 命名空间：url/partition/length/etag 标识下载的文件，
+// offset 为已写入 flash 的字节数，sha256 为这部分数据的摘要
+size_t Ota::LoadCheckpoint(const std::string& url, const esp_partition_t* partition, size_t& total_length, std::string& etag) {
+    Settings settings("ota");
+    if (settings.GetString("url") != url || settings.GetString("partition") != partition->label) {
+        return 0;
+    }
+    size_t offset = settings.GetInt("offset");
+    total_length = settings.GetInt("length");
+    etag = settings.GetString("etag");
+    std::string expected = settings.GetString("sha256");
+    if (offset == 0 || offset >= total_length || expected.empty()) {
+        return 0;
+    }
+
+    // 断点之后的数据可能已部分写入，esp_ota_resume 只在扇区起点擦除，因此从断点所在扇区的起点续传
+    size_t resume_offset = offset & ~(size_t)(SPI_FLASH_SEC_SIZE - 1);
+
+    // 重新计算 flash 中已写入部分的摘要，确认数据完好，同时恢复到续传位置的摘要计算状态
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&upgrade_sha256_, 0);
+    bool ok = true;
+    for (size_t pos = 0; pos < offset; ) {
+        if (pos == resume_offset) {
+            mbedtls_sha256_clone(&ctx, &upgrade_sha256_);
+        }
+        size_t end = pos < resume_offset ? resume_offset : offset;
+        size_t len = std::min(writer_->buffer_size(), end - pos);
+        if (esp_partition_read(partition, pos, writer_->scratch(), len) != ESP_OK) {
+            ok = false;
+            break;
+        }
+        mbedtls_sha256_update(pos < resume_offset ? &upgrade_sha256_ : &ctx, writer_->scratch(), len);
+        pos += len;
+    }
+    if (resume_offset == offset) {
+        mbedtls_sha256_clone(&ctx, &upgrade_sha256_);
     }
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    if (!ok || ToHex(digest, sizeof(digest)) != expected) {
+        ESP_LOGW(TAG, "Checkpoint digest mismatch, restarting download");
+        return 0;
+    }
+    return resume_offset;
+}
 
-    ESP_LOGI(TAG, "Writing to partition %s at offset 0x%lx", update_partition->label, update_partition->address);
-    bool image_header_checked = false;
-    std::string image_header;
+bool Ota::HasCheckpoint(const std::string& url) {
+    Settings settings("ota");
+    auto partition = esp_ota_get_next_update_partition(NULL);
+    return partition != nullptr && settings.GetString("url") == url &&
+        settings.GetString("partition") == partition->label && settings.GetInt("offset") >= SPI_FLASH_SEC_SIZE;
+}
 
-    auto http = std::unique_ptr<Http>(Board::GetInstance().CreateHttp());
-    if (!http->Open("GET", firmware_url)) {
-        ESP_LOGE(TAG, "Failed to open HTTP connection");
-        return;
+void Ota::SaveCheckpoint() {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_clone(&ctx, &upgrade_sha256_);
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+
+    Settings settings("ota", true);
+    settings.SetInt("offset", written_size_);
+    settings.SetString("sha256", ToHex(digest, sizeof(digest)));
+    checkpoint_size_ = written_size_;
+}
+
+void Ota::ClearCheckpoint() {
+    Settings settings("ota", true);
+    settings.EraseAll();
+}
+
+// 在写入任务中调用，每次为一块下载缓冲区的数据
+bool Ota::WriteBuffer(const uint8_t* data, size_t len) {
+    if (!stream_checked_) {
+        // 原始镜像以 0xE9 开始，压缩的镜像以 zlib 头开始
+        stream_checked_ = true;
+        if (data[0] == INFLATE_STREAM_ZLIB_CMF) {
+            ESP_LOGI(TAG, "Firmware is compressed, decompressing while writing");
+            inflater_ = std::make_unique<InflateStream>([this](const uint8_t* data, size_t len) {
+                return WriteDecoded(data, len);
+            });
+            if (!inflater_->Initialize()) {
+                write_error_ = ESP_ERR_NO_MEM;
+                return false;
+            }
+        }
+    }
+    if (inflater_ != nullptr) {
+        if (!inflater_->Feed(data, len) && write_error_ == ESP_OK) {
+            write_error_ = ESP_FAIL;
+        }
+    } else if (WriteDecoded(data, len) && patch_ == nullptr) {
+        if (written_size_ - checkpoint_size_ >= OTA_CHECKPOINT_INTERVAL) {
+            SaveCheckpoint();
+        }
     }
+    return write_error_ == ESP_OK;
+}
 
-    if (http->GetStatusCode() != 200) {
-        ESP_LOGE(TAG, "Failed to get firmware, status code: %d", http->GetStatusCode());
-        return;
+// 解压后的数据交给补丁解码，没有补丁时直接写入镜像
+bool Ota::WriteDecoded(const uint8_t* data, size_t len) {
+    if (patch_ != nullptr) {
+        if (!patch_->Feed(data, len)) {
+            if (write_error_ == ESP_OK) {
+                write_error_ = ESP_FAIL;
+            }
+            return false;
+        }
+        return true;
     }
+    return WriteImage(data, len);
+}
 
-    size_t content_length = http->GetBodyLength();
-    if (content_length == 0) {
-        ESP_LOGE(TAG, "Failed to get content length");
-        return;
+// 在写入任务中调用，写入前先从镜像头部检查新固件的版本
+bool Ota::WriteImage(const uint8_t* data, size_t len) {
+    if (!image_header_checked_) {
+        const size_t header_size = sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t);
+        if (len < header_size) {
+            ESP_LOGE(TAG, "Firmware is too short");
+            write_error_ = ESP_ERR_INVALID_SIZE;
+            return false;
+        }
+        esp_app_desc_t new_app_info;
+        memcpy(&new_app_info, data + sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t), sizeof(esp_app_desc_t));
+        ESP_LOGI(TAG, "New firmware version: %s", new_app_info.version);
+
+        auto current_version = esp_app_get_description()->version;
+        if (memcmp(new_app_info.version, current_version, sizeof(new_app_info.version)) == 0) {
+            ESP_LOGE(TAG, "Firmware version is the same, skipping upgrade");
+            write_error_ = ESP_ERR_INVALID_VERSION;
+            return false;
+        }
+        image_header_checked_ = true;
     }
 
-    char buffer[512];
-    size_t total_read = 0, recent_read = 0;
+    auto err = esp_ota_write(update_handle_, data, len);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write OTA data: %s", esp_err_to_name(err));
+        write_error_ = err;
+        return false;
+    }
+    mbedtls_sha256_update(&upgrade_sha256_, data, len);
+    written_size_ += len;
+    return true;
+}
+
+// 补丁只适用于生成时的旧固件，应用前确认运行中的固件与之完全一致
+bool Ota::VerifyRunningImage(const esp_partition_t* partition, const DeltaPatchHeader& header) {
+    if (header.old_size > partition->size) {
+        ESP_LOGE(TAG, "Patch base is larger than the running partition");
+        return false;
+    }
+    std::vector<uint8_t> buffer(DELTA_PATCH_BUFFER_SIZE);
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    bool ok = true;
+    for (size_t pos = 0; pos < header.old_size; pos += buffer.size()) {
+        size_t len = std::min(buffer.size(), (size_t)header.old_size - pos);
+        if (esp_partition_read(partition, pos, buffer.data(), len) != ESP_OK) {
+            ok = false;
+            break;
+        }
+        mbedtls_sha256_update(&ctx, buffer.data(), len);
+    }
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    if (!ok || memcmp(digest, header.old_sha256, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "Patch does not match the running firmware");
+        return false;
+    }
+    return true;
+}
+
+// 补丁应用完成后，确认输出的新固件与补丁记录的大小和摘要一致
+bool Ota::VerifyPatchedImage() {
+    if (!patch_->IsFinished() || written_size_ != patch_->header().new_size) {
+        ESP_LOGE(TAG, "Patch is incomplete, %u/%lu bytes written", written_size_, patch_->header().new_size);
+        return false;
+    }
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&upgrade_sha256_, digest);
+    if (memcmp(digest, patch_->header().new_sha256, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "Patched firmware digest mismatch");
+        return false;
+    }
+    return true;
+}
+
+// 返回 ESP_ERR_INVALID_RESPONSE 表示网络读取失败或连接提前断开，其他错误来自下载的内容或 flash 写入
+esp_err_t Ota::Download(Http* http, const esp_partition_t* update_partition, size_t resume_offset, size_t total_length) {
+    esp_err_t result = ESP_ERR_INVALID_RESPONSE;
+    uint8_t* buffer = nullptr;
+    size_t filled = 0;
+    size_t total_read = resume_offset, recent_read = 0;
     auto last_calc_time = esp_timer_get_time();
+
+    // 续传时镜像头部在上次已经检查过，直接从断点继续写入；新的下载由写入任务检查头部
+    esp_err_t err;
+    if (resume_offset > 0) {
+        err = esp_ota_resume(update_partition, OTA_WITH_SEQUENTIAL_WRITES, resume_offset, &update_handle_);
+    } else {
+        err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &update_handle_);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to begin OTA: %s", esp_err_to_name(err));
+        if (resume_offset > 0) {
+            ClearCheckpoint();
+        }
+        return err;
+    }
+    // 压缩的镜像和补丁不保存断点，续传的一定是原始镜像
+    image_header_checked_ = resume_offset > 0;
+    stream_checked_ = resume_offset > 0;
+
+    if (!writer_->Start()) {
+        esp_ota_abort(update_handle_);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t buffer_size = writer_->buffer_size();
     while (true) {
-        int ret = http->Read(buffer, sizeof(buffer));
+        if (buffer == nullptr) {
+            buffer = writer_->Acquire();
+            filled = 0;
+            if (buffer == nullptr) {
+                break;
+            }
+        }
+
+        int ret = http->Read((char*)buffer + filled, buffer_size - filled);
         if (ret < 0) {
             ESP_LOGE(TAG, "Failed to read HTTP data: %s", esp_err_to_name(ret));
-            return;
+            break;
         }
 
         // Calculate speed and progress every second
         recent_read += ret;
         total_read += ret;
         if (esp_timer_get_time() - last_calc_time >= 1000000 || ret == 0) {
-            size_t progress = total_read * 100 / content_length;
-            ESP_LOGI(TAG, "Progress: %u%% (%u/%u), Speed: %uB/s", progress, total_read, content_length, recent_read);
+            size_t progress = total_read * 100 / total_length;
+            ESP_LOGI(TAG, "Progress: %u%% (%u/%u), Speed: %uB/s", progress, total_read, total_length, recent_read);
             if (upgrade_callback_) {
                 upgrade_callback_(progress, recent_read);
             }
             last_calc_time = esp_timer_get_time();
             recent_read = 0;
         }
+        filled += ret;
 
-        if (ret == 0) {
-            break;
+        if (ret == 0 || filled == buffer_size) {
+            if (filled > 0) {
+                writer_->Submit(filled);
+                buffer = nullptr;
+            }
+            if (ret == 0) {
+                // 连接提前断开时已收到的数据照常写入，下次从断点继续
+                if (total_read == total_length) {
+                    result = ESP_OK;
+                } else {
+                    ESP_LOGE(TAG, "Connection closed at %u/%u", total_read, total_length);
+                }
+                break;
+            }
+        }
+    }
+
+    // 等待已交出的缓冲区写完
+    writer_->Finish();
+    if (write_error_ != ESP_OK) {
+        result = write_error_;
+    }
+    if (result == ESP_OK && inflater_ != nullptr) {
+        if (inflater_->IsFinished()) {
+            ESP_LOGI(TAG, "Decompressed %u bytes to %u bytes", total_length, inflater_->output_size());
+        } else {
+            ESP_LOGE(TAG, "Compressed firmware is incomplete");
+            result = ESP_ERR_INVALID_SIZE;
         }
+    }
+    if (result == ESP_OK && patch_ != nullptr && !VerifyPatchedImage()) {
+        result = ESP_ERR_INVALID_CRC;
+    }
+    // 补丁不保存断点，也不改动完整固件的断点
+    if (result != ESP_OK && patch_ == nullptr) {
+        if (write_error_ == ESP_ERR_INVALID_VERSION) {
+            ClearCheckpoint();
+        } else if (inflater_ == nullptr && write_error_ == ESP_OK && written_size_ > checkpoint_size_) {
+            // 已写入的数据保留在分区中，记下最新的断点，下次从这里继续
+            SaveCheckpoint();
+        }
+    }
+    if (result != ESP_OK) {
+        esp_ota_abort(update_handle_);
+    }
+    return result;
+}
+
+// 升级成功时直接重启，否则返回失败原因：ESP_ERR_INVALID_RESPONSE 为网络错误，ESP_ERR_NOT_FOUND 为文件不存在
+esp_err_t Ota::Upgrade(const std::string& firmware_url, bool is_patch) {
+    ESP_LOGI(TAG, "Upgrading firmware from %s%s", firmware_url.c_str(), is_patch ? " (delta patch)" : "");
+    auto update_partition = esp_ota_get_next_update_partition(NULL);
+    if (update_partition == NULL) {
+        ESP_LOGE(TAG, "Failed to get update partition");
+        return ESP_ERR_NOT_FOUND;
+    }
 
-        if (!image_header_checked) {
-            image_header.append(buffer, ret);
-            if (image_header.size() >= sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t)) {
-                esp_app_desc_t new_app_info;
-                memcpy(&new_app_info, image_header.data() + sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t), sizeof(esp_app_desc_t));
-                ESP_LOGI(TAG, "New firmware version: %s", new_app_info.version);
+    ESP_LOGI(TAG, "Writing to partition %s at offset 0x%lx", update_partition->label, update_partition->address);
 
-                auto current_version = esp_app_get_description()->version;
-                if (memcmp(new_app_info.version, current_version, sizeof(new_app_info.version)) == 0) {
-                    ESP_LOGE(TAG, "Firmware version is the same, skipping upgrade");
-                    return;
-                }
+    writer_ = std::make_unique<OtaWriter>([this](const uint8_t* data, size_t len) {
+        return WriteBuffer(data, len);
+    });
+    if (!writer_->Initialize(OTA_BUFFER_SIZE, OTA_BUFFER_SIZE_INTERNAL)) {
+        ESP_LOGE(TAG, "Failed to allocate upgrade buffers");
+        writer_.reset();
+        return ESP_ERR_NO_MEM;
+    }
+    write_error_ = ESP_OK;
 
-                if (esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &update_handle)) {
-                    esp_ota_abort(update_handle);
-                    ESP_LOGE(TAG, "Failed to begin OTA");
-                    return;
-                }
+    size_t total_length = 0;
+    std::string etag;
+    // 补丁输出依赖解码状态，不支持断点续传
+    size_t resume_offset = is_patch ? 0 : LoadCheckpoint(firmware_url, update_partition, total_length, etag);
 
-                image_header_checked = true;
-                std::string().swap(image_header);
-            }
+    auto http = std::unique_ptr<Http>(Board::GetInstance().CreateHttp());
+    if (resume_offset > 0) {
+        ESP_LOGI(TAG, "Resuming upgrade from %u/%u", resume_offset, total_length);
+        http->SetHeader("Range", "bytes=" + std::to_string(resume_offset) + "-");
+        if (!etag.empty()) {
+            http->SetHeader("If-Range", etag);
+        }
+    }
+    if (!http->Open("GET", firmware_url)) {
+        ESP_LOGE(TAG, "Failed to open HTTP connection");
+        writer_.reset();
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    auto status_code = http->GetStatusCode();
+    if (status_code == 206 && resume_offset > 0) {
+        // 确认服务端返回的正是请求的区间，且文件没有变化
+        auto content_range = http->GetResponseHeader("Content-Range");
+        unsigned int start = 0, total = 0;
+        if (sscanf(content_range.c_str(), "bytes %u-%*u/%u", &start, &total) != 2 ||
+            start != resume_offset || total != total_length) {
+            ESP_LOGE(TAG, "Unexpected content range: %s", content_range.c_str());
+            ClearCheckpoint();
+            writer_.reset();
+            return ESP_ERR_INVALID_RESPONSE;
         }
-        auto err = esp_ota_write(update_handle, buffer, ret);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to write OTA data: %s", esp_err_to_name(err));
-            esp_ota_abort(update_handle);
-            return;
+    } else if (status_code == 200) {
+        if (resume_offset > 0) {
+            ESP_LOGW(TAG, "Server returned the full firmware, restarting download");
+            resume_offset = 0;
         }
+        total_length = http->GetBodyLength();
+        if (total_length == 0) {
+            ESP_LOGE(TAG, "Failed to get content length");
+            writer_.reset();
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+
+        // 新的下载，先记录文件信息，写入进度在下载过程中保存；补丁不保存断点，保留完整固件的断点
+        if (!is_patch) {
+            ClearCheckpoint();
+            Settings settings("ota", true);
+            settings.SetString("url", firmware_url);
+            settings.SetString("partition", update_partition->label);
+            settings.SetInt("length", total_length);
+            settings.SetString("etag", http->GetResponseHeader("ETag"));
+        }
+        mbedtls_sha256_starts(&upgrade_sha256_, 0);
+    } else {
+        ESP_LOGE(TAG, "Failed to get firmware, status code: %d", status_code);
+        writer_.reset();
+        return status_code == 404 ? ESP_ERR_NOT_FOUND : ESP_ERR_INVALID_RESPONSE;
+    }
+
+    written_size_ = resume_offset;
+    checkpoint_size_ = resume_offset;
+    if (is_patch) {
+        // 以运行中的分区为旧固件，补丁输出经 WriteImage 写入更新分区，补丁本身也可以是压缩的
+        auto running_partition = esp_ota_get_running_partition();
+        patch_ = std::make_unique<DeltaPatch>(
+            [this, running_partition](const DeltaPatchHeader& header) {
+                return VerifyRunningImage(running_partition, header);
+            },
+            [running_partition](size_t offset, uint8_t* data, size_t len) {
+                return esp_partition_read(running_partition, offset, data, len) == ESP_OK;
+            },
+            [this](const uint8_t* data, size_t len) {
+                return WriteImage(data, len);
+            });
+    }
+    esp_err_t err = Download(http.get(), update_partition, resume_offset, total_length);
+    patch_.reset();
+    inflater_.reset();
+    writer_.reset();
+    if (err != ESP_OK) {
+        return err;
     }
     http->Close();
 
-    esp_err_t err = esp_ota_end(update_handle);
+    err = esp_ota_end(update_handle_);
+    if (!is_patch) {
+        ClearCheckpoint();
+    }
     if (err != ESP_OK) {
         if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
             ESP_LOGE(TAG, "Image validation failed, image is corrupted");
         } else {
             ESP_LOGE(TAG, "Failed to end OTA: %s", esp_err_to_name(err));
         }
-        return;
+        return err;
     }
 
     err = esp_ota_set_boot_partition(update_partition);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set boot partition: %s", esp_err_to_name(err));
-        return;
+        return err;
     }
 
     ESP_LOGI(TAG, "Firmware upgrade successful, rebooting in 3 seconds...");
     vTaskDelay(pdMS_TO_TICKS(3000));
     esp_restart();
+    return ESP_OK;
 }
 
 void Ota::StartUpgrade(std::function<void(int progress, size_t speed)> callback) {
     upgrade_callback_ = callback;
-    Upgrade(firmware_url_);
+    // 优先使用差分补丁；已有完整固件的断点时直接续传，补丁会覆盖更新分区中已下载的数据
+    if (!patch_url_.empty() && !HasCheckpoint(firmware_url_)) {
+        // 失败次数按补丁地址记录，换了新补丁重新计数
+        Settings settings("ota_patch", true);
+        if (settings.GetString("url") != patch_url_) {
+            settings.SetString("url", patch_url_);
+            settings.SetInt("failures", 0);
+        }
+        int failures = settings.GetInt("failures");
+        if (failures < OTA_PATCH_MAX_FAILURES) {
+            esp_err_t err = Upgrade(patch_url_, true);
+            // 补丁本身不可用时立即回退；网络中断或内存不足时先重试补丁，多次失败后再回退
+            if (err == ESP_ERR_INVALID_RESPONSE || err == ESP_ERR_NO_MEM) {
+                failures++;
+            } else {
+                failures = OTA_PATCH_MAX_FAILURES;
+            }
+            settings.SetInt("failures", failures);
+            if (failures < OTA_PATCH_MAX_FAILURES) {
+                ESP_LOGW(TAG, "Delta upgrade failed (%s), attempt %d/%d", esp_err_to_name(err), failures, OTA_PATCH_MAX_FAILURES);
+                return;
+            }
+        }
+        ESP_LOGW(TAG, "Delta upgrade failed %d times, downloading the full firmware", failures);
+    }
+    Upgrade(firmware_url_, false);
 }
 
 std::vector<int> Ota::ParseVersion(const std::string& version) {
@@ -3,9 +3,16 @@
 
 #include <functional>
 #include <string>
+#include <atomic>
+#include <memory>
 
 #include <esp_err.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
 #include "board.h"
+#include "delta_patch.h"
+#include "inflate_stream.h"
+#include "ota_writer.h"
 
 class Ota {
 public:
@@ -13,6 +20,8 @@ public:
     ~Ota();
 
     bool CheckVersion();
+    // 读取有效期内缓存的上次检查结果，成功时无需等待网络即可初始化协议
+    bool LoadCachedResponse();
     esp_err_t Activate();
     bool HasActivationChallenge() { return has_activation_challenge_; }
     bool HasNewVersion() { return has_new_version_; }
@@ -20,6 +29,8 @@ public:
     bool HasWebsocketConfig() { return has_websocket_config_; }
     bool HasActivationCode() { return has_activation_code_; }
     bool HasServerTime() { return has_server_time_; }
+    // 服务器下发的 mqtt/websocket 配置与缓存中的不同
+    bool IsConfigChanged() { return config_changed_; }
     void StartUpgrade(std::function<void(int progress, size_t speed)> callback);
     void MarkCurrentVersionValid();
 
@@ -39,15 +50,45 @@ private:
     bool has_activation_code_ = false;
     bool has_serial_number_ = false;
     bool has_activation_challenge_ = false;
+    bool config_changed_ = false;
     std::string current_version_;
     std::string firmware_version_;
     std::string firmware_url_;
+    // 服务端提供的从当前版本升级的差分补丁
+    std::string patch_url_;
     std::string activation_challenge_;
     std::string serial_number_;
     int activation_timeout_ms_ = 30000;
 
-    void Upgrade(const std::string& firmware_url);
+    // 下载的数据经写入任务写入 flash，写入失败的原因记录在 write_error_
+    std::unique_ptr<OtaWriter> writer_;
+    esp_ota_handle_t update_handle_ = 0;
+    std::atomic<esp_err_t> write_error_ = ESP_OK;
+    // 断点续传：已写入 flash 的字节数和这部分数据的摘要，定期保存到 NVS
+    mbedtls_sha256_context upgrade_sha256_;
+    size_t written_size_ = 0;
+    size_t checkpoint_size_ = 0;
+    bool image_header_checked_ = false;
+    // 下载差分补丁时，写入任务将数据交给补丁解码，输出的新固件再写入 flash
+    std::unique_ptr<DeltaPatch> patch_;
+    // 下载的数据以 zlib 头开始时先解压，再交给补丁解码或直接写入
+    std::unique_ptr<InflateStream> inflater_;
+    bool stream_checked_ = false;
+
+    esp_err_t Upgrade(const std::string& firmware_url, bool is_patch);
+    esp_err_t Download(Http* http, const esp_partition_t* update_partition, size_t resume_offset, size_t total_length);
+    bool WriteBuffer(const uint8_t* data, size_t len);
+    bool WriteDecoded(const uint8_t* data, size_t len);
+    bool WriteImage(const uint8_t* data, size_t len);
+    bool VerifyRunningImage(const esp_partition_t* partition, const DeltaPatchHeader& header);
+    bool VerifyPatchedImage();
+    size_t LoadCheckpoint(const std::string& url, const esp_partition_t* partition, size_t& total_length, std::string& etag);
+    bool HasCheckpoint(const std::string& url);
+    void SaveCheckpoint();
+    void ClearCheckpoint();
     std::function<void(int progress, size_t speed)> upgrade_callback_;
+    bool ParseResponse(const std::string& data, bool from_cache);
+    void UpdateCachedResponse(const std::string& data);
     std::vector<int> ParseVersion(const std::string& version);
     bool IsNewVersionAvailable(const std::string& currentVersion, const std::string& newVersion);
     std::string GetActivationPayload();
@@ -0,0 +1,112 @@
+#include "ota_writer.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <freertos/task.h>
+
+#define TAG "OtaWriter"
+
+OtaWriter::OtaWriter(std::function<bool(const uint8_t* data, size_t len)> write) : write_(write) {
+}
+
+OtaWriter::~OtaWriter() {
+    if (started_) {
+        Finish();
+    }
+    FreeBuffers();
+    if (free_buffers_ != nullptr) {
+        vQueueDelete(free_buffers_);
+    }
+    if (filled_buffers_ != nullptr) {
+        vQueueDelete(filled_buffers_);
+    }
+    if (done_ != nullptr) {
+        vSemaphoreDelete(done_);
+    }
+}
+
+bool OtaWriter::AllocateBuffers(size_t size, uint32_t caps) {
+    buffer_size_ = size;
+    for (int i = 0; i < OTA_BUFFER_COUNT; i++) {
+        buffers_[i] = (uint8_t*)heap_caps_malloc(size, caps);
+        if (buffers_[i] == nullptr) {
+            FreeBuffers();
+            return false;
+        }
+    }
+    return true;
+}
+
+void OtaWriter::FreeBuffers() {
+    for (int i = 0; i < OTA_BUFFER_COUNT; i++) {
+        heap_caps_free(buffers_[i]);
+        buffers_[i] = nullptr;
+    }
+}
+
+bool OtaWriter::Initialize(size_t buffer_size, size_t internal_buffer_size) {
+    if (!AllocateBuffers(buffer_size, MALLOC_CAP_SPIRAM) &&
+        !AllocateBuffers(internal_buffer_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)) {
+        return false;
+    }
+
+    free_buffers_ = xQueueCreate(OTA_BUFFER_COUNT, sizeof(int));
+    filled_buffers_ = xQueueCreate(OTA_BUFFER_COUNT + 1, sizeof(int));
+    done_ = xSemaphoreCreateBinary();
+    if (free_buffers_ == nullptr || filled_buffers_ == nullptr || done_ == nullptr) {
+        return false;
+    }
+    for (int i = 0; i < OTA_BUFFER_COUNT; i++) {
+        xQueueSend(free_buffers_, &i, 0);
+    }
+    ESP_LOGI(TAG, "Upgrade buffers: %d x %u bytes", OTA_BUFFER_COUNT, (unsigned)buffer_size_);
+    return true;
+}
+
+bool OtaWriter::Start() {
+    if (xTaskCreate([](void* arg) {
+        static_cast<OtaWriter*>(arg)->WriterTask();
+    }, "ota_writer", 4096, this, uxTaskPriorityGet(NULL), nullptr) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create OTA writer task");
+        return false;
+    }
+    started_ = true;
+    return true;
+}
+
+uint8_t* OtaWriter::Acquire() {
+    xQueueReceive(free_buffers_, &current_, portMAX_DELAY);
+    if (failed_) {
+        return nullptr;
+    }
+    return buffers_[current_];
+}
+
+void OtaWriter::Submit(size_t len) {
+    lengths_[current_] = len;
+    xQueueSend(filled_buffers_, &current_, portMAX_DELAY);
+    current_ = -1;
+}
+
+bool OtaWriter::Finish() {
+    if (started_) {
+        int end = -1;
+        xQueueSend(filled_buffers_, &end, portMAX_DELAY);
+        xSemaphoreTake(done_, portMAX_DELAY);
+        started_ = false;
+    }
+    return !failed_;
+}
+
+void OtaWriter::WriterTask() {
+    int index;
+    while (xQueueReceive(filled_buffers_, &index, portMAX_DELAY) == pdTRUE && index >= 0) {
+        // 出错后继续归还缓冲区，让读取方尽快发现并退出
+        if (!failed_ && !write_(buffers_[index], lengths_[index])) {
+            failed_ = true;
+        }
+        xQueueSend(free_buffers_, &index, portMAX_DELAY);
+    }
+    xSemaphoreGive(done_);
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,56 @@
+#ifndef _OTA_WRITER_H
+#define _OTA_WRITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+// 下载缓冲区数量，网络读取与 flash 写入交替使用
+#define OTA_BUFFER_COUNT    2
+
+// 下载与写入重叠进行：读取方填满一块缓冲区后交给写入任务，写完归还。
+// 队列中传递缓冲区序号，-1 表示下载结束
+class OtaWriter {
+public:
+    // write 在写入任务中依次调用，返回 false 后不再写入，读取方在下一次 Acquire 时得知
+    OtaWriter(std::function<bool(const uint8_t* data, size_t len)> write);
+    ~OtaWriter();
+
+    // 优先在 PSRAM 中分配 buffer_size 的缓冲区，失败时改用内部内存中较小的缓冲区
+    bool Initialize(size_t buffer_size, size_t internal_buffer_size);
+    // 创建写入任务，优先级与调用方相同
+    bool Start();
+    // 取一块空闲缓冲区，写入失败后返回 nullptr
+    uint8_t* Acquire();
+    // 交出上一次 Acquire 得到的缓冲区中的前 len 字节
+    void Submit(size_t len);
+    // 通知写入任务结束，等待已交出的数据写完，返回是否全部写入成功
+    bool Finish();
+
+    size_t buffer_size() const { return buffer_size_; }
+    // 写入任务启动前可以作为临时缓冲区使用
+    uint8_t* scratch() const { return buffers_[0]; }
+
+private:
+    std::function<bool(const uint8_t* data, size_t len)> write_;
+    uint8_t* buffers_[OTA_BUFFER_COUNT] = {};
+    size_t lengths_[OTA_BUFFER_COUNT] = {};
+    size_t buffer_size_ = 0;
+    int current_ = -1;
+    QueueHandle_t free_buffers_ = nullptr;
+    QueueHandle_t filled_buffers_ = nullptr;
+    SemaphoreHandle_t done_ = nullptr;
+    bool started_ = false;
+    std::atomic<bool> failed_ = false;
+
+    bool AllocateBuffers(size_t size, uint32_t caps);
+    void FreeBuffers();
+    void WriterTask();
+};
+
+#endif // _OTA_WRITER_H
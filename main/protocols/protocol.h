@@ -11,6 +11,8 @@ struct AudioStreamPacket {
     int sample_rate = 0;
     int frame_duration = 0;
     uint32_t timestamp = 0;
+    // Assigned by the application on receive, packets of an aborted turn are dropped by session
+    uint32_t session_id = 0;
     std::vector<uint8_t> payload;
 };
 
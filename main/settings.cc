@@ -1,67 +1,705 @@
 #include "settings.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <esp_rom_crc.h>
 #include <nvs_flash.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_app_desc.h>
+#include <esp_partition.h>
+#include <esp_flash_partitions.h>
+#include <spi_flash_mmap.h>
+
+#include <cstring>
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <optional>
+#include <vector>
 
 #define TAG "Settings"
 
-Settings::Settings(const std::string& ns, bool read_write) : ns_(ns), read_write_(read_write) {
-    nvs_open(ns.c_str(), read_write_ ? NVS_READWRITE : NVS_READONLY, &nvs_handle_);
+// 最后一次修改后等待这么久再写入 NVS，连续修改时最多推迟 SETTINGS_FLUSH_MAX_DELAY_MS
+#define SETTINGS_FLUSH_DELAY_MS         1000
+#define SETTINGS_FLUSH_MAX_DELAY_MS     5000
+
+#ifdef CONFIG_SETTINGS_SNAPSHOT
+/*
+ * 启动快照保存在 settings 命名空间的 snapshot 中，整数为小端:
+ * magic(u32) version(u16) 固件标记(8 字节 ELF SHA256 + ota_seq u32) generation(u32) 命名空间数(u16)
+ *   命名空间: 名称长度(u8) 名称 键数(u16)
+ *     键: 名称长度(u8) 名称 类型(u8, 0 整数 / 1 字符串) 整数(i32) 或 字符串长度(u16) 字符串
+ * crc32(u32)，覆盖之前的所有字节
+ */
+#define SETTINGS_SNAPSHOT_NAMESPACE     "settings"
+#define SETTINGS_SNAPSHOT_KEY           "snapshot"
+#define SETTINGS_GENERATION_KEY         "generation"
+#define SETTINGS_SNAPSHOT_MAGIC         0x54535A58
+#define SETTINGS_SNAPSHOT_VERSION       2
+// 更换固件后启动这么久再重写快照，让启动过程中用到的命名空间都加载完
+#define SETTINGS_SNAPSHOT_DELAY_MS      30000
+
+// 启动过程中读取、且只通过 Settings 修改的命名空间
+static const char* const kSnapshotNamespaces[] = {"audio", "board", "display", "mqtt", "network", "websocket"};
+#endif
+
+struct SettingsValue {
+    bool is_string = false;
+    int32_t int_value = 0;
+    std::string string_value;
+
+    bool operator==(const SettingsValue& other) const {
+        return is_string == other.is_string && int_value == other.int_value && string_value == other.string_value;
+    }
+};
+
+typedef std::map<std::string, SettingsValue> SettingsMap;
+
+struct SettingsNamespace {
+    std::string name;
+    // 只读快照，修改时复制一份再替换，读取方无需加锁
+    std::atomic<const SettingsMap*> values = nullptr;
+    // 尚未写入 NVS 的修改，空值表示删除
+    std::map<std::string, std::optional<SettingsValue>> pending;
+    bool erase_all_pending = false;
+    // 是否保存在启动快照中
+    bool in_snapshot = false;
+    SettingsNamespace* next = nullptr;
+};
+
+class SettingsStore {
+public:
+    static SettingsStore& GetInstance() {
+        static SettingsStore instance;
+        return instance;
+    }
+
+    SettingsNamespace* GetNamespace(const std::string& name);
+    bool Get(SettingsNamespace* ns, const std::string& key, SettingsValue& value);
+    void Set(SettingsNamespace* ns, const std::string& key, const std::optional<SettingsValue>& value);
+    void EraseAll(SettingsNamespace* ns);
+    // 显式保存（force）时重写过期的快照，后台写入只在更换固件后重建快照
+    void Flush(bool force = true);
+    void LoadSnapshot();
+    void DiscardAll();
+
+private:
+    // 保护快照替换和待写入的修改
+    std::mutex mutex_;
+    // 保证各批修改按顺序写入 NVS
+    std::mutex flush_mutex_;
+    // 命名空间只增不减，新的插入到链表头部
+    std::atomic<SettingsNamespace*> namespaces_ = nullptr;
+    // 正在读取快照的数量，为 0 时被替换的旧快照可以释放
+    std::atomic<int> readers_ = 0;
+    std::vector<const SettingsMap*> retired_;
+    esp_timer_handle_t flush_timer_ = nullptr;
+    esp_timer_handle_t snapshot_timer_ = nullptr;
+    TaskHandle_t flush_task_ = nullptr;
+    int64_t first_pending_time_ = 0;
+    // 内存中的设置与 NVS 中的快照不一致
+    bool snapshot_dirty_ = false;
+    // NVS 中的快照与原有的键一致，第一次修改键之前需要先使其失效
+    bool snapshot_valid_ = false;
+    // 快照缺失或由其他固件保存，不等显式保存，在后台重建
+    bool snapshot_rebuild_ = false;
+    // 快照失效时加一，同时保存在 NVS 键和快照中，两者不一致说明快照已过期
+    uint32_t snapshot_generation_ = 0;
+
+    SettingsStore();
+    SettingsMap* Load(const std::string& name);
+    SettingsNamespace* AddNamespace(const std::string& name, const SettingsMap* values);
+    bool IsSnapshotNamespace(const std::string& name);
+    std::vector<uint8_t> SerializeSnapshot();
+    bool ParseSnapshot(const std::vector<uint8_t>& data);
+    void Publish(SettingsNamespace* ns, const SettingsMap* values);
+    void ScheduleFlush();
+    void MarkSnapshotDirty();
+    void RequestSnapshotRebuild();
+};
+
+#ifdef CONFIG_SETTINGS_SNAPSHOT
+// 当前固件的标记，换了固件（包括 OTA 回退后再升级）时快照中的值可能已落后于原有的键
+static void GetFirmwareStamp(uint8_t stamp[12]) {
+    memcpy(stamp, esp_app_get_description()->app_elf_sha256, 8);
+    uint32_t ota_seq = 0;
+    auto partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_OTA, nullptr);
+    if (partition != nullptr) {
+        for (int i = 0; i < 2; i++) {
+            esp_ota_select_entry_t entry;
+            if (esp_partition_read(partition, i * SPI_FLASH_SEC_SIZE, &entry, sizeof(entry)) == ESP_OK &&
+                entry.ota_seq != UINT32_MAX && entry.ota_seq > ota_seq) {
+                ota_seq = entry.ota_seq;
+            }
+        }
+    }
+    memcpy(stamp + 8, &ota_seq, 4);
 }
+#endif
 
-Settings::~Settings() {
-    if (nvs_handle_ != 0) {
-        if (read_write_ && dirty_) {
-            ESP_ERROR_CHECK(nvs_commit(nvs_handle_));
+SettingsStore::SettingsStore() {
+    // 写入 NVS 可能耗时几十毫秒，放在单独的任务中，不占用 esp_timer 任务
+    xTaskCreate([](void* arg) {
+        auto store = static_cast<SettingsStore*>(arg);
+        while (true) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            store->Flush(false);
         }
-        nvs_close(nvs_handle_);
+    }, "settings_flush", 4096, this, 1, &flush_task_);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = [](void* arg) {
+            xTaskNotifyGive(static_cast<SettingsStore*>(arg)->flush_task_);
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "settings_flush",
+        .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &flush_timer_));
+    timer_args.name = "settings_snapshot";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &snapshot_timer_));
+    // esp_restart 前写入尚未保存的修改
+    esp_register_shutdown_handler([]() {
+        SettingsStore::GetInstance().Flush();
+    });
+}
+
+SettingsMap* SettingsStore::Load(const std::string& name) {
+    int64_t start_time = esp_timer_get_time();
+    auto values = new SettingsMap();
+    nvs_handle_t handle;
+    if (nvs_open(name.c_str(), NVS_READONLY, &handle) != ESP_OK) {
+        ESP_LOGI(TAG, "Namespace %s not found in NVS", name.c_str());
+        return values;
     }
+
+    nvs_iterator_t it = nullptr;
+    auto ret = nvs_entry_find(NVS_DEFAULT_PART_NAME, name.c_str(), NVS_TYPE_ANY, &it);
+    while (ret == ESP_OK) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+        SettingsValue value;
+        if (info.type == NVS_TYPE_I32) {
+            if (nvs_get_i32(handle, info.key, &value.int_value) == ESP_OK) {
+                (*values)[info.key] = value;
+            }
+        } else if (info.type == NVS_TYPE_STR) {
+            size_t length = 0;
+            if (nvs_get_str(handle, info.key, nullptr, &length) == ESP_OK) {
+                value.is_string = true;
+                value.string_value.resize(length);
+                if (nvs_get_str(handle, info.key, value.string_value.data(), &length) == ESP_OK) {
+                    while (!value.string_value.empty() && value.string_value.back() == '\0') {
+                        value.string_value.pop_back();
+                    }
+                    (*values)[info.key] = value;
+                }
+            }
+        }
+        ret = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+    nvs_close(handle);
+    ESP_LOGI(TAG, "Loaded namespace %s from NVS, %u keys in %lld us", name.c_str(), values->size(),
+        esp_timer_get_time() - start_time);
+    return values;
 }
 
-std::string Settings::GetString(const std::string& key, const std::string& default_value) {
-    if (nvs_handle_ == 0) {
-        return default_value;
+// 需持有 mutex_
+SettingsNamespace* SettingsStore::AddNamespace(const std::string& name, const SettingsMap* values) {
+    auto ns = new SettingsNamespace();
+    ns->name = name;
+    ns->values = values;
+    ns->in_snapshot = IsSnapshotNamespace(name);
+    ns->next = namespaces_.load();
+    namespaces_ = ns;
+    return ns;
+}
+
+bool SettingsStore::IsSnapshotNamespace(const std::string& name) {
+#ifdef CONFIG_SETTINGS_SNAPSHOT
+    for (auto snapshot_name : kSnapshotNamespaces) {
+        if (name == snapshot_name) {
+            return true;
+        }
     }
+#endif
+    return false;
+}
 
-    size_t length = 0;
-    if (nvs_get_str(nvs_handle_, key.c_str(), nullptr, &length) != ESP_OK) {
-        return default_value;
+SettingsNamespace* SettingsStore::GetNamespace(const std::string& name) {
+    for (auto ns = namespaces_.load(); ns != nullptr; ns = ns->next) {
+        if (ns->name == name) {
+            return ns;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto ns = namespaces_.load(); ns != nullptr; ns = ns->next) {
+        if (ns->name == name) {
+            return ns;
+        }
+    }
+    auto ns = AddNamespace(name, Load(name));
+    if (ns->in_snapshot) {
+        // 快照中没有的命名空间从原有的键读取，随后写入快照
+        MarkSnapshotDirty();
+    }
+    return ns;
+}
+
+bool SettingsStore::Get(SettingsNamespace* ns, const std::string& key, SettingsValue& value) {
+    readers_++;
+    auto values = ns->values.load();
+    auto it = values->find(key);
+    bool found = it != values->end();
+    if (found) {
+        value = it->second;
+    }
+    readers_--;
+    return found;
+}
+
+// 需持有 mutex_，旧快照在没有读取方时由 Flush 释放
+void SettingsStore::Publish(SettingsNamespace* ns, const SettingsMap* values) {
+    retired_.push_back(ns->values.exchange(values));
+}
+
+void SettingsStore::Set(SettingsNamespace* ns, const std::string& key, const std::optional<SettingsValue>& value) {
+    // 写入 NVS 时才会发现的错误，在这里提前检查
+    if (key.empty() || key.size() >= NVS_KEY_NAME_MAX_SIZE) {
+        ESP_LOGE(TAG, "Invalid key: %s", key.c_str());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto current = ns->values.load();
+    auto it = current->find(key);
+    if (value.has_value() ? (it != current->end() && it->second == *value) : it == current->end()) {
+        return;
+    }
+
+    auto values = new SettingsMap(*current);
+    if (value.has_value()) {
+        (*values)[key] = *value;
+    } else {
+        values->erase(key);
+    }
+    Publish(ns, values);
+    ns->pending[key] = value;
+    if (ns->in_snapshot) {
+        MarkSnapshotDirty();
+    }
+    ScheduleFlush();
+}
+
+void SettingsStore::EraseAll(SettingsNamespace* ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Publish(ns, new SettingsMap());
+    ns->pending.clear();
+    ns->erase_all_pending = true;
+    if (ns->in_snapshot) {
+        MarkSnapshotDirty();
+    }
+    ScheduleFlush();
+}
+
+// 需持有 mutex_，每次修改都推迟写入，直到距第一次未写入的修改超过最大延迟
+void SettingsStore::ScheduleFlush() {
+    int64_t now = esp_timer_get_time();
+    if (first_pending_time_ == 0) {
+        first_pending_time_ = now;
+        esp_timer_start_once(flush_timer_, SETTINGS_FLUSH_DELAY_MS * 1000);
+    } else if (now - first_pending_time_ < SETTINGS_FLUSH_MAX_DELAY_MS * 1000) {
+        esp_timer_restart(flush_timer_, SETTINGS_FLUSH_DELAY_MS * 1000);
+    }
+}
+
+// 需持有 mutex_，快照只在显式保存或重启前重写，平时的修改只写原有的键
+void SettingsStore::MarkSnapshotDirty() {
+    snapshot_dirty_ = true;
+}
+
+// 需持有 mutex_，更换固件后的第一次启动在 SETTINGS_SNAPSHOT_DELAY_MS 后重建一次快照
+void SettingsStore::RequestSnapshotRebuild() {
+    snapshot_dirty_ = true;
+    if (!snapshot_rebuild_) {
+        snapshot_rebuild_ = true;
+        esp_timer_start_once(snapshot_timer_, SETTINGS_SNAPSHOT_DELAY_MS * 1000);
+    }
+}
+
+void SettingsStore::Flush(bool force) {
+    struct Batch {
+        std::string name;
+        bool erase_all;
+        std::map<std::string, std::optional<SettingsValue>> pending;
+    };
+
+    std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+    std::vector<Batch> batches;
+    std::vector<uint8_t> snapshot;
+    bool generation_changed = false;
+    uint32_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        esp_timer_stop(flush_timer_);
+        first_pending_time_ = 0;
+        for (auto ns = namespaces_.load(); ns != nullptr; ns = ns->next) {
+            if (ns->erase_all_pending || !ns->pending.empty()) {
+                batches.push_back({ns->name, ns->erase_all_pending, std::move(ns->pending)});
+                ns->pending.clear();
+                ns->erase_all_pending = false;
+                generation_changed |= ns->in_snapshot && snapshot_valid_;
+            }
+        }
+        // 快照失效后，直到下次重写之前的修改都不用再更新 generation
+        if (generation_changed) {
+            snapshot_generation_++;
+            snapshot_valid_ = false;
+        }
+        generation = snapshot_generation_;
+        // 修改已全部取出，此时的快照与本次写入后的键一致
+        if (snapshot_dirty_ && (force || snapshot_rebuild_)) {
+            snapshot = SerializeSnapshot();
+            snapshot_dirty_ = false;
+            snapshot_valid_ = true;
+            snapshot_rebuild_ = false;
+            esp_timer_stop(snapshot_timer_);
+        }
+        if (readers_ == 0) {
+            for (auto values : retired_) {
+                delete values;
+            }
+            retired_.clear();
+        }
+    }
+
+    // 写入 NVS 时不持有 mutex_，不影响读取和修改
+    // 原有的键始终是完整的设置，关闭快照或回退固件后仍然可用
+    // 快照有效时先更新 generation 使其失效，再写键，最后按需重写快照，中途断电时启动会回到原有的键
+#ifdef CONFIG_SETTINGS_SNAPSHOT
+    if (generation_changed) {
+        nvs_handle_t handle;
+        if (nvs_open(SETTINGS_SNAPSHOT_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK) {
+            ESP_ERROR_CHECK(nvs_set_u32(handle, SETTINGS_GENERATION_KEY, generation));
+            ESP_ERROR_CHECK(nvs_commit(handle));
+            nvs_close(handle);
+        } else {
+            ESP_LOGE(TAG, "Failed to open namespace %s", SETTINGS_SNAPSHOT_NAMESPACE);
+        }
+    }
+#endif
+    for (auto& batch : batches) {
+        nvs_handle_t handle;
+        if (nvs_open(batch.name.c_str(), NVS_READWRITE, &handle) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to open namespace %s", batch.name.c_str());
+            continue;
+        }
+        if (batch.erase_all) {
+            ESP_ERROR_CHECK(nvs_erase_all(handle));
+        }
+        for (auto& [key, value] : batch.pending) {
+            if (!value.has_value()) {
+                auto ret = nvs_erase_key(handle, key.c_str());
+                if (ret != ESP_ERR_NVS_NOT_FOUND) {
+                    ESP_ERROR_CHECK(ret);
+                }
+            } else if (value->is_string) {
+                ESP_ERROR_CHECK(nvs_set_str(handle, key.c_str(), value->string_value.c_str()));
+            } else {
+                ESP_ERROR_CHECK(nvs_set_i32(handle, key.c_str(), value->int_value));
+            }
+        }
+        ESP_ERROR_CHECK(nvs_commit(handle));
+        nvs_close(handle);
+        ESP_LOGI(TAG, "Flushed %u changes to namespace %s", batch.pending.size(), batch.name.c_str());
+    }
+#ifdef CONFIG_SETTINGS_SNAPSHOT
+    if (!snapshot.empty()) {
+        nvs_handle_t handle;
+        if (nvs_open(SETTINGS_SNAPSHOT_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK) {
+            ESP_ERROR_CHECK(nvs_set_blob(handle, SETTINGS_SNAPSHOT_KEY, snapshot.data(), snapshot.size()));
+            ESP_ERROR_CHECK(nvs_commit(handle));
+            nvs_close(handle);
+            ESP_LOGI(TAG, "Saved snapshot, %u bytes, generation %lu", snapshot.size(), generation);
+        } else {
+            ESP_LOGE(TAG, "Failed to open namespace %s", SETTINGS_SNAPSHOT_NAMESPACE);
+        }
+    }
+#endif
+}
+
+// 需持有 mutex_
+std::vector<uint8_t> SettingsStore::SerializeSnapshot() {
+    std::vector<uint8_t> data;
+#ifdef CONFIG_SETTINGS_SNAPSHOT
+    auto put = [&data](const void* value, size_t len) {
+        auto bytes = static_cast<const uint8_t*>(value);
+        data.insert(data.end(), bytes, bytes + len);
+    };
+    auto put_string = [&put](const std::string& value, size_t len_size) {
+        uint16_t len = value.size();
+        put(&len, len_size);
+        put(value.data(), value.size());
+    };
+
+    uint32_t magic = SETTINGS_SNAPSHOT_MAGIC;
+    uint16_t version = SETTINGS_SNAPSHOT_VERSION;
+    uint8_t stamp[12];
+    uint16_t count = 0;
+    GetFirmwareStamp(stamp);
+    put(&magic, 4);
+    put(&version, 2);
+    put(stamp, sizeof(stamp));
+    put(&snapshot_generation_, 4);
+    size_t count_offset = data.size();
+    put(&count, 2);
+    for (auto ns = namespaces_.load(); ns != nullptr; ns = ns->next) {
+        if (!ns->in_snapshot) {
+            continue;
+        }
+        auto values = ns->values.load();
+        uint16_t key_count = values->size();
+        put_string(ns->name, 1);
+        put(&key_count, 2);
+        for (auto& [key, value] : *values) {
+            uint8_t type = value.is_string ? 1 : 0;
+            put_string(key, 1);
+            put(&type, 1);
+            if (value.is_string) {
+                put_string(value.string_value, 2);
+            } else {
+                put(&value.int_value, 4);
+            }
+        }
+        count++;
+    }
+    memcpy(data.data() + count_offset, &count, 2);
+    uint32_t crc = esp_rom_crc32_le(0, data.data(), data.size());
+    put(&crc, 4);
+#endif
+    return data;
+}
+
+// 需持有 mutex_，校验失败时不加载任何命名空间
+bool SettingsStore::ParseSnapshot(const std::vector<uint8_t>& data) {
+#ifndef CONFIG_SETTINGS_SNAPSHOT
+    return false;
+#else
+    size_t pos = 0;
+    auto get = [&data, &pos](void* value, size_t len) {
+        if (pos + len > data.size()) {
+            return false;
+        }
+        memcpy(value, data.data() + pos, len);
+        pos += len;
+        return true;
+    };
+    auto get_string = [&get, &data, &pos](std::string& value, size_t len_size) {
+        uint16_t len = 0;
+        if (!get(&len, len_size) || pos + len > data.size()) {
+            return false;
+        }
+        value.assign((const char*)data.data() + pos, len);
+        pos += len;
+        return true;
+    };
+
+    uint32_t crc = 0;
+    if (data.size() < 12) {
+        return false;
+    }
+    memcpy(&crc, data.data() + data.size() - 4, 4);
+    if (crc != esp_rom_crc32_le(0, data.data(), data.size() - 4)) {
+        ESP_LOGW(TAG, "Snapshot checksum mismatch");
+        return false;
+    }
+    uint32_t magic = 0, generation = 0;
+    uint16_t version = 0, count = 0;
+    uint8_t stamp[12], current_stamp[12];
+    get(&magic, 4);
+    get(&version, 2);
+    if (magic != SETTINGS_SNAPSHOT_MAGIC || version != SETTINGS_SNAPSHOT_VERSION) {
+        ESP_LOGW(TAG, "Unsupported snapshot version %u", version);
+        return false;
+    }
+    if (!get(stamp, sizeof(stamp)) || !get(&generation, 4) || !get(&count, 2)) {
+        ESP_LOGW(TAG, "Snapshot is malformed");
+        return false;
+    }
+    // 其他固件可能只改了原有的键
+    GetFirmwareStamp(current_stamp);
+    if (memcmp(stamp, current_stamp, sizeof(stamp)) != 0) {
+        ESP_LOGI(TAG, "Snapshot was saved by another firmware, reloading from NVS keys");
+        return false;
+    }
+    // generation 不一致说明快照写入后键又被修改过
+    if (generation != snapshot_generation_) {
+        ESP_LOGI(TAG, "Snapshot generation %lu is stale (%lu), reloading from NVS keys", generation, snapshot_generation_);
+        MarkSnapshotDirty();
+        return false;
+    }
+
+    std::vector<std::pair<std::string, SettingsMap*>> namespaces;
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        std::string name;
+        uint16_t key_count = 0;
+        auto values = new SettingsMap();
+        namespaces.emplace_back(std::string(), values);
+        ok = get_string(name, 1) && get(&key_count, 2);
+        namespaces.back().first = name;
+        for (int j = 0; j < key_count && ok; j++) {
+            std::string key;
+            uint8_t type = 0;
+            SettingsValue value;
+            ok = get_string(key, 1) && get(&type, 1);
+            if (ok && type == 1) {
+                value.is_string = true;
+                ok = get_string(value.string_value, 2);
+            } else if (ok) {
+                ok = type == 0 && get(&value.int_value, 4);
+            }
+            if (ok) {
+                (*values)[key] = value;
+            }
+        }
+    }
+    if (!ok || pos != data.size() - 4) {
+        ESP_LOGW(TAG, "Snapshot is malformed");
+        for (auto& [name, values] : namespaces) {
+            delete values;
+        }
+        return false;
+    }
+
+    // 不再属于快照的命名空间改为从原有的键读取
+    for (auto& [name, values] : namespaces) {
+        if (IsSnapshotNamespace(name)) {
+            AddNamespace(name, values);
+        } else {
+            delete values;
+            RequestSnapshotRebuild();
+        }
+    }
+    return true;
+#endif
+}
+
+void SettingsStore::LoadSnapshot() {
+#ifdef CONFIG_SETTINGS_SNAPSHOT
+    int64_t start_time = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (namespaces_.load() != nullptr) {
+        ESP_LOGW(TAG, "Snapshot must be loaded before any settings are used");
+        return;
+    }
+
+    nvs_handle_t handle;
+    std::vector<uint8_t> data;
+    if (nvs_open(SETTINGS_SNAPSHOT_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_u32(handle, SETTINGS_GENERATION_KEY, &snapshot_generation_);
+        size_t length = 0;
+        if (nvs_get_blob(handle, SETTINGS_SNAPSHOT_KEY, nullptr, &length) == ESP_OK) {
+            data.resize(length);
+            if (nvs_get_blob(handle, SETTINGS_SNAPSHOT_KEY, data.data(), &length) != ESP_OK) {
+                data.clear();
+            }
+        }
+        nvs_close(handle);
+    }
+    if (data.empty()) {
+        ESP_LOGI(TAG, "No snapshot found, settings will be migrated from NVS keys");
+        RequestSnapshotRebuild();
+        return;
     }
+    if (!ParseSnapshot(data)) {
+        // 只是过期的快照等下次显式保存再重写，损坏或由其他固件保存的快照在后台重建
+        if (!snapshot_dirty_) {
+            RequestSnapshotRebuild();
+        }
+        return;
+    }
+    snapshot_valid_ = true;
+    int count = 0;
+    for (auto ns = namespaces_.load(); ns != nullptr; ns = ns->next) {
+        count++;
+    }
+    ESP_LOGI(TAG, "Loaded snapshot, %d namespaces, %u bytes in %lld us", count, data.size(),
+        esp_timer_get_time() - start_time);
+#endif
+}
+
+void SettingsStore::DiscardAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto ns = namespaces_.load(); ns != nullptr; ns = ns->next) {
+        Publish(ns, new SettingsMap());
+        ns->pending.clear();
+        ns->erase_all_pending = false;
+    }
+    snapshot_dirty_ = false;
+    snapshot_valid_ = false;
+    snapshot_rebuild_ = false;
+    esp_timer_stop(snapshot_timer_);
+    ESP_LOGI(TAG, "Discarded cached settings");
+}
+
+Settings::Settings(const std::string& ns, bool read_write) : ns_(ns), read_write_(read_write) {
+    namespace_ = SettingsStore::GetInstance().GetNamespace(ns);
+}
+
+Settings::~Settings() {
+}
+
+void Settings::Flush() {
+    SettingsStore::GetInstance().Flush();
+}
+
+void Settings::LoadSnapshot() {
+    SettingsStore::GetInstance().LoadSnapshot();
+}
 
-    std::string value;
-    value.resize(length);
-    ESP_ERROR_CHECK(nvs_get_str(nvs_handle_, key.c_str(), value.data(), &length));
-    while (!value.empty() && value.back() == '\0') {
-        value.pop_back();
+void Settings::DiscardCache() {
+    SettingsStore::GetInstance().DiscardAll();
+}
+
+std::string Settings::GetString(const std::string& key, const std::string& default_value) {
+    SettingsValue value;
+    if (!SettingsStore::GetInstance().Get(namespace_, key, value) || !value.is_string) {
+        return default_value;
     }
-    return value;
+    return value.string_value;
 }
 
 void Settings::SetString(const std::string& key, const std::string& value) {
     if (read_write_) {
-        ESP_ERROR_CHECK(nvs_set_str(nvs_handle_, key.c_str(), value.c_str()));
-        dirty_ = true;
+        SettingsValue item;
+        item.is_string = true;
+        item.string_value = value;
+        SettingsStore::GetInstance().Set(namespace_, key, item);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
 }
 
 int32_t Settings::GetInt(const std::string& key, int32_t default_value) {
-    if (nvs_handle_ == 0) {
+    SettingsValue value;
+    if (!SettingsStore::GetInstance().Get(namespace_, key, value) || value.is_string) {
         return default_value;
     }
-
-    int32_t value;
-    if (nvs_get_i32(nvs_handle_, key.c_str(), &value) != ESP_OK) {
-        return default_value;
-    }
-    return value;
+    return value.int_value;
 }
 
 void Settings::SetInt(const std::string& key, int32_t value) {
     if (read_write_) {
-        ESP_ERROR_CHECK(nvs_set_i32(nvs_handle_, key.c_str(), value));
-        dirty_ = true;
+        SettingsValue item;
+        item.int_value = value;
+        SettingsStore::GetInstance().Set(namespace_, key, item);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
@@ -69,10 +707,7 @@ void Settings::SetInt(const std::string& key, int32_t value) {
 
 void Settings::EraseKey(const std::string& key) {
     if (read_write_) {
-        auto ret = nvs_erase_key(nvs_handle_, key.c_str());
-        if (ret != ESP_ERR_NVS_NOT_FOUND) {
-            ESP_ERROR_CHECK(ret);
-        }
+        SettingsStore::GetInstance().Set(namespace_, key, std::nullopt);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
@@ -80,7 +715,7 @@ void Settings::EraseKey(const std::string& key) {
 
 void Settings::EraseAll() {
     if (read_write_) {
-        ESP_ERROR_CHECK(nvs_erase_all(nvs_handle_));
+        SettingsStore::GetInstance().EraseAll(namespace_);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
@@ -4,6 +4,10 @@
 #include <string>
 #include <nvs_flash.h>
 
+struct SettingsNamespace;
+
+// 设置在内存中按命名空间缓存，首次使用时从 NVS 加载，读取不加锁
+// 修改立即生效，延迟合并后在后台写入 NVS，重启前会自动写入
 class Settings {
 public:
     Settings(const std::string& ns, bool read_write = false);
@@ -16,11 +20,17 @@ public:
     void EraseKey(const std::string& key);
     void EraseAll();
 
+    // 立即将尚未写入的修改写入 NVS，例如进入深度睡眠前
+    static void Flush();
+    // 在 app_main 初始化 NVS 后调用，一次读入启动快照
+    static void LoadSnapshot();
+    // NVS 被整体擦除后调用，丢弃缓存和尚未写入的修改
+    static void DiscardCache();
+
 private:
     std::string ns_;
-    nvs_handle_t nvs_handle_ = 0;
+    SettingsNamespace* namespace_ = nullptr;
     bool read_write_ = false;
-    bool dirty_ = false;
 };
 
 #endif
@@ -0,0 +1,61 @@
+#! /usr/bin/env python3
+import argparse
+import time
+import zlib
+
+
+'''
+  Compress a firmware image for OTA. The device recognizes the zlib header and decompresses
+  the download with a 32KB window while writing it to flash (see main/inflate_stream.h).
+  The output is verified by decompressing it in small chunks, the same way the device does,
+  and the compression ratio and decompression throughput are printed.
+
+  compress_firmware.py build/xiaozhi.bin build/xiaozhi.bin.z
+'''
+
+CHUNK_SIZE = 4096
+
+
+def compress(data, level):
+    # wbits=15 即 32KB 窗口，与设备端的解压窗口一致
+    compressor = zlib.compressobj(level, zlib.DEFLATED, 15, 9)
+    return compressor.compress(data) + compressor.flush()
+
+
+def verify(data, compressed):
+    decompressor = zlib.decompressobj(15)
+    output = bytearray()
+    start = time.time()
+    for pos in range(0, len(compressed), CHUNK_SIZE):
+        output += decompressor.decompress(compressed[pos:pos + CHUNK_SIZE])
+    output += decompressor.flush()
+    elapsed = time.time() - start
+    if not decompressor.eof or decompressor.unused_data or bytes(output) != data:
+        raise Exception("Round-trip verification failed")
+    return elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser(description='压缩 OTA 固件，并验证可以流式解压还原')
+    parser.add_argument('input', help='固件文件，例如 build/xiaozhi.bin')
+    parser.add_argument('output', help='压缩后的固件文件')
+    parser.add_argument('--level', '-l', type=int, default=9, help='压缩级别 (默认: 9)')
+    args = parser.parse_args()
+
+    data = open(args.input, 'rb').read()
+    if not data or data[0] != 0xE9:
+        print("Warning: input does not look like an ESP application image")
+
+    start = time.time()
+    compressed = compress(data, args.level)
+    compress_time = time.time() - start
+    decompress_time = verify(data, compressed)
+    open(args.output, 'wb').write(compressed)
+
+    print(f"{len(data)} -> {len(compressed)} bytes ({len(compressed) * 100 / len(data):.1f}%), "
+          f"compressed in {compress_time:.2f} s")
+    print(f"Verified, decompressed at {len(data) / 1024 / 1024 / max(decompress_time, 1e-6):.1f} MB/s on this host")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,199 @@
+#! /usr/bin/env python3
+import argparse
+import hashlib
+import struct
+import time
+
+
+'''
+  Generate and apply XZDELTA1 firmware patches (see main/delta_patch.h for the format).
+  The patch turns the firmware that is running on the device into the new firmware,
+  so it is only valid for devices running exactly the old image.
+
+  generate: delta_patch.py generate old.bin new.bin patch.bin
+  apply:    delta_patch.py apply old.bin patch.bin out.bin
+'''
+
+MAGIC = b'XZDELTA1'
+HEADER = struct.Struct('<8sII32s32s')
+KEY_SIZE = 12
+INDEX_STEP = 4
+MAX_CANDIDATES = 8
+
+
+def write_varint(out, value):
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return value, pos
+        shift += 7
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def unzigzag(value):
+    return (value >> 1) if (value & 1) == 0 else -((value + 1) >> 1)
+
+
+def build_index(old):
+    index = {}
+    for pos in range(0, len(old) - KEY_SIZE + 1, INDEX_STEP):
+        candidates = index.setdefault(old[pos:pos + KEY_SIZE], [])
+        if len(candidates) < MAX_CANDIDATES:
+            candidates.append(pos)
+    return index
+
+
+def extend_forward(old, new, old_pos, new_pos):
+    # 与 bsdiff 相同，向前延伸近似匹配，取 2 * 相同字节数 - 长度 最大的位置
+    limit = min(len(old) - old_pos, len(new) - new_pos)
+    score = best_score = best_len = 0
+    i = 0
+    while i < limit:
+        if old[old_pos + i] == new[new_pos + i]:
+            score += 1
+        else:
+            score -= 1
+        i += 1
+        if score > best_score:
+            best_score = score
+            best_len = i
+        elif score < best_score - 64:
+            break
+    return best_len
+
+
+def encode_diff(out, old, new, old_pos, new_pos, length):
+    # 差值字节中连续的 0 用长度表示，其余原样保存
+    diff = bytes((new[new_pos + i] - old[old_pos + i]) & 0xFF for i in range(length))
+    i = 0
+    while i < length:
+        start = i
+        while i < length and diff[i] == 0:
+            i += 1
+        zero_run = i - start
+        start = i
+        while i < length and not (diff[i] == 0 and i + 1 < length and diff[i + 1] == 0):
+            i += 1
+        write_varint(out, zero_run)
+        write_varint(out, i - start)
+        out += diff[start:i]
+
+
+def generate(old, new):
+    index = build_index(old)
+    out = bytearray(HEADER.pack(MAGIC, len(old), len(new),
+                                hashlib.sha256(old).digest(), hashlib.sha256(new).digest()))
+    old_pos = 0
+    new_pos = 0
+    scan = 0
+    while new_pos < len(new):
+        # 在新固件中向后查找能与旧固件匹配的位置，中间的字节作为新增数据
+        match_old = match_len = 0
+        while scan + KEY_SIZE <= len(new):
+            best = 0
+            for candidate in index.get(new[scan:scan + KEY_SIZE], ()):
+                length = extend_forward(old, new, candidate, scan)
+                if length > best:
+                    best = length
+                    match_old = candidate
+            if best >= KEY_SIZE * 2:
+                match_len = best
+                break
+            scan += 1
+        if match_len == 0:
+            scan = len(new)
+
+        extra_len = scan - new_pos
+        seek = match_old - old_pos
+        # 控制块：先按 seek 移动旧固件位置，再输出新增数据，最后输出差值数据
+        write_varint(out, zigzag(seek))
+        write_varint(out, extra_len)
+        write_varint(out, match_len)
+        out += new[new_pos:scan]
+        old_pos = match_old
+        if match_len > 0:
+            encode_diff(out, old, new, old_pos, scan, match_len)
+        old_pos += match_len
+        new_pos = scan + match_len
+        scan = new_pos
+    return bytes(out)
+
+
+def apply(old, patch):
+    magic, old_size, new_size, old_sha256, new_sha256 = HEADER.unpack_from(patch, 0)
+    if magic != MAGIC:
+        raise Exception("Invalid patch magic")
+    if old_size != len(old) or hashlib.sha256(old).digest() != old_sha256:
+        raise Exception("Patch does not match the old firmware")
+    pos = HEADER.size
+    out = bytearray()
+    old_pos = 0
+    while len(out) < new_size:
+        seek, pos = read_varint(patch, pos)
+        extra_len, pos = read_varint(patch, pos)
+        diff_len, pos = read_varint(patch, pos)
+        old_pos += unzigzag(seek)
+        out += patch[pos:pos + extra_len]
+        pos += extra_len
+        end = old_pos + diff_len
+        while old_pos < end:
+            zero_run, pos = read_varint(patch, pos)
+            literal_len, pos = read_varint(patch, pos)
+            out += old[old_pos:old_pos + zero_run]
+            old_pos += zero_run
+            for i in range(literal_len):
+                out.append((old[old_pos + i] + patch[pos + i]) & 0xFF)
+            old_pos += literal_len
+            pos += literal_len
+    if hashlib.sha256(out).digest() != new_sha256:
+        raise Exception("Patched firmware hash mismatch")
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='生成或应用固件差分补丁')
+    subparsers = parser.add_subparsers(dest='command', required=True)
+    gen = subparsers.add_parser('generate', help='根据新旧固件生成补丁，并验证补丁可以还原新固件')
+    gen.add_argument('old')
+    gen.add_argument('new')
+    gen.add_argument('patch')
+    app = subparsers.add_parser('apply', help='将补丁应用到旧固件')
+    app.add_argument('old')
+    app.add_argument('patch')
+    app.add_argument('output')
+    args = parser.parse_args()
+
+    if args.command == 'generate':
+        old = open(args.old, 'rb').read()
+        new = open(args.new, 'rb').read()
+        start = time.time()
+        patch = generate(old, new)
+        elapsed = time.time() - start
+        if apply(old, patch) != new:
+            raise Exception("Patch verification failed")
+        open(args.patch, 'wb').write(patch)
+        print(f"Patch {len(patch)} bytes ({len(patch) * 100 / len(new):.1f}% of {len(new)} bytes), "
+              f"generated in {elapsed:.1f} s, verified")
+    else:
+        old = open(args.old, 'rb').read()
+        patch = open(args.patch, 'rb').read()
+        open(args.output, 'wb').write(apply(old, patch))
+        print(f"Wrote {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,80 @@
+import argparse
+import json
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+'''
+  A stand-in for the image explain server.
+  Accept the multipart photo upload from the device, print the upload timing and size,
+  and reply with a fixed result. Point the explain URL to http://<this host>:<port>/explain
+'''
+class ExplainHandler(BaseHTTPRequestHandler):
+    save_image = False
+
+    def read_body(self):
+        if self.headers.get('Transfer-Encoding', '').lower() == 'chunked':
+            body = bytearray()
+            while True:
+                size = int(self.rfile.readline().strip().split(b';')[0], 16)
+                if size == 0:
+                    self.rfile.readline()
+                    break
+                body += self.rfile.read(size)
+                self.rfile.readline()
+            return bytes(body)
+        return self.rfile.read(int(self.headers.get('Content-Length', 0)))
+
+    def do_POST(self):
+        start = time.time()
+        body = self.read_body()
+        elapsed = time.time() - start
+
+        question = ''
+        image = b''
+        boundary = self.headers.get('Content-Type', '').split('boundary=')[-1].encode()
+        for part in body.split(b'--' + boundary):
+            headers, _, content = part.partition(b'\r\n\r\n')
+            content = content.rstrip(b'\r\n')
+            if b'name="question"' in headers:
+                question = content.decode('utf-8', errors='replace')
+            elif b'name="file"' in headers:
+                image = content
+
+        print(f"Received {len(body)} bytes (jpeg {len(image)} bytes) in {elapsed * 1000:.0f} ms, "
+              f"{len(body) / 1024 / max(elapsed, 1e-6):.1f} KB/s, question: {question}")
+        if self.save_image and image:
+            filename = f"explain_{int(start)}.jpg"
+            with open(filename, 'wb') as f:
+                f.write(image)
+            print(f"Saved {filename}")
+
+        response = json.dumps({"success": True, "result": f"received {len(image)} bytes"}).encode()
+        self.send_response(200)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(response)))
+        self.end_headers()
+        self.wfile.write(response)
+
+
+def main(port, save_image):
+    ExplainHandler.save_image = save_image
+    server = ThreadingHTTPServer(('0.0.0.0', port), ExplainHandler)
+    print(f"Explain debug server listening on 0.0.0.0:{port}...")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        print("\nStopping server...")
+    finally:
+        server.server_close()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='拍照识图调试服务器，统计图片上传耗时')
+    parser.add_argument('--port', '-p', type=int, default=8080,
+                        help='监听端口 (默认: 8080)')
+    parser.add_argument('--save', '-s', action='store_true',
+                        help='保存收到的图片')
+
+    args = parser.parse_args()
+    main(args.port, args.save)
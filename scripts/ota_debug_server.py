@@ -0,0 +1,139 @@
+import argparse
+import json
+import os
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+'''
+  A stand-in for the OTA server.
+  Answer the version check with the given firmware, serve the firmware file with an optional
+  bandwidth limit (to mimic a 4G link), and print the download time and throughput.
+  Range requests are supported, and --drop cuts the connection after the given number of bytes
+  to test resumable upgrades.
+  With --patch, a delta patch generated by delta_patch.py is also offered to devices running
+  --patch-from, and served from /firmware.patch.
+  Set the OTA URL to http://<this host>:<port>/ota/
+'''
+class OtaHandler(BaseHTTPRequestHandler):
+    firmware_path = ''
+    firmware_version = ''
+    rate_limit = 0
+    drop_after = 0
+    patch_path = ''
+    patch_from = ''
+
+    def handle_check_version(self):
+        length = int(self.headers.get('Content-Length', 0))
+        if length > 0:
+            self.rfile.read(length)
+        host = self.headers.get('Host')
+        firmware = {
+            "version": self.firmware_version,
+            "url": f"http://{host}/firmware.bin",
+        }
+        if self.patch_path:
+            firmware["patch"] = {
+                "from": self.patch_from,
+                "url": f"http://{host}/firmware.patch",
+            }
+        response = json.dumps({"firmware": firmware}).encode()
+        self.send_response(200)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(response)))
+        self.end_headers()
+        self.wfile.write(response)
+        print(f"Version check from {self.headers.get('Device-Id')}, offering {self.firmware_version}")
+
+    def handle_firmware(self, path):
+        size = os.path.getsize(path)
+        etag = f'"{int(os.path.getmtime(path))}-{size}"'
+        offset = 0
+        range_header = self.headers.get('Range', '')
+        if_range = self.headers.get('If-Range')
+        if range_header.startswith('bytes=') and (if_range is None or if_range == etag):
+            offset = int(range_header[6:].split('-')[0])
+        if offset > 0:
+            self.send_response(206)
+            self.send_header('Content-Range', f'bytes {offset}-{size - 1}/{size}')
+            print(f"Resume from {offset}")
+        else:
+            self.send_response(200)
+        self.send_header('Content-Type', 'application/octet-stream')
+        self.send_header('Content-Length', str(size - offset))
+        self.send_header('ETag', etag)
+        self.end_headers()
+
+        start = time.time()
+        sent = 0
+        chunk_size = 4096
+        with open(path, 'rb') as f:
+            f.seek(offset)
+            while True:
+                data = f.read(chunk_size)
+                if not data:
+                    break
+                if self.drop_after > 0 and sent >= self.drop_after:
+                    print(f"Dropping connection after {sent} bytes")
+                    self.close_connection = True
+                    return
+                try:
+                    self.wfile.write(data)
+                except (BrokenPipeError, ConnectionResetError):
+                    print(f"Connection closed after {sent} bytes")
+                    return
+                sent += len(data)
+                if self.rate_limit > 0:
+                    # 按限速计算这一块应当在何时发完
+                    delay = start + sent / self.rate_limit - time.time()
+                    if delay > 0:
+                        time.sleep(delay)
+        elapsed = time.time() - start
+        print(f"Sent {sent} bytes in {elapsed:.1f} s, {sent / 1024 / max(elapsed, 1e-6):.1f} KB/s")
+
+    def do_GET(self):
+        if self.path.startswith('/firmware.bin'):
+            self.handle_firmware(self.firmware_path)
+        elif self.path.startswith('/firmware.patch') and self.patch_path:
+            self.handle_firmware(self.patch_path)
+        else:
+            self.handle_check_version()
+
+    def do_POST(self):
+        self.handle_check_version()
+
+
+def main(port, firmware, version, rate, drop, patch, patch_from):
+    OtaHandler.firmware_path = firmware
+    OtaHandler.firmware_version = version
+    OtaHandler.rate_limit = rate * 1024
+    OtaHandler.drop_after = drop * 1024
+    OtaHandler.patch_path = patch or ''
+    OtaHandler.patch_from = patch_from
+    server = ThreadingHTTPServer(('0.0.0.0', port), OtaHandler)
+    print(f"OTA debug server listening on 0.0.0.0:{port}, firmware {firmware} ({os.path.getsize(firmware)} bytes)")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        print("\nStopping server...")
+    finally:
+        server.server_close()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='OTA 调试服务器，统计固件下载耗时')
+    parser.add_argument('firmware', help='固件文件，例如 build/xiaozhi.bin')
+    parser.add_argument('--port', '-p', type=int, default=8080,
+                        help='监听端口 (默认: 8080)')
+    parser.add_argument('--version', '-v', default='99.0.0',
+                        help='下发的固件版本号 (默认: 99.0.0)')
+    parser.add_argument('--rate', '-r', type=int, default=0,
+                        help='限速 KB/s，0 表示不限速')
+    parser.add_argument('--drop', '-d', type=int, default=0,
+                        help='每次发送这么多 KB 后断开连接，用于测试断点续传')
+    parser.add_argument('--patch', help='差分补丁文件，由 delta_patch.py 生成')
+    parser.add_argument('--patch-from', default='',
+                        help='补丁对应的旧固件版本号，即设备当前运行的版本')
+
+    args = parser.parse_args()
+    main(args.port, args.firmware, args.version, args.rate, args.drop, args.patch, args.patch_from)
@@ -0,0 +1,16 @@
+#ifndef HOST_TEST_FIXTURES_H
+#define HOST_TEST_FIXTURES_H
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// 读取构建时生成的测试数据，见 CMakeLists.txt
+inline std::vector<uint8_t> LoadFixture(const std::string& name) {
+    std::ifstream file(std::string(FIXTURE_DIR) + "/" + name, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+#endif // HOST_TEST_FIXTURES_H
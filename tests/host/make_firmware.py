@@ -0,0 +1,72 @@
+#! /usr/bin/env python3
+import argparse
+import random
+import struct
+
+
+'''
+  Generate a pair of synthetic firmware images for the host tests. The old image mixes
+  instruction-like words, string tables and padding like an application binary; the new image
+  moves code around, relinks addresses and patches strings, the kind of change the delta
+  patches and compression have to handle.
+
+  make_firmware.py old.bin new.bin
+'''
+
+SIZE = 640 * 1024
+
+
+def make_old(rng):
+    out = bytearray(b'\xE9\x05\x02\x20')
+    words = [rng.getrandbits(32) for _ in range(512)]
+    strings = [f'component_{i}: %s failed (%d)\0'.encode() for i in range(200)]
+    while len(out) < SIZE:
+        kind = rng.random()
+        if kind < 0.6:
+            # 代码段：重复出现的指令字，夹杂地址
+            for _ in range(rng.randint(16, 256)):
+                word = rng.choice(words) if rng.random() < 0.8 else 0x42000000 + rng.getrandbits(20) * 4
+                out += struct.pack('<I', word)
+        elif kind < 0.9:
+            for _ in range(rng.randint(4, 32)):
+                out += rng.choice(strings)
+        else:
+            out += bytes(rng.randint(16, 1024))
+    return bytes(out[:SIZE])
+
+
+def make_new(rng, old):
+    new = bytearray(old)
+    # 重新链接：一段区域内的地址整体偏移
+    for pos in range(64 * 1024, 256 * 1024, 4):
+        word, = struct.unpack_from('<I', new, pos)
+        if word & 0xFFF00000 == 0x42000000:
+            struct.pack_into('<I', new, pos, word + 0x40)
+    # 插入新代码，删除一段旧代码
+    insert = bytes(rng.getrandbits(8) for _ in range(3000))
+    new[100 * 1024:100 * 1024] = insert
+    del new[300 * 1024:302 * 1024]
+    # 零星修改
+    for _ in range(200):
+        pos = rng.randrange(16, len(new))
+        new[pos] = rng.getrandbits(8)
+    new += bytes(rng.getrandbits(8) for _ in range(5000))
+    return bytes(new)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='生成主机测试使用的新旧固件')
+    parser.add_argument('old')
+    parser.add_argument('new')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    old = make_old(rng)
+    new = make_new(rng, old)
+    open(args.old, 'wb').write(old)
+    open(args.new, 'wb').write(new)
+
+
+if __name__ == "__main__":
+    main()
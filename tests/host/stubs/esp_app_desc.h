@@ -0,0 +1,20 @@
+#ifndef ESP_APP_DESC_H
+#define ESP_APP_DESC_H
+
+#include <cstdint>
+
+typedef struct {
+    char version[32];
+    char project_name[32];
+    uint8_t app_elf_sha256[32];
+} esp_app_desc_t;
+
+// 测试修改 app_elf_sha256 来模拟更换固件
+inline esp_app_desc_t* host_app_description() {
+    static esp_app_desc_t desc = {"1.0.0", "xiaozhi", {0x5a}};
+    return &desc;
+}
+
+inline const esp_app_desc_t* esp_app_get_description() { return host_app_description(); }
+
+#endif // ESP_APP_DESC_H
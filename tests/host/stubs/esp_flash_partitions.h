@@ -0,0 +1,13 @@
+#ifndef ESP_FLASH_PARTITIONS_H
+#define ESP_FLASH_PARTITIONS_H
+
+#include <cstdint>
+
+typedef struct {
+    uint32_t ota_seq;
+    uint8_t seq_label[20];
+    uint32_t ota_state;
+    uint32_t crc;
+} esp_ota_select_entry_t;
+
+#endif // ESP_FLASH_PARTITIONS_H
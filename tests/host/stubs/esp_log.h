@@ -0,0 +1,14 @@
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <cstdio>
+
+// 主机测试只输出警告和错误
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+// 参数仍然参与编译，只用于日志的变量不会产生未使用的警告
+#define ESP_LOGI(tag, format, ...) do { if (0) fprintf(stderr, "%s" format, tag, ##__VA_ARGS__); } while (0)
+#define ESP_LOGD(tag, format, ...) ESP_LOGI(tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOGI(tag, format, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
@@ -0,0 +1,31 @@
+#ifndef ESP_PARTITION_H
+#define ESP_PARTITION_H
+
+#include <cstddef>
+#include <esp_err.h>
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_DATA_OTA = 0x00,
+    ESP_PARTITION_SUBTYPE_DATA_NVS = 0x02,
+} esp_partition_subtype_t;
+
+typedef struct esp_partition_t esp_partition_t;
+
+// 主机上没有分区表
+inline const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                       const char* label) {
+    (void)type; (void)subtype; (void)label;
+    return nullptr;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size) {
+    (void)partition; (void)src_offset; (void)dst; (void)size;
+    return ESP_ERR_NOT_FOUND;
+}
+
+#endif // ESP_PARTITION_H
@@ -0,0 +1,11 @@
+#ifndef ESP_SYSTEM_H
+#define ESP_SYSTEM_H
+
+#include <esp_err.h>
+
+typedef void (*shutdown_handler_t)(void);
+
+// 主机上不会重启，注册的处理函数不会被调用
+inline esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler) { (void)handler; return ESP_OK; }
+
+#endif // ESP_SYSTEM_H
@@ -0,0 +1,4 @@
+#ifndef ESP_TASK_WDT_H
+#define ESP_TASK_WDT_H
+
+#endif // ESP_TASK_WDT_H
@@ -0,0 +1,36 @@
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <cstdint>
+#include <esp_err.h>
+
+typedef struct HostTimer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+// 主机上的定时器不会自行触发，由测试调用 HostTimerFireAll 触发所有已启动的定时器
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+// 单调时钟加上 HostTimerAdvance 累计的模拟耗时
+int64_t esp_timer_get_time();
+
+void HostTimerFireAll();
+// 模拟外设占用的时间，例如 NVS 读写
+void HostTimerAdvance(int64_t us);
+
+#endif // ESP_TIMER_H
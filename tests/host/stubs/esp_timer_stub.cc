@@ -0,0 +1,92 @@
+#include "esp_timer.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+struct HostTimer {
+    esp_timer_create_args_t args;
+    bool armed = false;
+};
+
+namespace {
+
+std::mutex g_timers_mutex;
+std::vector<HostTimer*> g_timers;
+std::atomic<int64_t> g_advanced_us{0};
+
+} // namespace
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+    std::lock_guard<std::mutex> lock(g_timers_mutex);
+    auto timer = new HostTimer();
+    timer->args = *args;
+    g_timers.push_back(timer);
+    *handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    std::lock_guard<std::mutex> lock(g_timers_mutex);
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us) {
+    std::lock_guard<std::mutex> lock(g_timers_mutex);
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(g_timers_mutex);
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(g_timers_mutex);
+    for (auto it = g_timers.begin(); it != g_timers.end(); ++it) {
+        if (*it == timer) {
+            g_timers.erase(it);
+            break;
+        }
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count() + g_advanced_us;
+}
+
+void HostTimerFireAll() {
+    std::vector<HostTimer*> fired;
+    {
+        std::lock_guard<std::mutex> lock(g_timers_mutex);
+        for (auto timer : g_timers) {
+            if (timer->armed) {
+                timer->armed = false;
+                fired.push_back(timer);
+            }
+        }
+    }
+    // 回调中可能再次启动定时器，不持有锁
+    for (auto timer : fired) {
+        timer->args.callback(timer->args.arg);
+    }
+}
+
+void HostTimerAdvance(int64_t us) {
+    g_advanced_us += us;
+}
@@ -0,0 +1,23 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <cstdint>
+
+// ESP-IDF 的 FreeRTOS.h 经由 portmacro.h 间接包含了 heap caps 接口
+#include <esp_heap_caps.h>
+
+// 主机测试用的 FreeRTOS 桩，任务为 std::thread，tick 为 1ms
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+#define portMAX_DELAY       ((TickType_t)0xffffffffUL)
+#define portNUM_PROCESSORS  2
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+#endif // FREERTOS_H
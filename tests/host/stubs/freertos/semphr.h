@@ -0,0 +1,14 @@
+#ifndef FREERTOS_SEMPHR_H
+#define FREERTOS_SEMPHR_H
+
+#include "queue.h"
+
+// 与 FreeRTOS 相同，二值信号量是长度为 1、元素大小为 0 的队列
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#define xSemaphoreCreateBinary()            xQueueCreate(1, 0)
+#define vSemaphoreDelete(semaphore)         vQueueDelete(semaphore)
+#define xSemaphoreGive(semaphore)           xQueueSend(semaphore, nullptr, 0)
+#define xSemaphoreTake(semaphore, ticks)    xQueueReceive(semaphore, nullptr, ticks)
+
+#endif // FREERTOS_SEMPHR_H
@@ -0,0 +1,23 @@
+#ifndef FREERTOS_TASK_H
+#define FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void* arg);
+typedef struct HostTask* TaskHandle_t;
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_size, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_size, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle, BaseType_t core_id);
+// 传入 NULL 时结束当前任务；主机上无法强行结束其它线程，只释放句柄
+void vTaskDelete(TaskHandle_t handle);
+void vTaskDelay(TickType_t ticks);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t handle);
+BaseType_t xTaskNotifyGive(TaskHandle_t handle);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+
+// 等待所有收到过通知的任务处理完通知，重新阻塞在 ulTaskNotifyTake 中
+void HostTaskWaitIdle();
+
+#endif // FREERTOS_TASK_H
@@ -0,0 +1,177 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct HostTask {
+    // 任务通知，由 g_notify_mutex 保护
+    uint32_t notify = 0;
+    bool waiting = false;
+};
+
+struct HostQueue {
+    size_t length;
+    size_t item_size;
+    std::deque<std::vector<uint8_t>> items;
+    std::mutex mutex;
+    std::condition_variable changed;
+};
+
+namespace {
+
+// vTaskDelete(NULL) 通过异常回到线程入口
+struct TaskExit {
+};
+
+thread_local HostTask* t_current_task = nullptr;
+std::mutex g_notify_mutex;
+std::condition_variable g_notify_changed;
+// 使用过任务通知的任务
+std::vector<HostTask*> g_notified_tasks;
+
+// 需持有 g_notify_mutex
+void TrackNotified(HostTask* task) {
+    if (std::find(g_notified_tasks.begin(), g_notified_tasks.end(), task) == g_notified_tasks.end()) {
+        g_notified_tasks.push_back(task);
+    }
+}
+
+BaseType_t CreateThread(TaskFunction_t function, void* arg, TaskHandle_t* handle) {
+    // 句柄可能被 vTaskDelete 释放，任务自己的通知状态单独分配
+    auto task = new HostTask();
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    std::thread([function, arg, task]() {
+        t_current_task = task;
+        try {
+            function(arg);
+        } catch (const TaskExit&) {
+        }
+    }).detach();
+    return pdPASS;
+}
+
+// portMAX_DELAY 时一直等待，否则最多等待 ticks 毫秒
+template<typename Predicate>
+bool WaitFor(HostQueue* queue, std::unique_lock<std::mutex>& lock, TickType_t ticks, Predicate predicate) {
+    if (ticks == portMAX_DELAY) {
+        queue->changed.wait(lock, predicate);
+        return true;
+    }
+    return queue->changed.wait_for(lock, std::chrono::milliseconds(ticks), predicate);
+}
+
+} // namespace
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_size, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle) {
+    return CreateThread(function, arg, handle);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_size, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle, BaseType_t core_id) {
+    return CreateThread(function, arg, handle);
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+    if (handle == nullptr) {
+        throw TaskExit();
+    }
+    // 线程仍在运行，句柄不释放
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t handle) {
+    return 1;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle) {
+    std::lock_guard<std::mutex> lock(g_notify_mutex);
+    TrackNotified(handle);
+    handle->notify++;
+    g_notify_changed.notify_all();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    // 不是由 xTaskCreate 创建的线程，例如测试的主线程
+    if (t_current_task == nullptr) {
+        t_current_task = new HostTask();
+    }
+    auto task = t_current_task;
+    std::unique_lock<std::mutex> lock(g_notify_mutex);
+    TrackNotified(task);
+    task->waiting = true;
+    g_notify_changed.notify_all();
+    auto notified = [task]() { return task->notify > 0; };
+    if (ticks == portMAX_DELAY) {
+        g_notify_changed.wait(lock, notified);
+    } else {
+        g_notify_changed.wait_for(lock, std::chrono::milliseconds(ticks), notified);
+    }
+    task->waiting = false;
+    uint32_t value = task->notify;
+    if (value > 0) {
+        task->notify = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+void HostTaskWaitIdle() {
+    std::unique_lock<std::mutex> lock(g_notify_mutex);
+    g_notify_changed.wait(lock, []() {
+        return std::all_of(g_notified_tasks.begin(), g_notified_tasks.end(), [](HostTask* task) {
+            return task->waiting && task->notify == 0;
+        });
+    });
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    auto queue = new HostQueue();
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!WaitFor(queue, lock, ticks, [queue]() { return queue->items.size() < queue->length; })) {
+        return pdFALSE;
+    }
+    std::vector<uint8_t> data(queue->item_size);
+    if (queue->item_size > 0) {
+        memcpy(data.data(), item, queue->item_size);
+    }
+    queue->items.push_back(std::move(data));
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!WaitFor(queue, lock, ticks, [queue]() { return !queue->items.empty(); })) {
+        return pdFALSE;
+    }
+    if (queue->item_size > 0) {
+        memcpy(item, queue->items.front().data(), queue->item_size);
+    }
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
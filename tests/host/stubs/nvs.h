@@ -0,0 +1,82 @@
+#ifndef NVS_H
+#define NVS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <esp_err.h>
+
+#define NVS_DEFAULT_PART_NAME   "nvs"
+#define NVS_KEY_NAME_MAX_SIZE   16
+#define NVS_NS_NAME_MAX_SIZE    16
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+typedef enum {
+    NVS_TYPE_U8 = 0x01,
+    NVS_TYPE_I8 = 0x11,
+    NVS_TYPE_U16 = 0x02,
+    NVS_TYPE_I16 = 0x12,
+    NVS_TYPE_U32 = 0x04,
+    NVS_TYPE_I32 = 0x14,
+    NVS_TYPE_U64 = 0x08,
+    NVS_TYPE_I64 = 0x18,
+    NVS_TYPE_STR = 0x21,
+    NVS_TYPE_BLOB = 0x42,
+    NVS_TYPE_ANY = 0xff,
+} nvs_type_t;
+
+typedef struct {
+    char namespace_name[NVS_NS_NAME_MAX_SIZE];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_type_t type;
+} nvs_entry_info_t;
+
+typedef struct nvs_opaque_iterator_t* nvs_iterator_t;
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out_value);
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out_value);
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length);
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value);
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value);
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key);
+esp_err_t nvs_erase_all(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+esp_err_t nvs_entry_find(const char* part_name, const char* namespace_name, nvs_type_t type, nvs_iterator_t* output_iterator);
+esp_err_t nvs_entry_next(nvs_iterator_t* iterator);
+esp_err_t nvs_entry_info(const nvs_iterator_t iterator, nvs_entry_info_t* out_info);
+void nvs_release_iterator(nvs_iterator_t iterator);
+
+// 以下为主机测试使用的 NVS 模拟器接口。每次操作按设备上的量级计入模拟耗时（HostTimerAdvance），
+// 同时统计次数，用来比较不同读写方式的开销
+struct HostNvsStats {
+    int opens = 0;
+    int reads = 0;
+    // nvs_set_*，其中 blob_writes 为 nvs_set_blob
+    int writes = 0;
+    int blob_writes = 0;
+    int erases = 0;
+    int commits = 0;
+    // 遍历时扫描的条目数，nvs_entry_find 需要扫描整个分区
+    int scanned = 0;
+    int64_t busy_us = 0;
+};
+
+HostNvsStats HostNvsGetStats();
+void HostNvsResetStats();
+// 保存和恢复全部内容，用于模拟重启
+std::string HostNvsSave();
+void HostNvsRestore(const std::string& data);
+
+#endif // NVS_H
@@ -0,0 +1,308 @@
+#include "nvs_flash.h"
+#include "esp_timer.h"
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// 各操作的模拟耗时（微秒），按 ESP32-S3 上 NVS 的量级估计，只用于比较次数不同的方案。
+// 条目为 32 字节，字符串和 blob 按占用的条目数计算
+#define NVS_COST_OPEN_US        30
+#define NVS_COST_GET_US         40
+#define NVS_COST_SCAN_US        10
+#define NVS_COST_SET_US         300
+#define NVS_COST_ENTRY_US       15
+#define NVS_COST_WRITE_ENTRY_US 100
+#define NVS_COST_ERASE_US       200
+#define NVS_COST_COMMIT_US      20
+
+struct NvsItem {
+    nvs_type_t type;
+    std::vector<uint8_t> data;
+};
+
+struct nvs_opaque_iterator_t {
+    std::vector<nvs_entry_info_t> entries;
+    size_t index = 0;
+};
+
+namespace {
+
+struct OpenHandle {
+    std::string ns;
+    bool read_write;
+};
+
+std::mutex g_mutex;
+std::map<std::string, std::map<std::string, NvsItem>> g_storage;
+std::map<nvs_handle_t, OpenHandle> g_handles;
+nvs_handle_t g_next_handle = 1;
+HostNvsStats g_stats;
+
+// 需持有 g_mutex
+void Spend(int64_t us) {
+    g_stats.busy_us += us;
+    HostTimerAdvance(us);
+}
+
+int EntrySpan(size_t bytes) {
+    return 1 + (bytes + 31) / 32;
+}
+
+// 需持有 g_mutex，返回 nullptr 时 err 为错误码
+std::map<std::string, NvsItem>* GetNamespace(nvs_handle_t handle, bool write, esp_err_t& err) {
+    auto it = g_handles.find(handle);
+    if (it == g_handles.end()) {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+        return nullptr;
+    }
+    if (write && !it->second.read_write) {
+        err = ESP_ERR_NVS_READ_ONLY;
+        return nullptr;
+    }
+    err = ESP_OK;
+    return &g_storage[it->second.ns];
+}
+
+esp_err_t Get(nvs_handle_t handle, const char* key, nvs_type_t type, void* out, size_t* length, bool exact) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_stats.reads++;
+    Spend(NVS_COST_GET_US);
+    esp_err_t err;
+    auto ns = GetNamespace(handle, false, err);
+    if (ns == nullptr) {
+        return err;
+    }
+    auto it = ns->find(key);
+    if (it == ns->end() || it->second.type != type) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    auto& data = it->second.data;
+    if (exact) {
+        memcpy(out, data.data(), data.size());
+        return ESP_OK;
+    }
+    if (out == nullptr) {
+        *length = data.size();
+        return ESP_OK;
+    }
+    if (*length < data.size()) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    Spend(NVS_COST_ENTRY_US * EntrySpan(data.size()));
+    memcpy(out, data.data(), data.size());
+    *length = data.size();
+    return ESP_OK;
+}
+
+esp_err_t Set(nvs_handle_t handle, const char* key, nvs_type_t type, const void* value, size_t length) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (strlen(key) == 0 || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err;
+    auto ns = GetNamespace(handle, true, err);
+    if (ns == nullptr) {
+        return err;
+    }
+    g_stats.writes++;
+    if (type == NVS_TYPE_BLOB) {
+        g_stats.blob_writes++;
+    }
+    Spend(NVS_COST_SET_US + NVS_COST_WRITE_ENTRY_US * EntrySpan(length));
+    auto bytes = static_cast<const uint8_t*>(value);
+    (*ns)[key] = NvsItem{type, std::vector<uint8_t>(bytes, bytes + length)};
+    return ESP_OK;
+}
+
+} // namespace
+
+esp_err_t nvs_flash_init() {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_storage.clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_stats.opens++;
+    Spend(NVS_COST_OPEN_US);
+    if (strlen(name) == 0 || strlen(name) >= NVS_NS_NAME_MAX_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (open_mode == NVS_READONLY && g_storage.find(name) == g_storage.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    g_storage[name];
+    *out_handle = g_next_handle++;
+    g_handles[*out_handle] = OpenHandle{name, open_mode == NVS_READWRITE};
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_handles.erase(handle);
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out_value) {
+    return Get(handle, key, NVS_TYPE_I32, out_value, nullptr, true);
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out_value) {
+    return Get(handle, key, NVS_TYPE_U32, out_value, nullptr, true);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length) {
+    return Get(handle, key, NVS_TYPE_STR, out_value, length, false);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+    return Get(handle, key, NVS_TYPE_BLOB, out_value, length, false);
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value) {
+    return Set(handle, key, NVS_TYPE_I32, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value) {
+    return Set(handle, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+
+// 与设备相同，保存的长度包含结尾的 '\0'
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    return Set(handle, key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    return Set(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    esp_err_t err;
+    auto ns = GetNamespace(handle, true, err);
+    if (ns == nullptr) {
+        return err;
+    }
+    g_stats.erases++;
+    Spend(NVS_COST_ERASE_US);
+    return ns->erase(key) > 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    esp_err_t err;
+    auto ns = GetNamespace(handle, true, err);
+    if (ns == nullptr) {
+        return err;
+    }
+    g_stats.erases++;
+    Spend(NVS_COST_ERASE_US * (1 + ns->size()));
+    ns->clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    esp_err_t err;
+    if (GetNamespace(handle, false, err) == nullptr) {
+        return err;
+    }
+    g_stats.commits++;
+    Spend(NVS_COST_COMMIT_US);
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_find(const char* part_name, const char* namespace_name, nvs_type_t type, nvs_iterator_t* output_iterator) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    *output_iterator = nullptr;
+    auto iterator = new nvs_opaque_iterator_t();
+    // 设备上按页扫描整个分区，再按命名空间和类型过滤
+    for (auto& [ns, items] : g_storage) {
+        for (auto& [key, item] : items) {
+            g_stats.scanned++;
+            Spend(NVS_COST_SCAN_US);
+            if ((namespace_name != nullptr && ns != namespace_name) || (type != NVS_TYPE_ANY && item.type != type)) {
+                continue;
+            }
+            nvs_entry_info_t info = {};
+            strncpy(info.namespace_name, ns.c_str(), sizeof(info.namespace_name) - 1);
+            strncpy(info.key, key.c_str(), sizeof(info.key) - 1);
+            info.type = item.type;
+            iterator->entries.push_back(info);
+        }
+    }
+    if (iterator->entries.empty()) {
+        delete iterator;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *output_iterator = iterator;
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_next(nvs_iterator_t* iterator) {
+    if (++(*iterator)->index >= (*iterator)->entries.size()) {
+        delete *iterator;
+        *iterator = nullptr;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_info(const nvs_iterator_t iterator, nvs_entry_info_t* out_info) {
+    *out_info = iterator->entries[iterator->index];
+    return ESP_OK;
+}
+
+void nvs_release_iterator(nvs_iterator_t iterator) {
+    delete iterator;
+}
+
+HostNvsStats HostNvsGetStats() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_stats;
+}
+
+void HostNvsResetStats() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_stats = HostNvsStats();
+}
+
+// 格式：每项为 命名空间 \0 键 \0 类型(u8) 长度(u32) 数据
+std::string HostNvsSave() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::string data;
+    for (auto& [ns, items] : g_storage) {
+        for (auto& [key, item] : items) {
+            uint32_t length = item.data.size();
+            data += ns + '\0' + key + '\0';
+            data += (char)item.type;
+            data.append((const char*)&length, sizeof(length));
+            data.append(item.data.begin(), item.data.end());
+        }
+    }
+    return data;
+}
+
+void HostNvsRestore(const std::string& data) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_storage.clear();
+    size_t pos = 0;
+    while (pos < data.size()) {
+        std::string ns = data.c_str() + pos;
+        pos += ns.size() + 1;
+        std::string key = data.c_str() + pos;
+        pos += key.size() + 1;
+        auto type = (nvs_type_t)(uint8_t)data[pos++];
+        uint32_t length;
+        memcpy(&length, data.data() + pos, sizeof(length));
+        pos += sizeof(length);
+        g_storage[ns][key] = NvsItem{type, std::vector<uint8_t>(data.begin() + pos, data.begin() + pos + length)};
+        pos += length;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef ROM_MINIZ_H
+#define ROM_MINIZ_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <zlib.h>
+
+// 主机上没有 ROM 中的 tinfl，这里按 tinfl_decompress 的接口和状态码包装系统的 zlib。
+// zlib 自己维护窗口，输出直接写到 out_buf_next，调用方的环形窗口只作为输出缓冲区使用
+
+typedef uint32_t mz_uint32;
+
+#define TINFL_LZ_DICT_SIZE                  32768
+
+#define TINFL_FLAG_PARSE_ZLIB_HEADER        1
+#define TINFL_FLAG_HAS_MORE_INPUT           2
+#define TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF 4
+#define TINFL_FLAG_COMPUTE_ADLER32          8
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+    z_stream stream;
+    bool active;
+} tinfl_decompressor;
+
+inline void tinfl_init(tinfl_decompressor* r) {
+    r->stream = {};
+    r->active = inflateInit2(&r->stream, 15) == Z_OK;
+}
+
+// 调用方只用 heap_caps_free 释放状态，zlib 的内部状态在流结束或出错时释放
+inline tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* in_buf_next, size_t* in_buf_size,
+                                     uint8_t* out_buf_start, uint8_t* out_buf_next, size_t* out_buf_size,
+                                     const mz_uint32 decomp_flags) {
+    (void)out_buf_start;
+    if (!r->active || !(decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER)) {
+        *in_buf_size = 0;
+        *out_buf_size = 0;
+        return TINFL_STATUS_BAD_PARAM;
+    }
+    r->stream.next_in = const_cast<Bytef*>(in_buf_next);
+    r->stream.avail_in = (uInt)*in_buf_size;
+    r->stream.next_out = out_buf_next;
+    r->stream.avail_out = (uInt)*out_buf_size;
+    int ret = inflate(&r->stream, Z_NO_FLUSH);
+    *in_buf_size -= r->stream.avail_in;
+    *out_buf_size -= r->stream.avail_out;
+
+    tinfl_status status;
+    if (ret == Z_STREAM_END) {
+        status = TINFL_STATUS_DONE;
+    } else if (ret == Z_OK || ret == Z_BUF_ERROR) {
+        if (r->stream.avail_out == 0) {
+            return TINFL_STATUS_HAS_MORE_OUTPUT;
+        }
+        if (decomp_flags & TINFL_FLAG_HAS_MORE_INPUT) {
+            return TINFL_STATUS_NEEDS_MORE_INPUT;
+        }
+        status = TINFL_STATUS_FAILED;
+    } else if (ret == Z_DATA_ERROR && r->stream.msg != nullptr && strcmp(r->stream.msg, "incorrect data check") == 0) {
+        status = TINFL_STATUS_ADLER32_MISMATCH;
+    } else {
+        status = TINFL_STATUS_FAILED;
+    }
+    inflateEnd(&r->stream);
+    r->active = false;
+    return status;
+}
+
+#endif // ROM_MINIZ_H
@@ -0,0 +1,234 @@
+#include "background_task.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// 统计堆分配次数，检查 Job 是否在内部存储中保存回调
+static std::atomic<int> g_allocations{0};
+
+void* operator new(size_t size) {
+    g_allocations++;
+    if (void* ptr = malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace {
+
+// 工作任务无法在主机上结束，BackgroundTask 不析构
+BackgroundTask* CreateTask(int worker_count) {
+    return new BackgroundTask(4096 * 2, worker_count);
+}
+
+// 第一个任务阻塞工作任务，直到 Release 调用，用来先把队列排满
+class Gate {
+public:
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        entered_ = true;
+        cv_.notify_all();
+        cv_.wait(lock, [this]() { return open_; });
+    }
+    void WaitEntered() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return entered_; });
+    }
+    void Release() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool entered_ = false;
+    bool open_ = false;
+};
+
+} // namespace
+
+TEST_CASE("Jobs in one lane run in FIFO order without overlapping", "[background_task]") {
+    auto task = CreateTask(2);
+    std::mutex mutex;
+    std::vector<int> order;
+    std::atomic<int> running{0};
+    std::atomic<int> max_running{0};
+
+    for (int i = 0; i < 200; i++) {
+        REQUIRE(task->Schedule([&, i]() {
+            int now = ++running;
+            int prev = max_running.load();
+            while (now > prev && !max_running.compare_exchange_weak(prev, now)) {
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(i);
+            }
+            running--;
+        }, kBackgroundTaskLaneAudioDecode));
+    }
+    task->WaitForCompletion();
+
+    REQUIRE(order.size() == 200);
+    for (int i = 0; i < 200; i++) {
+        REQUIRE(order[i] == i);
+    }
+    REQUIRE(max_running == 1);
+}
+
+TEST_CASE("Higher priority lanes are taken first", "[background_task]") {
+    auto task = CreateTask(1);
+    Gate gate;
+    std::mutex mutex;
+    std::vector<BackgroundTaskLane> order;
+
+    REQUIRE(task->Schedule([&]() { gate.Wait(); }, kBackgroundTaskLaneMisc));
+    gate.WaitEntered();
+    for (auto lane : {kBackgroundTaskLaneMisc, kBackgroundTaskLaneAudioEncode, kBackgroundTaskLaneAudioDecode}) {
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(task->Schedule([&, lane]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(lane);
+            }, lane));
+        }
+    }
+    gate.Release();
+    task->WaitForCompletion();
+
+    std::vector<BackgroundTaskLane> expected = {
+        kBackgroundTaskLaneAudioDecode, kBackgroundTaskLaneAudioDecode, kBackgroundTaskLaneAudioDecode,
+        kBackgroundTaskLaneAudioEncode, kBackgroundTaskLaneAudioEncode, kBackgroundTaskLaneAudioEncode,
+        kBackgroundTaskLaneMisc, kBackgroundTaskLaneMisc, kBackgroundTaskLaneMisc,
+    };
+    REQUIRE(order == expected);
+}
+
+TEST_CASE("Cancel drops queued jobs of one lane", "[background_task]") {
+    auto task = CreateTask(1);
+    Gate gate;
+    std::atomic<int> decoded{0};
+    std::atomic<int> misc{0};
+
+    REQUIRE(task->Schedule([&]() { gate.Wait(); }, kBackgroundTaskLaneMisc));
+    gate.WaitEntered();
+    for (int i = 0; i < 5; i++) {
+        task->Schedule([&]() { decoded++; }, kBackgroundTaskLaneAudioDecode);
+        task->Schedule([&]() { misc++; }, kBackgroundTaskLaneMisc);
+    }
+    REQUIRE(task->Cancel(kBackgroundTaskLaneAudioDecode) == 5);
+    gate.Release();
+    task->WaitForCompletion();
+
+    REQUIRE(decoded == 0);
+    REQUIRE(misc == 5);
+}
+
+TEST_CASE("Jobs up to the inline capacity do not allocate", "[background_task]") {
+    // 与音频任务相同大小的捕获：this、编解码器指针和一个数据包
+    std::array<uint8_t, 32> packet = {};
+    void* self = &packet;
+    void* codec = &packet;
+    int allocations = g_allocations;
+    BackgroundTask::Job job([self, codec, packet]() {
+        (void)self;
+        (void)codec;
+        (void)packet;
+    });
+    BackgroundTask::Job moved(std::move(job));
+    moved();
+    REQUIRE(g_allocations == allocations);
+
+    // 超过容量时退回到堆上
+    std::array<uint8_t, 64> large = {};
+    BackgroundTask::Job heap_job([large]() { (void)large; });
+    REQUIRE(g_allocations == allocations + 1);
+}
+
+// 模拟对话中的负载：misc 通道不断有耗时任务，音频解码任务的排队延迟应与 misc 任务的耗时无关
+TEST_CASE("Audio lane latency under a busy misc lane", "[background_task][benchmark]") {
+    const auto misc_duration = std::chrono::milliseconds(20);
+    const int frames = 50;
+    auto task = CreateTask(2);
+    std::atomic<bool> stop{false};
+    std::atomic<int> misc_done{0};
+
+    // 保持 misc 通道一直有任务排队
+    std::thread flood([&]() {
+        while (!stop) {
+            task->Schedule([&]() {
+                std::this_thread::sleep_for(misc_duration);
+                misc_done++;
+            }, kBackgroundTaskLaneMisc);
+            std::this_thread::sleep_for(misc_duration / 2);
+        }
+    });
+
+    std::vector<int64_t> latencies(frames);
+    std::atomic<int> decoded{0};
+    for (int i = 0; i < frames; i++) {
+        auto scheduled = Clock::now();
+        task->Schedule([&, i, scheduled]() {
+            latencies[i] = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - scheduled).count();
+            decoded++;
+        }, kBackgroundTaskLaneAudioDecode);
+        // 60ms 一帧的音频，这里加快为 5ms
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    while (decoded < frames) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    stop = true;
+    flood.join();
+    task->Cancel(kBackgroundTaskLaneMisc);
+    task->WaitForCompletion();
+
+    std::sort(latencies.begin(), latencies.end());
+    int64_t median = latencies[frames / 2];
+    int64_t worst = latencies[frames - 1];
+    printf("Audio lane latency with busy misc lane: median %lld us, worst %lld us, %d misc jobs\n",
+        (long long)median, (long long)worst, misc_done.load());
+    // 单一队列时音频任务要排在 misc 任务之后，延迟至少是一个 misc 任务的耗时
+    REQUIRE(median < std::chrono::duration_cast<std::chrono::microseconds>(misc_duration).count() / 2);
+}
+
+TEST_CASE("Schedule throughput", "[background_task][benchmark]") {
+    const int jobs = 200000;
+    auto task = CreateTask(1);
+    std::atomic<int> counter{0};
+    int allocations = g_allocations;
+
+    auto start = Clock::now();
+    for (int i = 0; i < jobs; i++) {
+        while (!task->Schedule([&counter]() { counter++; }, kBackgroundTaskLaneAudioEncode)) {
+            std::this_thread::yield();
+        }
+    }
+    task->WaitForCompletion();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+
+    REQUIRE(counter == jobs);
+    printf("Scheduled and ran %d jobs in %lld us (%.0f jobs/s), %d allocations\n", jobs, (long long)elapsed,
+        jobs * 1e6 / std::max<int64_t>(elapsed, 1), g_allocations - allocations);
+}
@@ -0,0 +1,142 @@
+#include "delta_patch.h"
+#include "fixtures.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct PatchResult {
+    bool ok = false;
+    bool finished = false;
+    std::vector<uint8_t> output;
+    size_t max_read_end = 0;
+};
+
+// 按 chunk 字节分段输入补丁，模拟网络或解压输出的分段
+PatchResult Apply(const std::vector<uint8_t>& old, const std::vector<uint8_t>& patch, size_t chunk,
+                  bool accept_header = true) {
+    PatchResult result;
+    DeltaPatch delta(
+        [&](const DeltaPatchHeader& header) {
+            return accept_header && header.old_size == old.size();
+        },
+        [&](size_t offset, uint8_t* data, size_t len) {
+            if (offset + len > old.size()) {
+                return false;
+            }
+            memcpy(data, old.data() + offset, len);
+            result.max_read_end = std::max(result.max_read_end, offset + len);
+            return true;
+        },
+        [&](const uint8_t* data, size_t len) {
+            result.output.insert(result.output.end(), data, data + len);
+            return true;
+        });
+    result.ok = true;
+    for (size_t pos = 0; pos < patch.size() && result.ok; pos += chunk) {
+        result.ok = delta.Feed(patch.data() + pos, std::min(chunk, patch.size() - pos));
+    }
+    result.finished = delta.IsFinished();
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("Patches from delta_patch.py rebuild the new firmware", "[delta_patch]") {
+    auto old = LoadFixture("old.bin");
+    auto fresh = LoadFixture("new.bin");
+    auto patch = LoadFixture("patch.bin");
+    REQUIRE(!old.empty());
+    REQUIRE(!fresh.empty());
+    REQUIRE(patch.size() < fresh.size() / 10);
+
+    for (size_t chunk : {(size_t)1, (size_t)7, (size_t)80, (size_t)4096, (size_t)32 * 1024, patch.size()}) {
+        CAPTURE(chunk);
+        auto result = Apply(old, patch, chunk);
+        REQUIRE(result.ok);
+        REQUIRE(result.finished);
+        REQUIRE(result.output.size() == fresh.size());
+        REQUIRE((result.output == fresh));
+        REQUIRE(result.max_read_end <= old.size());
+    }
+}
+
+TEST_CASE("Header carries the image sizes", "[delta_patch]") {
+    auto old = LoadFixture("old.bin");
+    auto fresh = LoadFixture("new.bin");
+    auto patch = LoadFixture("patch.bin");
+    DeltaPatchHeader header = {};
+    DeltaPatch delta(
+        [&](const DeltaPatchHeader& h) {
+            header = h;
+            return false;
+        },
+        [](size_t, uint8_t*, size_t) { return false; },
+        [](const uint8_t*, size_t) { return false; });
+    REQUIRE_FALSE(delta.Feed(patch.data(), patch.size()));
+    REQUIRE(header.old_size == old.size());
+    REQUIRE(header.new_size == fresh.size());
+}
+
+TEST_CASE("Bad patches are rejected", "[delta_patch]") {
+    auto old = LoadFixture("old.bin");
+    auto patch = LoadFixture("patch.bin");
+
+    SECTION("rejected header") {
+        auto result = Apply(old, patch, 4096, false);
+        REQUIRE_FALSE(result.ok);
+        REQUIRE(result.output.empty());
+    }
+    SECTION("wrong magic") {
+        auto bad = patch;
+        bad[0] ^= 0xFF;
+        REQUIRE_FALSE(Apply(old, bad, 4096).ok);
+    }
+    SECTION("truncated") {
+        auto truncated = std::vector<uint8_t>(patch.begin(), patch.end() - 10);
+        auto result = Apply(old, truncated, 4096);
+        REQUIRE(result.ok);
+        REQUIRE_FALSE(result.finished);
+    }
+    SECTION("trailing data") {
+        auto extended = patch;
+        extended.push_back(0);
+        REQUIRE_FALSE(Apply(old, extended, 4096).ok);
+    }
+    SECTION("old firmware too short") {
+        auto shorter = std::vector<uint8_t>(old.begin(), old.begin() + old.size() / 2);
+        // 头部检查通过后，读取旧固件失败
+        DeltaPatch delta(
+            [](const DeltaPatchHeader&) { return true; },
+            [&](size_t offset, uint8_t* data, size_t len) {
+                if (offset + len > shorter.size()) {
+                    return false;
+                }
+                memcpy(data, shorter.data() + offset, len);
+                return true;
+            },
+            [](const uint8_t*, size_t) { return true; });
+        REQUIRE_FALSE(delta.Feed(patch.data(), patch.size()));
+    }
+}
+
+TEST_CASE("Patch apply throughput", "[delta_patch][benchmark]") {
+    auto old = LoadFixture("old.bin");
+    auto patch = LoadFixture("patch.bin");
+    const int rounds = 20;
+    size_t output_size = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        auto result = Apply(old, patch, 4096);
+        REQUIRE(result.finished);
+        output_size = result.output.size();
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Applied a %u byte patch to %u bytes: %.1f MB/s of output\n", (unsigned)patch.size(),
+        (unsigned)output_size, output_size * rounds / seconds / 1024 / 1024);
+}
@@ -0,0 +1,250 @@
+#include "image_preprocess.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+struct Rgb {
+    float r, g, b;
+};
+
+uint16_t Pack(int r, int g, int b) {
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+Rgb Unpack(uint16_t pixel) {
+    return { (float)(pixel >> 11), (float)((pixel >> 5) & 0x3F), (float)(pixel & 0x1F) };
+}
+
+// 参考图像：水平和垂直两个方向的渐变叠加细节，覆盖所有分量
+std::vector<uint16_t> MakeImage(int width, int height) {
+    std::vector<uint16_t> image(width * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int r = x * 31 / std::max(1, width - 1);
+            int g = y * 63 / std::max(1, height - 1);
+            int b = ((x / 3) ^ (y / 5)) & 0x1F;
+            image[y * width + x] = Pack(r, g, b);
+        }
+    }
+    return image;
+}
+
+std::vector<uint16_t> ToBigEndian(const std::vector<uint16_t>& image) {
+    std::vector<uint16_t> result(image.size());
+    for (size_t i = 0; i < image.size(); i++) {
+        result[i] = __builtin_bswap16(image[i]);
+    }
+    return result;
+}
+
+// 浮点参考实现：整数倍时为区域平均，否则为像素中心对齐的双线性插值
+Rgb Reference(const std::vector<uint16_t>& image, int width, const ImageRect& roi, int out_width, int out_height,
+              int x, int y) {
+    int factor = roi.width / out_width;
+    if (roi.width == out_width * factor && roi.height == out_height * factor) {
+        Rgb sum = {0, 0, 0};
+        for (int dy = 0; dy < factor; dy++) {
+            for (int dx = 0; dx < factor; dx++) {
+                auto p = Unpack(image[(roi.y + y * factor + dy) * width + roi.x + x * factor + dx]);
+                sum.r += p.r;
+                sum.g += p.g;
+                sum.b += p.b;
+            }
+        }
+        float area = factor * factor;
+        return { sum.r / area, sum.g / area, sum.b / area };
+    }
+
+    float sx = std::max(0.0f, (x + 0.5f) * roi.width / out_width - 0.5f);
+    float sy = std::max(0.0f, (y + 0.5f) * roi.height / out_height - 0.5f);
+    int x0 = std::min((int)sx, roi.width - 1);
+    int y0 = std::min((int)sy, roi.height - 1);
+    int x1 = std::min(x0 + 1, roi.width - 1);
+    int y1 = std::min(y0 + 1, roi.height - 1);
+    float fx = sx - x0;
+    float fy = sy - y0;
+    auto at = [&](int px, int py) { return Unpack(image[(roi.y + py) * width + roi.x + px]); };
+    auto p00 = at(x0, y0), p01 = at(x1, y0), p10 = at(x0, y1), p11 = at(x1, y1);
+    auto lerp = [&](float a, float b, float c, float d) {
+        return (a * (1 - fx) + b * fx) * (1 - fy) + (c * (1 - fx) + d * fx) * fy;
+    };
+    return { lerp(p00.r, p01.r, p10.r, p11.r), lerp(p00.g, p01.g, p10.g, p11.g), lerp(p00.b, p01.b, p10.b, p11.b) };
+}
+
+// BT.601 亮度，分量先扩展到 8 位
+float ReferenceLuma(const Rgb& p) {
+    return 0.299f * p.r * 255 / 31 + 0.587f * p.g * 255 / 63 + 0.114f * p.b * 255 / 31;
+}
+
+struct Result {
+    std::vector<uint8_t> data;
+    int width = 0;
+    int height = 0;
+};
+
+Result Run(const std::vector<uint16_t>& image, int width, int height, bool big_endian,
+           const ImagePreprocessOptions& options) {
+    ImageRect roi;
+    Result result;
+    ImagePreprocessGetLayout(options, width, height, roi, result.width, result.height);
+    result.data.resize(result.width * result.height * 2);
+    int out_width, out_height;
+    ImagePreprocess((const uint8_t*)image.data(), width, height, big_endian, options,
+                    result.data.data(), out_width, out_height);
+    REQUIRE(out_width == result.width);
+    REQUIRE(out_height == result.height);
+    return result;
+}
+
+// 与参考实现逐像素比较，返回最大误差：RGB 为 5/6 位分量的差，灰度为 8 位亮度的差
+float CompareWithReference(int width, int height, const ImagePreprocessOptions& options) {
+    auto image = MakeImage(width, height);
+    auto result = Run(ToBigEndian(image), width, height, true, options);
+    ImageRect roi;
+    int out_width, out_height;
+    ImagePreprocessGetLayout(options, width, height, roi, out_width, out_height);
+
+    float max_error = 0;
+    for (int y = 0; y < out_height; y++) {
+        for (int x = 0; x < out_width; x++) {
+            auto expected = Reference(image, width, roi, out_width, out_height, x, y);
+            if (options.grayscale) {
+                float error = std::fabs(result.data[y * out_width + x] - ReferenceLuma(expected));
+                max_error = std::max(max_error, error);
+            } else {
+                // 输出为大端 RGB565
+                uint16_t pixel = __builtin_bswap16(((uint16_t*)result.data.data())[y * out_width + x]);
+                auto actual = Unpack(pixel);
+                max_error = std::max({max_error, std::fabs(actual.r - expected.r),
+                    std::fabs(actual.g - expected.g), std::fabs(actual.b - expected.b)});
+            }
+        }
+    }
+    return max_error;
+}
+
+} // namespace
+
+TEST_CASE("Layout keeps the aspect ratio and never upscales", "[image_preprocess]") {
+    ImageRect roi;
+    int out_width, out_height;
+    ImagePreprocessOptions options;
+
+    REQUIRE_FALSE(ImagePreprocessGetLayout(options, 640, 480, roi, out_width, out_height));
+    REQUIRE(out_width == 640);
+    REQUIRE(out_height == 480);
+
+    options.max_width = 320;
+    REQUIRE(ImagePreprocessGetLayout(options, 640, 480, roi, out_width, out_height));
+    REQUIRE(out_width == 320);
+    REQUIRE(out_height == 240);
+
+    options.max_width = 1024;
+    options.max_height = 120;
+    REQUIRE(ImagePreprocessGetLayout(options, 640, 480, roi, out_width, out_height));
+    REQUIRE(out_width == 160);
+    REQUIRE(out_height == 120);
+
+    options = {};
+    options.roi_x = 0.5f;
+    options.roi_y = 0.25f;
+    options.roi_width = 1.0f;
+    options.roi_height = 0.5f;
+    REQUIRE(ImagePreprocessGetLayout(options, 640, 480, roi, out_width, out_height));
+    REQUIRE(roi.x == 320);
+    REQUIRE(roi.y == 120);
+    REQUIRE(roi.width == 320);
+    REQUIRE(roi.height == 240);
+    REQUIRE(out_width == 320);
+    REQUIRE(out_height == 240);
+
+    options = {};
+    options.grayscale = true;
+    REQUIRE(ImagePreprocessGetLayout(options, 640, 480, roi, out_width, out_height));
+}
+
+TEST_CASE("Integer downscale matches the box reference", "[image_preprocess]") {
+    ImagePreprocessOptions options;
+    options.max_width = 320;
+    REQUIRE(CompareWithReference(640, 480, options) <= 1.0f);
+    options.max_width = 160;
+    REQUIRE(CompareWithReference(640, 480, options) <= 1.0f);
+}
+
+TEST_CASE("Fractional downscale matches the bilinear reference", "[image_preprocess]") {
+    ImagePreprocessOptions options;
+    options.max_width = 224;
+    REQUIRE(CompareWithReference(640, 480, options) <= 1.0f);
+    options.max_width = 500;
+    REQUIRE(CompareWithReference(800, 600, options) <= 1.0f);
+}
+
+TEST_CASE("Cropped region matches the reference", "[image_preprocess]") {
+    ImagePreprocessOptions options;
+    options.roi_x = 0.25f;
+    options.roi_y = 0.1f;
+    options.roi_width = 0.5f;
+    options.roi_height = 0.6f;
+    options.max_width = 200;
+    REQUIRE(CompareWithReference(640, 480, options) <= 1.0f);
+}
+
+TEST_CASE("Grayscale matches BT.601 luma", "[image_preprocess]") {
+    ImagePreprocessOptions options;
+    options.grayscale = true;
+    options.max_width = 320;
+    // 设备端在 5/6 位分量上插值后再计算亮度，并用移位代替到 8 位的扩展，误差在 3% 以内
+    REQUIRE(CompareWithReference(640, 480, options) <= 8.0f);
+    options.max_width = 300;
+    REQUIRE(CompareWithReference(640, 480, options) <= 8.0f);
+}
+
+TEST_CASE("Solid colors are preserved exactly", "[image_preprocess]") {
+    for (uint16_t color : {Pack(31, 0, 0), Pack(0, 63, 0), Pack(0, 0, 31), Pack(17, 42, 9), Pack(31, 63, 31)}) {
+        std::vector<uint16_t> image(320 * 240, color);
+        for (int max_width : {160, 100}) {
+            ImagePreprocessOptions options;
+            options.max_width = max_width;
+            auto result = Run(image, 320, 240, false, options);
+            auto pixels = (const uint16_t*)result.data.data();
+            for (int i = 0; i < result.width * result.height; i++) {
+                REQUIRE(__builtin_bswap16(pixels[i]) == color);
+            }
+        }
+    }
+}
+
+TEST_CASE("Input byte order does not change the output", "[image_preprocess]") {
+    auto image = MakeImage(320, 240);
+    ImagePreprocessOptions options;
+    options.max_width = 150;
+    auto little = Run(image, 320, 240, false, options);
+    auto big = Run(ToBigEndian(image), 320, 240, true, options);
+    REQUIRE(little.data == big.data);
+}
+
+TEST_CASE("Preprocess throughput", "[image_preprocess][benchmark]") {
+    auto image = ToBigEndian(MakeImage(640, 480));
+    std::vector<uint8_t> dst(640 * 480 * 2);
+    for (int max_width : {320, 224}) {
+        ImagePreprocessOptions options;
+        options.max_width = max_width;
+        options.grayscale = true;
+        const int rounds = 50;
+        int out_width, out_height;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            ImagePreprocess((const uint8_t*)image.data(), 640, 480, true, options, dst.data(), out_width, out_height);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        printf("640x480 -> %dx%d grayscale: %.1f us/frame\n", out_width, out_height, (double)elapsed / rounds);
+    }
+}
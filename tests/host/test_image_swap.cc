@@ -0,0 +1,104 @@
+#include "image_preprocess.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// 摄像头每帧都要转换预览，转换过程中不能分配内存
+static std::atomic<int> g_allocations{0};
+
+void* operator new(size_t size) {
+    g_allocations++;
+    if (void* ptr = malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace {
+
+std::vector<uint16_t> MakeFrame(size_t pixel_count) {
+    std::vector<uint16_t> frame(pixel_count);
+    uint32_t seed = 12345;
+    for (auto& pixel : frame) {
+        seed = seed * 1103515245 + 12345;
+        pixel = seed >> 16;
+    }
+    return frame;
+}
+
+} // namespace
+
+TEST_CASE("ImageSwapRgb565 swaps the bytes of every pixel", "[image_swap]") {
+    for (size_t pixel_count : {0, 1, 2, 3, 240 * 240, 240 * 240 + 1}) {
+        auto src = MakeFrame(pixel_count);
+        std::vector<uint16_t> dst(pixel_count + 1, 0xA5A5);
+        ImageSwapRgb565((const uint8_t*)src.data(), (uint8_t*)dst.data(), pixel_count);
+        for (size_t i = 0; i < pixel_count; i++) {
+            REQUIRE(dst[i] == __builtin_bswap16(src[i]));
+        }
+        // 不写出范围外的像素
+        REQUIRE(dst[pixel_count] == 0xA5A5);
+    }
+}
+
+TEST_CASE("ImageSwapRgb565 works in place", "[image_swap]") {
+    auto frame = MakeFrame(321);
+    auto expected = frame;
+    ImageSwapRgb565((const uint8_t*)frame.data(), (uint8_t*)frame.data(), frame.size());
+    for (size_t i = 0; i < frame.size(); i++) {
+        REQUIRE(frame[i] == __builtin_bswap16(expected[i]));
+    }
+}
+
+TEST_CASE("ImageSwapRgb565 does not allocate", "[image_swap]") {
+    auto src = MakeFrame(320 * 240);
+    std::vector<uint16_t> dst(src.size());
+    int allocations = g_allocations;
+    for (int i = 0; i < 10; i++) {
+        ImageSwapRgb565((const uint8_t*)src.data(), (uint8_t*)dst.data(), src.size());
+    }
+    REQUIRE(g_allocations == allocations);
+}
+
+// 与逐像素 bswap16 对比，主机上的数字只用于比较两种写法
+TEST_CASE("ImageSwapRgb565 throughput", "[image_swap][benchmark]") {
+    const size_t pixel_count = 640 * 480;
+    const int rounds = 200;
+    auto src = MakeFrame(pixel_count);
+    std::vector<uint16_t> dst(pixel_count);
+
+    auto start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        ImageSwapRgb565((const uint8_t*)src.data(), (uint8_t*)dst.data(), pixel_count);
+    }
+    auto word_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+
+    volatile uint16_t* out = dst.data();
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        for (size_t p = 0; p < pixel_count; p++) {
+            out[p] = __builtin_bswap16(src[p]);
+        }
+    }
+    auto pixel_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+
+    printf("Swap 640x480 RGB565: %.1f us/frame word-wise, %.1f us/frame per pixel\n",
+        (double)word_us / rounds, (double)pixel_us / rounds);
+    REQUIRE(word_us > 0);
+}
@@ -0,0 +1,103 @@
+#include "inflate_stream.h"
+#include "fixtures.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+struct InflateResult {
+    bool ok = false;
+    bool finished = false;
+    std::vector<uint8_t> output;
+    size_t max_output_chunk = 0;
+};
+
+// 按 chunk 字节分段输入压缩数据，与 OTA 下载时从网络读到的分段相同
+InflateResult Inflate(const std::vector<uint8_t>& compressed, size_t chunk) {
+    InflateResult result;
+    InflateStream inflater([&](const uint8_t* data, size_t len) {
+        result.output.insert(result.output.end(), data, data + len);
+        result.max_output_chunk = std::max(result.max_output_chunk, len);
+        return true;
+    });
+    REQUIRE(inflater.Initialize());
+    result.ok = true;
+    for (size_t pos = 0; pos < compressed.size() && result.ok; pos += chunk) {
+        result.ok = inflater.Feed(compressed.data() + pos, std::min(chunk, compressed.size() - pos));
+    }
+    result.finished = inflater.IsFinished();
+    if (result.finished) {
+        REQUIRE(inflater.output_size() == result.output.size());
+    }
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("Firmware from compress_firmware.py inflates back", "[inflate_stream]") {
+    auto firmware = LoadFixture("new.bin");
+    auto compressed = LoadFixture("new.bin.z");
+    REQUIRE(!firmware.empty());
+    REQUIRE(compressed.size() > 2);
+    REQUIRE(compressed[0] == INFLATE_STREAM_ZLIB_CMF);
+
+    for (size_t chunk : {(size_t)1, (size_t)13, (size_t)512, (size_t)4096, (size_t)32 * 1024, compressed.size()}) {
+        CAPTURE(chunk);
+        auto result = Inflate(compressed, chunk);
+        REQUIRE(result.ok);
+        REQUIRE(result.finished);
+        REQUIRE(result.output.size() == firmware.size());
+        REQUIRE((result.output == firmware));
+        // 输出直接来自窗口，单次不超过窗口大小
+        REQUIRE(result.max_output_chunk <= TINFL_LZ_DICT_SIZE);
+    }
+}
+
+TEST_CASE("Bad compressed streams are rejected", "[inflate_stream]") {
+    auto compressed = LoadFixture("new.bin.z");
+
+    SECTION("truncated") {
+        auto truncated = std::vector<uint8_t>(compressed.begin(), compressed.end() - 100);
+        auto result = Inflate(truncated, 4096);
+        REQUIRE(result.ok);
+        REQUIRE_FALSE(result.finished);
+    }
+    SECTION("trailing data") {
+        auto extended = compressed;
+        extended.push_back(0);
+        REQUIRE_FALSE(Inflate(extended, 4096).ok);
+    }
+    SECTION("checksum mismatch") {
+        auto corrupted = compressed;
+        corrupted.back() ^= 0x01;
+        auto result = Inflate(corrupted, 4096);
+        REQUIRE_FALSE(result.ok);
+        REQUIRE_FALSE(result.finished);
+    }
+    SECTION("output rejected") {
+        int calls = 0;
+        InflateStream inflater([&](const uint8_t*, size_t) { return ++calls < 2; });
+        REQUIRE(inflater.Initialize());
+        REQUIRE_FALSE(inflater.Feed(compressed.data(), compressed.size()));
+        REQUIRE(calls == 2);
+    }
+}
+
+TEST_CASE("Inflate throughput", "[inflate_stream][benchmark]") {
+    auto compressed = LoadFixture("new.bin.z");
+    const int rounds = 20;
+    size_t output_size = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        auto result = Inflate(compressed, 4096);
+        REQUIRE(result.finished);
+        output_size = result.output.size();
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Inflated %u -> %u bytes (%.1f%%): %.1f MB/s of output\n", (unsigned)compressed.size(),
+        (unsigned)output_size, compressed.size() * 100.0 / output_size, output_size * rounds / seconds / 1024 / 1024);
+}
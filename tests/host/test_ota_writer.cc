@@ -0,0 +1,193 @@
+#include "ota_writer.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+#define SECTOR_SIZE     4096
+
+// 按速率占用调用方的时间。空闲过的时间不能补回，连续调用时从上次的截止时刻累计，避免 sleep 的误差累积
+class Pacer {
+public:
+    explicit Pacer(double bytes_per_second) : bytes_per_second_(bytes_per_second) {}
+
+    void Consume(size_t bytes, double extra_seconds = 0) {
+        deadline_ = std::max(deadline_, Clock::now()) + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(bytes / bytes_per_second_ + extra_seconds));
+        std::this_thread::sleep_until(deadline_);
+    }
+
+private:
+    double bytes_per_second_;
+    Clock::time_point deadline_;
+};
+
+// 模拟 esp_ota_write 的顺序写入：写到新扇区时先擦除，再按页编程
+class FlashSimulator {
+public:
+    FlashSimulator(double write_bytes_per_second, double erase_seconds)
+        : pacer_(write_bytes_per_second), erase_seconds_(erase_seconds) {}
+
+    bool Write(const uint8_t* data, size_t len) {
+        size_t end = content_.size() + len;
+        size_t erased_end = (end + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+        size_t new_sectors = (erased_end - erased_size_) / SECTOR_SIZE;
+        erased_size_ = erased_end;
+        pacer_.Consume(len, new_sectors * erase_seconds_);
+        content_.insert(content_.end(), data, data + len);
+        writes_++;
+        return true;
+    }
+
+    const std::vector<uint8_t>& content() const { return content_; }
+    int writes() const { return writes_; }
+
+private:
+    Pacer pacer_;
+    double erase_seconds_;
+    size_t erased_size_ = 0;
+    std::vector<uint8_t> content_;
+    int writes_ = 0;
+};
+
+// 模拟 Http::Read：每次最多返回一个 TCP 窗口的数据，读完返回 0
+class NetworkSimulator {
+public:
+    NetworkSimulator(const std::vector<uint8_t>& data, double bytes_per_second)
+        : data_(data), pacer_(bytes_per_second) {}
+
+    int Read(uint8_t* buffer, size_t len) {
+        size_t n = std::min({len, data_.size() - pos_, (size_t)5744});
+        if (n > 0) {
+            pacer_.Consume(n);
+            memcpy(buffer, data_.data() + pos_, n);
+            pos_ += n;
+        }
+        return (int)n;
+    }
+
+private:
+    const std::vector<uint8_t>& data_;
+    Pacer pacer_;
+    size_t pos_ = 0;
+};
+
+std::vector<uint8_t> MakeFirmware(size_t size) {
+    std::vector<uint8_t> data(size);
+    uint32_t seed = 1;
+    for (auto& byte : data) {
+        seed = seed * 1664525 + 1013904223;
+        byte = seed >> 24;
+    }
+    return data;
+}
+
+// 与 Ota::Download 相同的读取循环
+bool DownloadWithWriter(OtaWriter& writer, NetworkSimulator& network) {
+    REQUIRE(writer.Start());
+    uint8_t* buffer = nullptr;
+    size_t filled = 0;
+    while (true) {
+        if (buffer == nullptr) {
+            buffer = writer.Acquire();
+            filled = 0;
+            if (buffer == nullptr) {
+                break;
+            }
+        }
+        int ret = network.Read(buffer + filled, writer.buffer_size() - filled);
+        filled += ret;
+        if (ret == 0 || filled == writer.buffer_size()) {
+            if (filled > 0) {
+                writer.Submit(filled);
+                buffer = nullptr;
+            }
+            if (ret == 0) {
+                break;
+            }
+        }
+    }
+    return writer.Finish();
+}
+
+double Seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+} // namespace
+
+TEST_CASE("OtaWriter writes every byte in order", "[ota_writer]") {
+    auto firmware = MakeFirmware(300 * 1024 + 123);
+    std::vector<uint8_t> written;
+    OtaWriter writer([&](const uint8_t* data, size_t len) {
+        written.insert(written.end(), data, data + len);
+        return true;
+    });
+    REQUIRE(writer.Initialize(32 * 1024, 4 * 1024));
+    NetworkSimulator network(firmware, 1e9);
+    REQUIRE(DownloadWithWriter(writer, network));
+    REQUIRE((written == firmware));
+}
+
+TEST_CASE("OtaWriter stops the download after a write error", "[ota_writer]") {
+    auto firmware = MakeFirmware(1024 * 1024);
+    int writes = 0;
+    OtaWriter writer([&](const uint8_t* data, size_t len) {
+        return ++writes < 3;
+    });
+    REQUIRE(writer.Initialize(32 * 1024, 4 * 1024));
+    NetworkSimulator network(firmware, 1e9);
+    REQUIRE_FALSE(DownloadWithWriter(writer, network));
+    // 出错后写入方不再被调用，读取方最多再填满已取得的缓冲区
+    REQUIRE(writes == 3);
+}
+
+// 网络和 flash 速度相近时，重叠写入的总时间应接近两者中较慢的一方，而不是两者之和。
+// 速度按设备上的量级（约 400KB/s 的网络、每扇区约 10ms 的擦除）放大 20 倍以缩短测试时间
+TEST_CASE("Overlapped writes against a simulated flash", "[ota_writer][benchmark]") {
+    const size_t size = 1024 * 1024;
+    const double network_rate = 20 * 400e3;
+    const double flash_rate = 20 * 1.2e6;
+    const double erase_seconds = 10e-3 / 20;
+    auto firmware = MakeFirmware(size);
+
+    // 改动前的做法：读到的数据直接写入。设备上每次读 512 字节，主机上 sleep 的开销会放大小块的耗时，这里按 4KB 读取
+    FlashSimulator serial_flash(flash_rate, erase_seconds);
+    NetworkSimulator serial_network(firmware, network_rate);
+    auto start = Clock::now();
+    uint8_t chunk[4096];
+    int ret;
+    while ((ret = serial_network.Read(chunk, sizeof(chunk))) > 0) {
+        serial_flash.Write(chunk, ret);
+    }
+    double serial_seconds = Seconds(start);
+    REQUIRE((serial_flash.content() == firmware));
+
+    for (size_t buffer_size : {32 * 1024, 4 * 1024}) {
+        FlashSimulator flash(flash_rate, erase_seconds);
+        NetworkSimulator network(firmware, network_rate);
+        OtaWriter writer([&](const uint8_t* data, size_t len) {
+            return flash.Write(data, len);
+        });
+        // 不使用 PSRAM 时的大小由第二个参数决定，这里直接指定
+        REQUIRE(writer.Initialize(buffer_size, buffer_size));
+        start = Clock::now();
+        REQUIRE(DownloadWithWriter(writer, network));
+        double seconds = Seconds(start);
+        REQUIRE((flash.content() == firmware));
+
+        printf("%u KB in %u x %u KB buffers: %.0f ms (%.0f KB/s), serial: %.0f ms (%.0f KB/s), %d flash writes\n",
+            (unsigned)(size / 1024), OTA_BUFFER_COUNT, (unsigned)(buffer_size / 1024),
+            seconds * 1000, size / 1024 / seconds, serial_seconds * 1000, size / 1024 / serial_seconds, flash.writes());
+        REQUIRE(seconds < serial_seconds * 0.85);
+    }
+}
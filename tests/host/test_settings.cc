@@ -0,0 +1,290 @@
+#include "settings.h"
+
+#include <catch2/catch.hpp>
+
+#include <esp_app_desc.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+struct Boot {
+    std::string result;
+    // 启动过程中的 NVS 操作和耗时
+    HostNvsStats boot;
+    int64_t boot_us = 0;
+    // 启动后定时器到期，后台写入的 NVS 操作
+    HostNvsStats idle;
+};
+
+// SettingsStore 是进程内的单例，每次启动在子进程中运行，结束后把 NVS 的内容带回父进程，
+// 下一次启动从这份内容开始。子进程中不能使用 REQUIRE，结果返回给父进程检查
+Boot RunBoot(const std::function<std::string()>& body) {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    pid_t pid = fork();
+    REQUIRE(pid >= 0);
+    if (pid == 0) {
+        close(fds[0]);
+        Boot boot;
+        HostNvsResetStats();
+        int64_t start = esp_timer_get_time();
+        boot.result = body();
+        boot.boot_us = esp_timer_get_time() - start;
+        boot.boot = HostNvsGetStats();
+        HostNvsResetStats();
+        HostTimerFireAll();
+        HostTaskWaitIdle();
+        boot.idle = HostNvsGetStats();
+
+        uint32_t result_size = boot.result.size();
+        std::string out;
+        out.append((const char*)&boot.boot, sizeof(boot.boot));
+        out.append((const char*)&boot.boot_us, sizeof(boot.boot_us));
+        out.append((const char*)&boot.idle, sizeof(boot.idle));
+        out.append((const char*)&result_size, sizeof(result_size));
+        out += boot.result;
+        out += HostNvsSave();
+        for (size_t pos = 0; pos < out.size();) {
+            ssize_t n = write(fds[1], out.data() + pos, out.size() - pos);
+            if (n <= 0) {
+                _exit(1);
+            }
+            pos += n;
+        }
+        // 工作任务仍在运行，不做析构
+        _exit(0);
+    }
+
+    close(fds[1]);
+    std::string in;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0) {
+        in.append(buffer, n);
+    }
+    close(fds[0]);
+    int status = 0;
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+
+    Boot boot;
+    uint32_t result_size = 0;
+    size_t pos = 0;
+    auto get = [&](void* value, size_t len) {
+        REQUIRE(pos + len <= in.size());
+        memcpy(value, in.data() + pos, len);
+        pos += len;
+    };
+    get(&boot.boot, sizeof(boot.boot));
+    get(&boot.boot_us, sizeof(boot.boot_us));
+    get(&boot.idle, sizeof(boot.idle));
+    get(&result_size, sizeof(result_size));
+    REQUIRE(pos + result_size <= in.size());
+    boot.result = in.substr(pos, result_size);
+    HostNvsRestore(in.substr(pos + result_size));
+    return boot;
+}
+
+// 与 app_main 和各组件在启动时的读取相同
+std::string ReadBootSettings() {
+    Settings::LoadSnapshot();
+    std::string result;
+    auto add = [&result](const std::string& value) {
+        result += value + ";";
+    };
+    {
+        Settings settings("board", true);
+        add(settings.GetString("uuid"));
+    }
+    {
+        Settings settings("network", true);
+        add(std::to_string(settings.GetInt("type", 0)));
+    }
+    {
+        Settings settings("audio", false);
+        add(std::to_string(settings.GetInt("output_volume", 70)));
+    }
+    {
+        Settings settings("display", false);
+        add(std::to_string(settings.GetInt("brightness", 75)));
+        add(settings.GetString("theme", "light"));
+    }
+    {
+        Settings settings("websocket", false);
+        add(settings.GetString("url"));
+        add(settings.GetString("token"));
+        add(std::to_string(settings.GetInt("version")));
+    }
+    {
+        Settings settings("mqtt", false);
+        for (auto key : {"endpoint", "client_id", "username", "password", "publish_topic"}) {
+            add(settings.GetString(key));
+        }
+        add(std::to_string(settings.GetInt("keepalive", 120)));
+    }
+    return result;
+}
+
+void SetString(nvs_handle_t handle, const char* key, const char* value) {
+    REQUIRE(nvs_set_str(handle, key, value) == ESP_OK);
+}
+
+void SetInt(nvs_handle_t handle, const char* key, int32_t value) {
+    REQUIRE(nvs_set_i32(handle, key, value) == ESP_OK);
+}
+
+// 升级前的设备：设置只保存在原有的键中，分区中还有 Wi-Fi 驱动和其他组件的条目
+void SeedLegacyKeys() {
+    HostNvsRestore("");
+    *host_app_description() = {"1.0.0", "xiaozhi", {0x5a}};
+    nvs_handle_t handle;
+    REQUIRE(nvs_open("board", NVS_READWRITE, &handle) == ESP_OK);
+    SetString(handle, "uuid", "1b5c3a8e-7d2f-4a60-9e13-5f0c2b7a9d44");
+    nvs_close(handle);
+    REQUIRE(nvs_open("network", NVS_READWRITE, &handle) == ESP_OK);
+    SetInt(handle, "type", 1);
+    nvs_close(handle);
+    REQUIRE(nvs_open("audio", NVS_READWRITE, &handle) == ESP_OK);
+    SetInt(handle, "output_volume", 60);
+    nvs_close(handle);
+    REQUIRE(nvs_open("display", NVS_READWRITE, &handle) == ESP_OK);
+    SetInt(handle, "brightness", 80);
+    SetString(handle, "theme", "dark");
+    nvs_close(handle);
+    REQUIRE(nvs_open("websocket", NVS_READWRITE, &handle) == ESP_OK);
+    SetString(handle, "url", "wss://api.example.com/xiaozhi/v1/");
+    SetString(handle, "token", "test-token-0123456789abcdef");
+    SetInt(handle, "version", 3);
+    nvs_close(handle);
+    REQUIRE(nvs_open("mqtt", NVS_READWRITE, &handle) == ESP_OK);
+    SetString(handle, "endpoint", "mqtt.example.com");
+    SetString(handle, "client_id", "GID_test@@@aa_bb_cc_dd_ee_ff@@@1b5c3a8e");
+    SetString(handle, "username", "eyJpcCI6IjEyNy4wLjAuMSJ9");
+    SetString(handle, "password", "c2VjcmV0LXBhc3N3b3JkLWZvci10ZXN0cw==");
+    SetString(handle, "publish_topic", "device-server");
+    SetInt(handle, "keepalive", 240);
+    nvs_close(handle);
+    REQUIRE(nvs_open("wifi", NVS_READWRITE, &handle) == ESP_OK);
+    for (int i = 0; i < 3; i++) {
+        SetString(handle, ("ssid" + std::to_string(i)).c_str(), ("network-" + std::to_string(i)).c_str());
+        SetString(handle, ("password" + std::to_string(i)).c_str(), "password-1234");
+    }
+    nvs_close(handle);
+    REQUIRE(nvs_open("nvs.net80211", NVS_READWRITE, &handle) == ESP_OK);
+    uint8_t config[64] = {};
+    for (int i = 0; i < 24; i++) {
+        REQUIRE(nvs_set_blob(handle, ("sta.cfg" + std::to_string(i)).c_str(), config, sizeof(config)) == ESP_OK);
+    }
+    nvs_close(handle);
+}
+
+const char* kExpectedSettings = "1b5c3a8e-7d2f-4a60-9e13-5f0c2b7a9d44;1;60;80;dark;"
+    "wss://api.example.com/xiaozhi/v1/;test-token-0123456789abcdef;3;"
+    "mqtt.example.com;GID_test@@@aa_bb_cc_dd_ee_ff@@@1b5c3a8e;eyJpcCI6IjEyNy4wLjAuMSJ9;"
+    "c2VjcmV0LXBhc3N3b3JkLWZvci10ZXN0cw==;device-server;240;";
+
+// 从快照启动：只打开 settings 命名空间，读取 generation 和快照（长度、内容）
+void RequireSnapshotBoot(const Boot& boot) {
+    REQUIRE(boot.boot.opens == 1);
+    REQUIRE(boot.boot.reads == 3);
+    REQUIRE(boot.boot.scanned == 0);
+    REQUIRE(boot.boot.writes == 0);
+    REQUIRE(boot.idle.writes == 0);
+}
+
+} // namespace
+
+TEST_CASE("Legacy keys are migrated into a snapshot once", "[settings]") {
+    SeedLegacyKeys();
+
+    // 第一次启动没有快照，从原有的键读取，启动过程中不写 NVS，定时器到期后在后台写入快照
+    auto legacy = RunBoot(ReadBootSettings);
+    REQUIRE(legacy.result == kExpectedSettings);
+    REQUIRE(legacy.boot.opens == 7);
+    REQUIRE(legacy.boot.scanned > 0);
+    REQUIRE(legacy.boot.writes == 0);
+    REQUIRE(legacy.idle.writes == 1);
+    REQUIRE(legacy.idle.blob_writes == 1);
+    REQUIRE(legacy.idle.commits == 1);
+
+    auto snapshot = RunBoot(ReadBootSettings);
+    REQUIRE(snapshot.result == kExpectedSettings);
+    RequireSnapshotBoot(snapshot);
+
+    printf("Boot settings from NVS keys: %lld us (%d opens, %d reads, %d entries scanned)\n",
+        (long long)legacy.boot_us, legacy.boot.opens, legacy.boot.reads, legacy.boot.scanned);
+    printf("Boot settings from snapshot: %lld us (%d opens, %d reads), %lld us simulated NVS time saved\n",
+        (long long)snapshot.boot_us, snapshot.boot.opens, snapshot.boot.reads,
+        (long long)(legacy.boot.busy_us - snapshot.boot.busy_us));
+    REQUIRE(snapshot.boot.busy_us * 4 < legacy.boot.busy_us);
+
+    // 快照保持有效，之后的启动不再写入
+    REQUIRE(RunBoot(ReadBootSettings).idle.writes == 0);
+}
+
+TEST_CASE("Changes write only the keys until an explicit save", "[settings]") {
+    SeedLegacyKeys();
+    RunBoot(ReadBootSettings);
+
+    // 修改一个键：先更新 generation 使快照失效，再写键，不重写快照
+    auto changed = RunBoot([]() {
+        auto result = ReadBootSettings();
+        Settings settings("display", true);
+        settings.SetInt("brightness", 40);
+        return result;
+    });
+    REQUIRE(changed.result == kExpectedSettings);
+    REQUIRE(changed.boot.writes == 0);
+    REQUIRE(changed.idle.writes == 2);
+    REQUIRE(changed.idle.blob_writes == 0);
+
+    // 快照已过期，从原有的键读取到新的值，并且不在后台重写快照
+    std::string expected = kExpectedSettings;
+    expected.replace(expected.find(";80;"), 4, ";40;");
+    auto stale = RunBoot(ReadBootSettings);
+    REQUIRE(stale.result == expected);
+    REQUIRE(stale.boot.opens > 1);
+    REQUIRE(stale.idle.writes == 0);
+
+    // 显式保存时重写快照
+    auto saved = RunBoot([]() {
+        auto result = ReadBootSettings();
+        Settings::Flush();
+        return result;
+    });
+    REQUIRE(saved.result == expected);
+    REQUIRE(saved.boot.writes == 1);
+    REQUIRE(saved.boot.blob_writes == 1);
+    REQUIRE(saved.idle.writes == 0);
+
+    auto snapshot = RunBoot(ReadBootSettings);
+    REQUIRE(snapshot.result == expected);
+    RequireSnapshotBoot(snapshot);
+}
+
+TEST_CASE("A firmware change rebuilds the snapshot in the background", "[settings]") {
+    SeedLegacyKeys();
+    RunBoot(ReadBootSettings);
+    RequireSnapshotBoot(RunBoot(ReadBootSettings));
+
+    // 其他固件可能只修改了原有的键
+    host_app_description()->app_elf_sha256[0] ^= 0xFF;
+    auto upgraded = RunBoot(ReadBootSettings);
+    REQUIRE(upgraded.result == kExpectedSettings);
+    REQUIRE(upgraded.boot.opens == 7);
+    REQUIRE(upgraded.boot.writes == 0);
+    REQUIRE(upgraded.idle.blob_writes == 1);
+
+    RequireSnapshotBoot(RunBoot(ReadBootSettings));
+}